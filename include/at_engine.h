@@ -0,0 +1,93 @@
+#ifndef AT_ENGINE_H
+#define AT_ENGINE_H
+
+#include <stdint.h>
+#include "config.h"
+
+// ========================================
+// AT COMMAND ENGINE HEADER
+// ========================================
+// Asynchronous AT command queue for the SIM800L. Commands are queued with
+// the response that completes them, a timeout and an optional completion
+// callback. atEngineUpdate() is called every loop() iteration: it reads
+// what the modem has sent so far, writes as much of the command in flight
+// as the UART takes without blocking, checks it and, once it is finished,
+// starts the next one. Nothing waits for the modem.
+// Received bytes are split into lines (line_tokenizer.h) on the UART
+// event task and handed over through a lock-free queue (line_queue.h);
+// the engine only looks at complete lines. A line that starts
+// with the command's expected response ends it, normally the final "OK"
+// (the callback then parses the information lines collected before it);
+// the "> " SMS prompt is matched without a line end. An ERROR, +CMS ERROR
+// or +CME ERROR line fails the command. Unsolicited result codes (+CREG,
+// +CMTI, RING, ...) go to handlers registered with atOnURC(), except a
+// line that answers the command in flight ("+CREG: 0,1" to AT+CREG?).
+// Echo is expected to be off (ATE0).
+// On a host build (no ARDUINO defined) the UART is replaced by a scripted
+// fake modem that answers commands after a configurable delay.
+
+const int AT_COMMAND_LENGTH = 200;   // Command or data text (SMS body) plus terminator
+const int AT_EXPECT_LENGTH = 32;
+const int AT_RESPONSE_LENGTH = 256;  // Response lines kept for the callback
+const int AT_LINE_LENGTH = 128;      // Longer modem lines are cut
+const int AT_URC_HANDLERS = 8;
+const char AT_CTRL_Z = 0x1A;         // Ends an SMS body
+
+enum ATResult {
+  AT_OK = 0,        // Expected response seen
+  AT_ERROR,         // Modem answered ERROR
+  AT_TIMEOUT,
+  AT_CANCELLED      // Flushed before completion (module reset)
+};
+
+// Called from atEngineUpdate() with the response lines received, '\n' separated
+typedef void (*ATCallback)(ATResult result, const char* response, void* context);
+
+// Called from atEngineUpdate() with the unsolicited line (no CR/LF)
+typedef void (*ATURCHandler)(const char* line);
+
+// Engine counters; latencies are from a line's arrival to its handling
+struct ATEngineStats {
+  uint32_t lines;              // Lines handled
+  uint32_t urcs;               // Lines sent to URC handlers
+  uint32_t unhandled;          // Lines outside a command with no handler
+  uint32_t rxOverflows;        // Bytes lost with the line ring full
+  uint32_t queueDrops;         // Lines lost with the line queue full
+  uint32_t lineLatencyMaxUs;
+  uint64_t lineLatencyTotalUs;
+  uint32_t responseMaxMs;      // Command written to its final line
+  uint32_t writeTimeouts;      // Commands the UART did not take in time
+  uint32_t updateUs;           // Time spent handling lines in atEngineUpdate()
+};
+
+void atEngineBegin();                // After gsmSerial.begin(): starts event-driven receive
+
+// Queueing (false if the queue is full)
+bool atSubmit(const char* command, const char* expect, uint32_t timeoutMs,
+              ATCallback callback = nullptr, void* context = nullptr);
+bool atSubmitData(const char* data, const char* expect, uint32_t timeoutMs,
+                  ATCallback callback = nullptr, void* context = nullptr); // Sent with Ctrl+Z, no CR
+
+// Engine
+void atEngineUpdate(unsigned long nowMs);
+void atEngineFlush();                // Cancel the command in flight and the queue
+bool atEngineBusy();                 // Command in flight or queued
+int atEnginePending();
+const char* atResultName(ATResult result);
+
+// Unsolicited result codes; prefix must stay valid (string literal)
+bool atOnURC(const char* prefix, ATURCHandler handler);
+const ATEngineStats& atEngineStats();
+
+#ifndef ARDUINO
+// Host-side SIM800L stand-in
+void atHostModemReset();
+bool atHostModemRespond(const char* commandPrefix, const char* reply, uint32_t delayMs = 0);
+void atHostModemInject(const char* text);  // Unsolicited output
+int atHostModemWrites();                   // Write chunks, at most one per update
+int atHostModemCommandCount();
+const char* atHostModemCommand(int index); // Lines received, oldest first
+void atHostModemStallTx(bool stalled);     // UART TX buffer reports no space
+#endif
+
+#endif // AT_ENGINE_H
@@ -0,0 +1,51 @@
+#ifndef AUTO_FEED_H
+#define AUTO_FEED_H
+
+#include <stdint.h>
+#include "config.h"
+
+// ========================================
+// AUTOMATIC FEEDING DECISION HEADER
+// ========================================
+// When the feeder feeds on its own: the bowl has to read empty for
+// BOWL_EMPTY_CONFIRMATION_TIME, judged every AUTO_FEED_CHECK_INTERVAL,
+// with at least AUTO_FEED_MIN_INTERVAL between feeds, at most
+// MAX_DAILY_AUTO_FEEDS per day, and AUTO_FEED_RETRY_INTERVAL after a
+// feed the hopper refused. The caller passes the time in, so loop() runs
+// it on millis() and a sensor replay on the recorded timestamps. No
+// Arduino dependencies; the buzzer, SMS and motor stay with the caller.
+
+// autoFeedUpdate() result bits
+const uint8_t AUTO_FEED_CHECKED = 0x01;          // Check interval passed, bowl evaluated
+const uint8_t AUTO_FEED_EMPTY_DETECTED = 0x02;   // Confirmation timer started
+const uint8_t AUTO_FEED_EMPTY_CONFIRMED = 0x04;  // Bowl empty long enough
+const uint8_t AUTO_FEED_DISPENSE = 0x08;         // Feed now, then report autoFeedDispensed/Refused()
+const uint8_t AUTO_FEED_LIMIT_REACHED = 0x10;    // Bowl empty but no automatic feeds left today
+
+struct AutoFeedState {
+  bool enabled;
+  unsigned long lastFeedTime;    // 0 = none yet (first feed not held back)
+  unsigned long lastCheck;
+  unsigned long emptySince;      // 0 = bowl not empty
+  bool confirmed;                // Empty for the confirmation time
+  unsigned long refusedTime;     // Last refused feed (0 = no retry hold)
+  int dailyCount;
+  unsigned long dailyResetTime;
+};
+
+void autoFeedInit(AutoFeedState& state, unsigned long nowMs);
+
+// canFeed: sensor online, no feed running, hopper not empty
+uint8_t autoFeedUpdate(AutoFeedState& state, bool bowlEmpty, bool canFeed, unsigned long nowMs);
+void autoFeedDispensed(AutoFeedState& state, unsigned long nowMs);
+void autoFeedRefused(AutoFeedState& state, unsigned long nowMs);
+
+// Retry hold after a refused feed
+bool autoFeedRetryHeld(const AutoFeedState& state, unsigned long nowMs);
+unsigned long autoFeedRetryIn(const AutoFeedState& state, unsigned long nowMs);
+
+// Daily feed limit (24 hours from the last reset)
+bool autoFeedDailyResetDue(const AutoFeedState& state, unsigned long nowMs);
+void autoFeedDailyReset(AutoFeedState& state, unsigned long nowMs);
+
+#endif // AUTO_FEED_H
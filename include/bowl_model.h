@@ -0,0 +1,45 @@
+#ifndef BOWL_MODEL_H
+#define BOWL_MODEL_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ========================================
+// BOWL GEOMETRY MODEL HEADER
+// ========================================
+// Converts the bowl sensor distance into grams of food remaining. The bowl
+// shape is a lookup table of (distance, volume) points, interpolated
+// linearly, and a food density factor turns volume into grams. The table
+// starts as a straight-walled bowl from config.h and is replaced by
+// a bowl calibration, which measures the level after pouring known volumes
+// (started by startBowlCalibration(), run by updateBowlCalibration()).
+// Profile and density are persisted to NVS.
+
+const int BOWL_PROFILE_MAX_POINTS = 12;
+
+struct BowlProfile {
+  uint8_t points;                             // Valid entries (>= 2)
+  uint16_t distanceMm[BOWL_PROFILE_MAX_POINTS]; // Strictly decreasing (empty bowl first)
+  uint16_t volumeMl[BOWL_PROFILE_MAX_POINTS];   // Increasing, volumeMl[0] = empty
+  float densityGramsPerMl;                    // Food density (kibble bulk density)
+};
+
+// Initialization and persistence
+void initializeBowlModel();
+void resetBowlModel();
+void setFoodDensity(float gramsPerMl);
+
+// Conversions
+float bowlGramsAt(float distanceCm);
+float updateBowlGrams(uint16_t distanceMm);   // Incremental, call per filtered sample
+float getBowlGrams();
+float getBowlCapacityGrams();
+const BowlProfile& getBowlProfile();
+
+// Calibration (non-blocking, updateBowlCalibration() every loop) and debug
+bool startBowlCalibration();
+void updateBowlCalibration();
+bool isBowlCalibrating();
+void printBowlModelStatus();
+
+#endif // BOWL_MODEL_H
@@ -0,0 +1,37 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ========================================
+// DISPENSE CALIBRATION MODULE HEADER
+// ========================================
+// Online steps-per-gram estimator. Each closed-loop feed gives one
+// (steps dispensed, grams measured in the bowl) pair, and a recursive
+// least squares filter with forgetting refines the model
+//   grams = gramsPerKiloStep * steps / 1000
+// Separate models are kept for CAT and DOG mode (different kibble) and
+// persisted to NVS so they survive reboots.
+
+struct DispenseModel {
+  float gramsPerKiloStep;   // Estimated grams per 1000 steps (RLS state)
+  float covariance;         // RLS covariance / noiseVariance (1/kstep^2)
+  float noiseVariance;      // Running measurement noise estimate (g^2)
+  uint32_t samples;         // Accepted measurements
+};
+
+// Initialization and persistence
+void initializeCalibration();
+void resetCalibration();
+
+// Model updates and queries
+bool updateCalibration(FeedingMode mode, int steps, float grams);
+float getStepsPerGram(FeedingMode mode);
+float getCalibrationConfidence(FeedingMode mode);
+const DispenseModel& getDispenseModel(FeedingMode mode);
+
+// Debug functions
+void printCalibrationStatus();
+
+#endif // CALIBRATION_H
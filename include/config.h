@@ -8,11 +8,16 @@
 #define MOTOR_STEP_PIN    2   // GPIO2 - Step signal
 #define MOTOR_DIR_PIN     1   // GPIO1 - Direction signal
 #define MOTOR_ENABLE_PIN  3   // GPIO3 - Enable (active LOW)
+#define MOTOR_FAULT_PIN   -1  // DRV8825 nFAULT (active LOW), -1 if not wired
+#define MOTOR_M0_PIN      4   // GPIO4 - Microstep select M0
+#define MOTOR_M1_PIN      5   // GPIO5 - Microstep select M1
+#define MOTOR_M2_PIN      14  // GPIO14 - Microstep select M2
 
 // === I2C ULTRASONIC SENSOR (RCWL-9620) ===
 #define I2C_SDA_PIN       8   // GPIO8 - SDA
 #define I2C_SCL_PIN       9   // GPIO9 - SCL
 #define ULTRASONIC_ADDR   0x57 // I2C address for RCWL-9620
+#define HOPPER_SENSOR_ADDR 0x58 // Hopper level sensor (second RCWL-9620 with moved address, or equivalent)
 
 // === MANUAL CONTROLS ===
 #define FEED_BUTTON_PIN   10  // GPIO10 - Manual feed button
@@ -31,6 +36,21 @@
 #define BOWL_EMPTY_THRESHOLD    15  // If distance > 15cm, bowl is empty
 #define BOWL_FULL_THRESHOLD     8   // If distance < 8cm, bowl has food
 
+// Bowl geometry model (see bowl_model.h)
+#define BOWL_FLOOR_DISTANCE_CM  16    // Sensor to empty bowl floor (nominal profile)
+#define BOWL_RIM_DISTANCE_CM    6     // Sensor to a level full bowl (nominal profile)
+#define BOWL_FOOD_DENSITY       0.45f // Kibble bulk density in g/ml
+#define BOWL_CALIBRATION_POINTS 6     // Pours measured by the bowl calibration
+#define BOWL_CALIBRATION_STEP_ML 50   // Volume of each calibration pour
+#define BOWL_EMPTY_GRAMS        5     // Bowl counts as empty at or below this
+#define BOWL_HAS_FOOD_GRAMS     20    // Bowl counts as having food at or above this
+
+// Eating-event detection (see eating_monitor.h)
+#define EATING_START_GRAMS      3     // Drop below the reference level that starts a session
+#define EATING_NOISE_GRAMS      1     // Smaller drops do not extend a session
+#define EATING_END_IDLE_MS      90000 // Session ends after this long without a drop
+#define EATING_HISTORY_SESSIONS 2048  // Sessions kept in the PSRAM ring (8 bytes each)
+
 // Feeding portions (in steps - will calibrate in testing)
 #define CAT_MIN_PORTION         500   // ~30g equivalent in motor steps
 #define CAT_MAX_PORTION         1700  // ~100g equivalent in motor steps
@@ -40,18 +60,100 @@
 // Motor settings
 #define MOTOR_SPEED            200   // Steps per second
 #define MOTOR_ACCELERATION     100   // Steps per second^2
+#define MOTOR_START_SPEED      100   // Steps per second the motor starts at without ramping
+#define MOTOR_JERK             400   // Steps per second^3 (S-curve profile only)
+#define DISPENSE_PROFILE       PROFILE_TRAPEZOID // Profile used for feeding (PROFILE_TRAPEZOID / PROFILE_SCURVE)
+
+// Microstep switching (DRV8825 M0-M2). Portions, speeds and step counts are
+// in coarse steps; the motor position is kept in fine microsteps.
+#define MICROSTEP_COARSE       1     // Resolution for ramp and cruise (1 = full step)
+#define MICROSTEP_FINE         8     // Resolution for the end of a dispense (1/8 step)
+#define MICROSTEP_FINISH_STEPS 40    // Last coarse steps of a dispense run fine (0 = off)
+
+// Closed-loop dispensing (bowl sensor is read between chunks)
+#define CLOSED_LOOP_DISPENSE        1     // 1 = feeds stop early once the bowl is filled
+#define CLOSED_LOOP_CHUNK_STEPS     340   // Steps per chunk (~20g)
+#define CLOSED_LOOP_SETTLE_TIME     500   // ms for kibble to settle before measuring
+#define CLOSED_LOOP_TARGET_DISTANCE BOWL_FULL_THRESHOLD // Stop once food is this close (cm)
+
+// Jam detection and recovery (closed-loop feeds)
+#define JAM_DETECT_STEPS            680   // Steps without bowl level change before a jam is assumed
+#define JAM_MIN_LEVEL_CHANGE_CM     0.2f  // Smallest level rise that counts as food arriving
+#define JAM_AGITATE_STEPS           50    // Steps per reverse/forward stroke
+#define JAM_AGITATE_CYCLES          3     // Stroke pairs per recovery attempt
+#define JAM_MAX_RECOVERIES          3     // Recovery attempts before SMS_FEEDING_ERROR
+
+// Dispense calibration (online steps-per-gram estimate)
+#define DEFAULT_STEPS_PER_GRAM      17.0f // Factory estimate until feeds are measured
+#define BOWL_GRAMS_PER_CM           25.0f // Food mass per cm of bowl level (nominal bowl)
+#define CALIBRATION_FORGETTING      0.95f // RLS forgetting factor (1.0 = never forget)
+#define CALIBRATION_MIN_DELTA_CM    0.5f  // Smallest bowl level change used as a sample
+
+// Motion task (owns the stepper driver)
+#define MOTION_TASK_CORE       0     // loop() runs on core 1
+#define MOTION_TASK_PRIORITY   10    // Above loop() (priority 1)
+#define MOTION_TASK_STACK      4096  // Bytes
+#define MOTION_QUEUE_LENGTH    8     // Pending move commands / events
+#define MOTOR_DUTY_WINDOW_MS   (10 * 60 * 1000UL) // Rolling window for the motor duty cycle
+#define MOTOR_DUTY_BUCKETS     60    // Window resolution (10 s buckets)
+
+// I2C bus manager task (owns Wire)
+#define I2C_BUS_CLOCK          50000 // 50kHz for better stability with RCWL-9620
+#define I2C_BUS_TIMEOUT        1000  // Wire timeout in ms
+#define I2C_TASK_CORE          1     // Same core as loop(), its only client
+#define I2C_TASK_PRIORITY      5     // Above loop(), below the motion task
+#define I2C_TASK_STACK         3072  // Bytes
+#define I2C_QUEUE_LENGTH       8     // Pending transactions
+#define I2C_MAX_RETRIES        1     // Retries after a bus recovery
 
 // Timing
 #define DEBOUNCE_DELAY         50    // Button debounce in ms
-#define SENSOR_READ_INTERVAL   1000  // Ultrasonic read interval in ms
+#define SENSOR_READ_INTERVAL   1000  // Ultrasonic read interval in ms (normal cadence)
+
+// Adaptive sensor sampling (interval follows the system state)
+#define SENSOR_FEEDING_INTERVAL    200   // ms while DISPENSING / MANUAL_FEEDING
+#define SENSOR_ACTIVE_INTERVAL     500   // ms right after the bowl level changed
+#define SENSOR_IDLE_INTERVAL       5000  // ms once the level has been stable for a long time
+#define SENSOR_ACTIVITY_MM         5     // Filtered level change that counts as activity
+#define SENSOR_ACTIVITY_HOLD       (2 * 60 * 1000UL)  // Stay fast this long after a change
+#define SENSOR_IDLE_AFTER          (15 * 60 * 1000UL) // Stable this long before slowing down
+#define SENSOR_CONVERSION_TIME 80    // RCWL-9620 trigger-to-data time in ms
+
+// Bowl level filter (see level_filter.h)
+#define BOWL_FILTER_MEDIAN_WINDOW  5     // Median of the last N readings (1 = off)
+#define BOWL_FILTER_OUTLIER_MM     40    // Drop readings this far from the median (0 = off)
+#define BOWL_FILTER_EMA_SHIFT      2     // EMA alpha = 1/4 (0 = off)
+
+// Sensor health report
+#define SENSOR_HEALTH_MIN_CYCLES        100   // Cycles before a sensor can be flagged
+#define SENSOR_HEALTH_MIN_GOOD_PERCENT  90.0f // Flag a sensor below this share of good reads
+
+// Bowl sensor trace (see sensor_trace.h)
+#define SENSOR_TRACE_BYTES         (64 * 1024UL) // PSRAM ring, ~4 h at the normal rate
 
 // Phase 4: Automatic Feeding Configuration
 #define AUTO_FEED_MIN_INTERVAL     (2 * 60 * 1000UL)   // 2 minutes minimum between auto feeds (testing)
 #define AUTO_FEED_CHECK_INTERVAL   5000                     // Check for feeding every 5 seconds (testing)
+#define AUTO_FEED_RETRY_INTERVAL   (5 * 60 * 1000UL)   // Retry after a feed refused for a low hopper
 #define MAX_DAILY_AUTO_FEEDS       8                    // Maximum automatic feeds per day
 #define BOWL_EMPTY_CONFIRMATION_TIME 60000              // Bowl must be empty for 1 minute before auto feed
 #define FEEDING_TIMEOUT            30000                // Maximum time for a feeding operation (30 sec)
 #define HOPPER_CHECK_INTERVAL  30000 // Check hopper every 30 seconds
+#define HOPPER_FEEDING_INTERVAL 1000 // Check hopper every second while the auger runs
+
+// Hopper level (sensor in the lid, looking down at the food)
+#define HOPPER_FULL_DISTANCE_CM    5.0f  // Reading with the hopper filled to the top
+#define HOPPER_EMPTY_DISTANCE_CM   25.0f // Reading with food only down in the auger inlet
+#define HOPPER_CAPACITY_GRAMS      1500  // Food between the empty and full marks
+#define HOPPER_EMPTY_GRAMS         30    // Below this the auger would run dry
+#define HOPPER_REFILLED_GRAMS      100   // Leave ALERT_EMPTY_HOPPER above this
+#define HOPPER_TOPUP_GRAMS         100   // Sensor level rise that counts as a refill
+
+// Hopper inventory (dead reckoning, see inventory.h)
+#define INVENTORY_RATE_DAYS        7     // Days averaged for the consumption rate
+#define INVENTORY_LOW_GRAMS        150   // Low-hopper SMS at or below this...
+#define INVENTORY_LOW_DAYS         2.0f  // ...or when predicted to run out within this
+#define INVENTORY_SAVE_GRAMS       50    // NVS write during a feed after this much travel
 
 // Phase 5: GSM/SMS Configuration
 #define GSM_BAUD_RATE             9600                  // SIM800L communication speed
@@ -59,6 +161,14 @@
 #define GSM_STATUS_CHECK_INTERVAL 10000                 // Check GSM status every 10 seconds
 #define SMS_SEND_TIMEOUT          15000                 // SMS sending timeout
 #define GSM_AT_TIMEOUT            5000                  // AT command response timeout
+#define GSM_BOOT_TIME             3000                  // Wait after a reset before the first AT command
+#define GSM_LINK_CHECK_INTERVAL   60000                 // "AT" ping while SMS ready
+#define GSM_RECOVERY_INTERVAL     30000                 // Reset attempts from GSM_ERROR
+#define AT_QUEUE_LENGTH           8                     // AT commands waiting in the engine
+#define AT_RX_BUDGET              64                    // Modem bytes read per receive chunk
+#define AT_TX_BUDGET              32                    // Modem bytes written per atEngineUpdate()
+#define GSM_LINE_QUEUE_LENGTH     16                    // Received modem lines waiting for loop() (power of two)
+#define SMS_OUTBOX_CAPACITY       256                   // Queued SMS (PSRAM slots, see sms_outbox.h)
 
 // System states
 enum FeedingMode {
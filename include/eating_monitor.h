@@ -0,0 +1,48 @@
+#ifndef EATING_MONITOR_H
+#define EATING_MONITOR_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ========================================
+// EATING MONITOR HEADER
+// ========================================
+// Streaming detector over the bowl grams signal. A session starts when the
+// bowl loses EATING_START_GRAMS below its reference level outside a feed,
+// and ends once no further drop is seen for EATING_END_IDLE_MS. Finished
+// sessions go into a ring in PSRAM, and the daily totals are updated as
+// each session closes, so nothing is rescanned.
+
+// One finished session (8 bytes)
+struct EatingSession {
+  uint32_t startSeconds;   // Uptime at the start of the session
+  uint16_t durationSeconds;
+  uint16_t gramsTenths;    // Grams eaten x 10
+};
+
+// Running totals for one day
+struct EatingDay {
+  uint16_t sessions;
+  float grams;
+  uint32_t eatingSeconds;
+  float fastestRate;       // Highest session rate (g/min)
+};
+
+// Initialization and updates
+void initializeEatingMonitor();
+void updateEatingMonitor(float grams, unsigned long nowMs, bool feeding);
+void rollEatingDay();      // Close today's totals (called at the daily reset)
+
+// Queries
+bool isPetEating();
+int getEatingSessionCount();                       // Sessions held in the ring
+bool getEatingSession(int index, EatingSession& session); // 0 = most recent
+const EatingDay& getEatingToday();
+const EatingDay& getEatingYesterday();
+float getEatingRate(const EatingDay& day);         // Average g/min while eating
+
+// Reporting
+void printEatingStatus();
+void sendEatingSummarySMS();
+
+#endif // EATING_MONITOR_H
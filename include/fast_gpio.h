@@ -0,0 +1,92 @@
+#ifndef FAST_GPIO_H
+#define FAST_GPIO_H
+
+#include <stdint.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include "soc/gpio_struct.h"
+#endif
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+// ========================================
+// FAST GPIO HEADER
+// ========================================
+// Compile-time output pins for the step loop. The pin number is a template
+// parameter, so set()/clear() compile down to a single write to the
+// ESP32-S3 GPIO set/clear register (no Arduino pin lookup, no branches).
+// pinMode() is still used once for configuration.
+// On a host build (no ARDUINO defined) the pins write to a recording fake
+// so the pin levels and edge counts can be checked on Linux.
+
+const int FAST_GPIO_PIN_COUNT = 49; // ESP32-S3: GPIO0..GPIO48
+
+#ifndef ARDUINO
+// Host-side pin state (inline variables: one instance for all translation units)
+inline uint8_t fastGpioHostLevels[FAST_GPIO_PIN_COUNT] = {};
+inline uint32_t fastGpioHostRises[FAST_GPIO_PIN_COUNT] = {};
+inline uint32_t fastGpioHostWrites[FAST_GPIO_PIN_COUNT] = {};
+
+inline void fastGpioHostWrite(int pin, bool high) {
+  if (high && !fastGpioHostLevels[pin]) fastGpioHostRises[pin]++;
+  fastGpioHostLevels[pin] = high ? 1 : 0;
+  fastGpioHostWrites[pin]++;
+}
+
+inline bool fastGpioHostLevel(int pin) { return fastGpioHostLevels[pin] != 0; }
+inline uint32_t fastGpioHostRiseCount(int pin) { return fastGpioHostRises[pin]; }
+inline uint32_t fastGpioHostWriteCount(int pin) { return fastGpioHostWrites[pin]; }
+
+inline void fastGpioHostReset() {
+  for (int i = 0; i < FAST_GPIO_PIN_COUNT; i++) {
+    fastGpioHostLevels[i] = 0;
+    fastGpioHostRises[i] = 0;
+    fastGpioHostWrites[i] = 0;
+  }
+}
+#endif
+
+template <int Pin>
+struct FastOutputPin {
+  static_assert(Pin >= 0 && Pin < FAST_GPIO_PIN_COUNT, "FastOutputPin needs a valid GPIO number");
+
+  static void begin() {
+#ifdef ARDUINO
+    pinMode(Pin, OUTPUT);
+#endif
+  }
+
+  static inline void IRAM_ATTR set() {
+#ifdef ARDUINO
+    if constexpr (Pin < 32) {
+      GPIO.out_w1ts = (1UL << Pin);
+    } else {
+      GPIO.out1_w1ts.val = (1UL << (Pin - 32));
+    }
+#else
+    fastGpioHostWrite(Pin, true);
+#endif
+  }
+
+  static inline void IRAM_ATTR clear() {
+#ifdef ARDUINO
+    if constexpr (Pin < 32) {
+      GPIO.out_w1tc = (1UL << Pin);
+    } else {
+      GPIO.out1_w1tc.val = (1UL << (Pin - 32));
+    }
+#else
+    fastGpioHostWrite(Pin, false);
+#endif
+  }
+
+  static inline void IRAM_ATTR write(bool high) {
+    if (high) set();
+    else clear();
+  }
+};
+
+#endif // FAST_GPIO_H
@@ -28,7 +28,9 @@ enum SMSAlertType {
   SMS_FEEDING_ERROR,        // HIGH PRIORITY - system failures
   SMS_DAILY_RESET,          // MEDIUM PRIORITY - daily events
   SMS_BOWL_EMPTY_ALERT,     // MEDIUM PRIORITY - status warnings
-  SMS_SYSTEM_STATUS         // LOW PRIORITY - routine monitoring
+  SMS_SYSTEM_STATUS,        // LOW PRIORITY - routine monitoring
+  SMS_EATING_SUMMARY,       // LOW PRIORITY - daily eating report
+  SMS_HOPPER_LOW            // MEDIUM PRIORITY - refill prediction
 };
 
 // SMS priority levels
@@ -44,6 +46,7 @@ bool isGSMReady();
 GSMStatus getGSMStatus();
 void updateGSMStatus();
 void resetGSMModule();
+void deferGSMTraffic(unsigned long durationMs); // Hold SMS sends and link probes (e.g. for a planned feed)
 
 // SMS functions (priority-based, non-blocking)
 void sendSMSAlert(SMSAlertType alertType);
@@ -62,7 +65,6 @@ void testGSMModule();
 bool checkNetworkConnection();
 
 // Internal helper functions (declared for completeness)
-bool sendATCommand(const char* command, const char* expectedResponse, unsigned long timeout = 5000);
 void processGSMResponse();
 String formatPhoneNumber(const char* number);
 
@@ -0,0 +1,34 @@
+#ifndef HOPPER_H
+#define HOPPER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ========================================
+// HOPPER LEVEL HEADER
+// ========================================
+// Second ultrasonic channel looking down into the hopper. It is measured
+// every HOPPER_CHECK_INTERVAL (every HOPPER_FEEDING_INTERVAL while the
+// auger runs), only while the bowl channel is idle, so the two sensors
+// never ping at the same time and the bowl cadence is unchanged. The
+// reading is turned into grams left between the empty and full marks.
+// Below HOPPER_EMPTY_GRAMS the system enters ALERT_EMPTY_HOPPER and the
+// motor module refuses dispense moves until the hopper is refilled. The
+// first refused move sends a low-hopper SMS.
+
+// Initialization and updates
+void initializeHopperSensor();
+void updateHopperLevel();            // Call every loop() iteration
+
+// Queries
+bool isHopperMonitored();            // Sensor ACKed at start-up and has a reading
+bool isHopperEmpty();
+float getHopperDistance();           // Filtered reading (cm, -1 if none yet)
+float getHopperGrams();              // Food left (-1 if unknown)
+int getHopperPercent();              // 0-100 (-1 if unknown)
+bool hopperCanDispense(float grams); // Would a move of this size leave food in the hopper?
+
+// Reporting
+void printHopperStatus();
+
+#endif // HOPPER_H
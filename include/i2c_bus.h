@@ -0,0 +1,72 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ========================================
+// I2C BUS MANAGER HEADER
+// ========================================
+// One task owns Wire. Clients hand it transactions (write, read, or write
+// then read) through a queue and poll for completion, so several devices
+// can share the bus without knowing about each other's timing. A bus
+// error triggers a structured recovery: SCL is clocked until the slave
+// releases SDA, a STOP is generated and Wire is restarted at the normal
+// clock. Every device gets its own error and latency counters.
+
+const int I2C_MAX_WRITE = 4;     // Bytes per write phase
+const int I2C_MAX_READ = 8;      // Bytes per read phase
+const int I2C_MAX_DEVICES = 4;   // Addresses with their own statistics
+const int I2C_ERROR_CODES = 7;   // Wire codes 0-5 plus I2C_ERROR_SHORT_READ
+
+// Wire endTransmission() codes, plus one for reads
+const uint8_t I2C_ERROR_NACK_ADDRESS = 2;
+const uint8_t I2C_ERROR_NACK_DATA = 3;
+const uint8_t I2C_ERROR_OTHER = 4;
+const uint8_t I2C_ERROR_TIMEOUT = 5;
+const uint8_t I2C_ERROR_SHORT_READ = 6;  // Fewer bytes than requested
+
+enum I2CTransactionState {
+  I2C_IDLE = 0,        // Not submitted (or result already taken)
+  I2C_QUEUED,
+  I2C_DONE
+};
+
+// Client-owned transaction; must stay valid until it is I2C_DONE
+struct I2CTransaction {
+  uint8_t address;
+  uint8_t writeLength;
+  uint8_t writeData[I2C_MAX_WRITE];
+  uint8_t readLength;
+  uint8_t readData[I2C_MAX_READ];   // Filled by the bus task
+  uint8_t bytesRead;
+  uint8_t error;                    // 0 = success
+  uint8_t attempts;                 // 1 + retries after bus recovery
+  uint32_t queuedUs;                // Submit to start of transfer
+  uint32_t transferUs;              // Bus time of the last attempt
+  uint32_t doneUs;                  // micros() when the bus task finished it
+  volatile I2CTransactionState state;
+};
+
+struct I2CDeviceStats {
+  uint8_t address;                  // 0 = unused slot
+  uint32_t transactions;
+  uint32_t errors[I2C_ERROR_CODES]; // Indexed by error code (0 = success)
+  uint32_t retries;
+  uint32_t latencySumUs;            // Transfer time of successful transactions
+  uint32_t latencyMaxUs;
+  uint32_t queueMaxUs;
+};
+
+// Bus control
+bool initializeI2CBus();
+bool i2cSubmit(I2CTransaction& txn);
+bool i2cTransfer(I2CTransaction& txn, unsigned long timeoutMs = 100); // Blocking (start-up only)
+bool i2cProbe(uint8_t address);
+
+// Statistics
+bool getI2CDeviceStats(uint8_t address, I2CDeviceStats& stats);
+uint32_t getI2CBusRecoveries();
+void printI2CBusStatus();
+
+#endif // I2C_BUS_H
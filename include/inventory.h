@@ -0,0 +1,44 @@
+#ifndef INVENTORY_H
+#define INVENTORY_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ========================================
+// HOPPER INVENTORY HEADER
+// ========================================
+// Dead-reckoning estimate of the food left in the hopper. The net auger
+// travel (getMotorPosition()) is converted to grams with the steps-per-gram
+// model of the current mode and subtracted from the amount put in at the
+// last refill. Grams dispensed per day are kept for the last
+// INVENTORY_RATE_DAYS days and give the consumption rate used to project
+// when the hopper runs out. The state is stored in NVS when a feed ends
+// (or every INVENTORY_SAVE_GRAMS during one), so it survives a reboot;
+// travel not yet saved is lost.
+
+struct InventoryState {
+  float refillGrams;                      // Hopper content at the last refill
+  float dispensedGrams;                   // Dispensed since the last refill
+  float dailyGrams[INVENTORY_RATE_DAYS];  // Completed days (ring)
+  uint8_t dayHead;                        // Next ring slot to write
+  uint8_t dayCount;                       // Completed days held
+  float todayGrams;                       // Dispensed since the last day roll
+  bool lowAlertSent;                      // One low-hopper SMS per refill
+};
+
+// Initialization and updates
+void initializeInventory();
+void updateInventory();                   // Call every loop() iteration
+void markHopperRefilled(float grams = HOPPER_CAPACITY_GRAMS);
+void rollInventoryDay();                  // Called at the daily reset
+
+// Queries
+float getInventoryGrams();                // Estimated food left
+float getInventoryDailyRate();            // Grams per day (-1 until known)
+float getDaysUntilEmpty();                // -1 until the rate is known
+const InventoryState& getInventoryState();
+
+// Reporting
+void printInventoryStatus();
+
+#endif // INVENTORY_H
@@ -0,0 +1,59 @@
+#ifndef LEVEL_FILTER_H
+#define LEVEL_FILTER_H
+
+#include <stdint.h>
+#include "config.h"
+
+// ========================================
+// LEVEL FILTER HEADER
+// ========================================
+// Filter chain for ultrasonic level readings. Raw samples (in mm) pass
+// through three stages, each of which can be switched off in the config:
+//   1. Outlier rejection: a sample further than outlierMm from the current
+//      median is dropped, unless a whole window of them reads within
+//      outlierMm of each other (food really was added or eaten). Scattered
+//      bad echoes never re-seed the filter.
+//   2. Median of the last medianWindow accepted samples (ring buffer).
+//   3. Exponential moving average of the median, alpha = 1 / 2^emaShift.
+// All math is integer (EMA kept in Q8 fixed point) and the state is a
+// fixed-size struct, so there is no heap use and it runs on the host.
+
+const int LEVEL_FILTER_MAX_WINDOW = 9;
+
+struct LevelFilterConfig {
+  uint8_t medianWindow;   // Samples in the median (1 = off, max LEVEL_FILTER_MAX_WINDOW)
+  uint16_t outlierMm;     // Rejection distance from the median (0 = off)
+  uint8_t emaShift;       // EMA alpha = 1 / 2^emaShift (0 = off)
+};
+
+struct LevelFilter {
+  LevelFilterConfig config;
+  uint16_t ring[LEVEL_FILTER_MAX_WINDOW]; // Accepted samples, oldest overwritten
+  uint8_t head;           // Next ring slot to write
+  uint8_t count;          // Valid samples in the ring
+  uint16_t rejectRing[LEVEL_FILTER_MAX_WINDOW]; // Current run of rejected samples
+  uint8_t rejectStreak;   // Consecutive rejected samples that cluster
+  uint16_t rawMm;         // Last sample seen (accepted or not)
+  uint16_t medianMm;      // Output of the median stage
+  int32_t emaQ8;          // Output of the EMA stage, mm * 256
+  uint32_t accepted;
+  uint32_t rejected;
+};
+
+// Default chain from config.h
+const LevelFilterConfig DEFAULT_LEVEL_FILTER = {
+  BOWL_FILTER_MEDIAN_WINDOW, BOWL_FILTER_OUTLIER_MM, BOWL_FILTER_EMA_SHIFT
+};
+
+// Filter control
+void levelFilterInit(LevelFilter& filter, const LevelFilterConfig& config = DEFAULT_LEVEL_FILTER);
+void levelFilterReset(LevelFilter& filter);
+bool levelFilterAdd(LevelFilter& filter, uint16_t sampleMm);
+
+// Filter outputs
+bool levelFilterReady(const LevelFilter& filter);
+uint16_t levelFilterRawMm(const LevelFilter& filter);
+uint16_t levelFilterMedianMm(const LevelFilter& filter);
+uint16_t levelFilterValueMm(const LevelFilter& filter);
+
+#endif // LEVEL_FILTER_H
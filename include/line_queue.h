@@ -0,0 +1,33 @@
+#ifndef LINE_QUEUE_H
+#define LINE_QUEUE_H
+
+#include <stdint.h>
+#include <atomic>
+#include "config.h"
+
+// ========================================
+// LINE QUEUE HEADER
+// ========================================
+// Lock-free single-producer / single-consumer queue of modem lines. The
+// UART receive side pushes each complete line with the time it arrived;
+// the AT engine pops them from loop(). Each index is written by one side
+// only, with release/acquire ordering, so neither side ever blocks or
+// takes a lock. A full queue drops the new line and counts it. No Arduino
+// dependencies.
+
+const int LINE_QUEUE_LINE_LENGTH = 128;
+
+struct LineQueue {
+  char lines[GSM_LINE_QUEUE_LENGTH][LINE_QUEUE_LINE_LENGTH];
+  uint32_t stampUs[GSM_LINE_QUEUE_LENGTH];   // Arrival time of each line
+  std::atomic<uint32_t> head;                // Written by the producer
+  std::atomic<uint32_t> tail;                // Written by the consumer
+  std::atomic<uint32_t> dropped;
+};
+
+void lineQueueInit(LineQueue& queue);
+bool lineQueuePush(LineQueue& queue, const char* line, uint32_t stampUs);   // Producer
+bool lineQueuePop(LineQueue& queue, char* line, int maxLength, uint32_t& stampUs);  // Consumer
+bool lineQueueEmpty(const LineQueue& queue);
+
+#endif // LINE_QUEUE_H
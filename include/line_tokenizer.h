@@ -0,0 +1,33 @@
+#ifndef LINE_TOKENIZER_H
+#define LINE_TOKENIZER_H
+
+#include <stdint.h>
+
+// ========================================
+// LINE TOKENIZER HEADER
+// ========================================
+// Splits the SIM800L's output into lines as it arrives. Bytes go into a
+// fixed ring; lineTokenizerNext() hands out each complete line without
+// its CR/LF (empty lines are skipped), scanning every byte once. The SMS
+// "> " prompt never gets a line end, so the unfinished line can be
+// checked for it. Overlong lines are cut at the caller's buffer size;
+// bytes that do not fit the ring are dropped and counted. No heap use,
+// no Arduino dependencies.
+
+const int LINE_TOKENIZER_BYTES = 256;   // Power of two
+
+struct LineTokenizer {
+  char ring[LINE_TOKENIZER_BYTES];
+  uint16_t head;           // Free-running write index
+  uint16_t tail;           // Start of the unfinished line
+  uint16_t scanned;        // Bytes from tail already checked for a line end
+  uint32_t overflows;      // Bytes dropped with the ring full
+};
+
+void lineTokenizerInit(LineTokenizer& tokenizer);
+int lineTokenizerWrite(LineTokenizer& tokenizer, const char* data, int length);  // Bytes taken
+bool lineTokenizerNext(LineTokenizer& tokenizer, char* line, int maxLength);
+bool lineTokenizerPrompt(const LineTokenizer& tokenizer);  // Unfinished line is "> "
+void lineTokenizerSkipPartial(LineTokenizer& tokenizer);   // Drop the unfinished line
+
+#endif // LINE_TOKENIZER_H
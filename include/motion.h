@@ -0,0 +1,87 @@
+#ifndef MOTION_H
+#define MOTION_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "motion_profile.h"
+#include "step_engine.h"
+
+// ========================================
+// MOTION SUBSYSTEM HEADER
+// ========================================
+// The motion task owns the stepper driver. It runs pinned to its own core
+// at high priority and executes move commands from a queue, so motor
+// timing is independent of GSM traffic and Serial printing in loop().
+// Every command produces one completion event that loop() picks up with
+// pollMotionEvent().
+
+// Commands accepted by the motion task
+enum MotionCommandType {
+  MOTION_DISPENSE = 0,   // Clockwise move (dispenses food)
+  MOTION_REVERSE,        // Counter-clockwise move
+  MOTION_AGITATE,        // Reverse/forward strokes to loosen kibble
+  MOTION_STOP            // Abort everything and release the driver
+};
+
+struct MotionCommand {
+  MotionCommandType type;
+  int steps;                  // Steps per move (per stroke for AGITATE)
+  int cycles;                 // AGITATE only: reverse/forward stroke pairs
+  int maxSpeed;               // Steps per second
+  int acceleration;           // Steps per second^2
+  MotionProfileType profile;
+  uint32_t id;                // Assigned by queueMotionCommand()
+};
+
+// Completion events reported back to loop()
+enum MotionEventType {
+  MOTION_EVENT_COMPLETED = 0, // Command ran to the end
+  MOTION_EVENT_STOPPED,       // Command aborted by motionStop()
+  MOTION_EVENT_FAILED         // Step engine rejected the move
+};
+
+struct MotionEvent {
+  MotionEventType type;
+  MotionCommandType command;
+  uint32_t id;
+  int stepsRequested;
+  int stepsMoved;             // Net forward steps (negative when reversing)
+  unsigned long durationMs;
+  bool driverFault;           // DRV8825 nFAULT was asserted after the move
+};
+
+// Subsystem control
+bool initializeMotion();
+uint32_t queueMotionCommand(MotionCommand command);
+uint32_t motionDispense(int steps, int maxSpeed = MOTOR_SPEED, int acceleration = MOTOR_ACCELERATION,
+                        MotionProfileType profile = DISPENSE_PROFILE);
+uint32_t motionReverse(int steps, int maxSpeed = MOTOR_SPEED);
+uint32_t motionAgitate(int steps, int cycles);
+void motionStop();
+
+// Events and status
+bool pollMotionEvent(MotionEvent& event);
+bool isMotionBusy();
+int getMotionQueueDepth();
+long getMotorPosition();      // Fine microsteps since boot (clockwise positive)
+uint32_t getMotionEventsDropped();
+
+// Predicted cost of a command, from the tables the step engine clocks
+struct MoveEstimate {
+  uint64_t durationUs;        // Timer time from DIR setup to the end of the last interval
+  uint32_t pulses;            // STEP pulses (fine microsteps count individually)
+};
+
+// Profile construction (motion task only for non-default speeds)
+StepProfile buildStepProfile(MotionProfileType type, int maxSpeed, int acceleration);
+
+// Move estimation (safe from loop(), any speed)
+MoveEstimate estimateMotionCommand(const MotionCommand& cmd);
+MoveEstimate estimateDispenseMove(int steps, int maxSpeed = MOTOR_SPEED, int acceleration = MOTOR_ACCELERATION,
+                                  MotionProfileType profile = DISPENSE_PROFILE);
+
+// Motor duty (rolling MOTOR_DUTY_WINDOW_MS window)
+float getMotorDutyCycle();
+unsigned long getMotorMovingTime(); // ms spent moving since boot
+
+#endif // MOTION_H
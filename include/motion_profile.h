@@ -0,0 +1,245 @@
+#ifndef MOTION_PROFILE_H
+#define MOTION_PROFILE_H
+
+#include <stdint.h>
+#include <array>
+#include "config.h"
+
+// ========================================
+// MOTION PROFILE MODULE HEADER
+// ========================================
+// Step-interval tables for constant-acceleration (trapezoidal) moves,
+// following the AVR446 / D. Austin approach: the time at which step n is
+// reached under constant acceleration is solved exactly, and the interval
+// between consecutive steps is stored in a table. Tables for the default
+// MOTOR_SPEED / MOTOR_ACCELERATION are generated at compile time so the
+// step ISR only does a lookup.
+// Jerk-limited (S-curve) ramps use the same table format: acceleration
+// itself ramps up and down at MOTOR_JERK, so the torque demand has no
+// corners at the start and end of the ramp.
+// Header-only (constexpr) and free of Arduino dependencies so the same
+// math runs on the host.
+
+// Selectable speed profile for a move
+enum MotionProfileType {
+  PROFILE_TRAPEZOID = 0,  // Constant acceleration
+  PROFILE_SCURVE,         // Jerk-limited acceleration
+  PROFILE_CONSTANT        // Fixed step rate, no ramp (test moves)
+};
+
+// Step rate limits (microseconds between full steps). MIN_STEP_DELAY is
+// the motor limit the feeder was built and run with; fast_gpio.h removed
+// the pin access cost, not the motor's torque limit, so it stays until a
+// faster rate is measured on the auger. Fine microstep pulses may come
+// MICROSTEPS_PER_STEP times as often (same rotor speed, see step_engine.cpp).
+const unsigned long MIN_STEP_DELAY = 1000;  // Max speed limit (1000 Hz)
+const unsigned long MAX_STEP_DELAY = 10000; // Min speed limit (100 Hz)
+
+// Square root usable in constant expressions (Newton iteration)
+constexpr double profileSqrt(double x) {
+  if (x <= 0.0) return 0.0;
+  double r = (x > 1.0) ? x : 1.0;
+  for (int i = 0; i < 100; i++) {
+    double next = 0.5 * (r + x / r);
+    if (next == r) break;
+    r = next;
+  }
+  return r;
+}
+
+// Steps needed to accelerate from startSpeed to maxSpeed (steps/s, steps/s^2)
+constexpr int trapezoidRampLength(double maxSpeed, double startSpeed, double acceleration) {
+  if (maxSpeed <= startSpeed || acceleration <= 0.0) return 0;
+  double steps = (maxSpeed * maxSpeed - startSpeed * startSpeed) / (2.0 * acceleration);
+  int whole = (int)steps;
+  return (steps > whole) ? whole + 1 : whole;
+}
+
+// Time (seconds) at which step n is reached: s = v0*t + a*t^2/2 solved for t
+constexpr double trapezoidStepTime(int n, double startSpeed, double acceleration) {
+  return (profileSqrt(startSpeed * startSpeed + 2.0 * acceleration * n) - startSpeed) / acceleration;
+}
+
+// Interval (us) between ramp step n and n+1
+constexpr uint32_t trapezoidInterval(int n, double startSpeed, double acceleration) {
+  double dt = trapezoidStepTime(n + 1, startSpeed, acceleration) -
+              trapezoidStepTime(n, startSpeed, acceleration);
+  return (uint32_t)(dt * 1000000.0 + 0.5);
+}
+
+// Fill a ramp table at run time (same math as the compile-time tables)
+constexpr void fillTrapezoidRamp(uint32_t* table, int length, double startSpeed, double acceleration) {
+  for (int i = 0; i < length; i++) {
+    table[i] = trapezoidInterval(i, startSpeed, acceleration);
+  }
+}
+
+// Compile-time ramp table for a given speed/acceleration pair
+template <int MaxSpeed, int Acceleration, int StartSpeed = MOTOR_START_SPEED>
+struct TrapezoidRamp {
+  static constexpr int length = trapezoidRampLength(MaxSpeed, StartSpeed, Acceleration);
+  static constexpr uint32_t cruiseDelay = 1000000UL / MaxSpeed;
+
+  static constexpr std::array<uint32_t, length> build() {
+    std::array<uint32_t, length> table{};
+    for (int i = 0; i < length; i++) {
+      table[i] = trapezoidInterval(i, StartSpeed, Acceleration);
+    }
+    return table;
+  }
+
+  static constexpr std::array<uint32_t, length> table = build();
+};
+
+// ========================================
+// S-CURVE (JERK-LIMITED) RAMPS
+// ========================================
+
+// Phase boundaries of a jerk-limited ramp from startSpeed to maxSpeed:
+// jerk up to peak acceleration, hold it, jerk back down to zero.
+// If maxSpeed is too close to startSpeed the hold phase disappears and
+// the peak acceleration is reduced.
+struct SCurvePhases {
+  double v0;      // Start speed (steps/s)
+  double peak;    // Peak acceleration actually reached (steps/s^2)
+  double jerk;    // Jerk (steps/s^3)
+  double t1;      // Duration of each jerk phase (s)
+  double t2;      // Duration of the constant-acceleration phase (s)
+  double s1, v1;  // Position/speed at end of phase 1
+  double s2, v2;  // Position/speed at end of phase 2
+  double s3;      // Ramp length (steps, fractional)
+  double vmax;    // Cruise speed (steps/s)
+};
+
+constexpr SCurvePhases scurvePhases(double maxSpeed, double startSpeed, double acceleration, double jerk) {
+  SCurvePhases p{};
+  p.v0 = startSpeed;
+  p.vmax = maxSpeed;
+  p.jerk = jerk;
+  double dv = maxSpeed - startSpeed;
+  if (dv <= 0.0 || acceleration <= 0.0 || jerk <= 0.0) return p;
+
+  p.peak = acceleration;
+  if (dv < acceleration * acceleration / jerk) {
+    p.peak = profileSqrt(dv * jerk);
+  }
+  p.t1 = p.peak / jerk;
+  p.t2 = dv / p.peak - p.t1;
+  if (p.t2 < 0.0) p.t2 = 0.0;
+
+  p.v1 = p.v0 + jerk * p.t1 * p.t1 / 2.0;
+  p.s1 = p.v0 * p.t1 + jerk * p.t1 * p.t1 * p.t1 / 6.0;
+  p.v2 = p.v1 + p.peak * p.t2;
+  p.s2 = p.s1 + p.v1 * p.t2 + p.peak * p.t2 * p.t2 / 2.0;
+  p.s3 = p.s2 + p.v2 * p.t1 + p.peak * p.t1 * p.t1 / 2.0 - jerk * p.t1 * p.t1 * p.t1 / 6.0;
+  return p;
+}
+
+// Position (steps) reached t seconds into the ramp
+constexpr double scurvePosition(const SCurvePhases& p, double t) {
+  if (t <= p.t1) {
+    return p.v0 * t + p.jerk * t * t * t / 6.0;
+  }
+  if (t <= p.t1 + p.t2) {
+    double tau = t - p.t1;
+    return p.s1 + p.v1 * tau + p.peak * tau * tau / 2.0;
+  }
+  double tau = t - p.t1 - p.t2;
+  if (tau > p.t1) tau = p.t1;
+  return p.s2 + p.v2 * tau + p.peak * tau * tau / 2.0 - p.jerk * tau * tau * tau / 6.0;
+}
+
+constexpr int scurveRampLength(const SCurvePhases& p) {
+  int whole = (int)p.s3;
+  return (p.s3 > whole) ? whole + 1 : whole;
+}
+
+// Time (seconds) at which step n is reached (bisection on the monotonic position)
+constexpr double scurveStepTime(const SCurvePhases& p, int n) {
+  double total = 2.0 * p.t1 + p.t2;
+  if (n >= p.s3) {
+    return total + (n - p.s3) / p.vmax;
+  }
+  double lo = 0.0, hi = total;
+  for (int i = 0; i < 48; i++) {
+    double mid = 0.5 * (lo + hi);
+    if (scurvePosition(p, mid) < n) lo = mid;
+    else hi = mid;
+  }
+  return 0.5 * (lo + hi);
+}
+
+constexpr uint32_t scurveInterval(const SCurvePhases& p, int n) {
+  double dt = scurveStepTime(p, n + 1) - scurveStepTime(p, n);
+  return (uint32_t)(dt * 1000000.0 + 0.5);
+}
+
+constexpr void fillSCurveRamp(uint32_t* table, int length, const SCurvePhases& p) {
+  for (int i = 0; i < length; i++) {
+    table[i] = scurveInterval(p, i);
+  }
+}
+
+// Compile-time S-curve ramp table (same layout as TrapezoidRamp)
+template <int MaxSpeed, int Acceleration, int Jerk, int StartSpeed = MOTOR_START_SPEED>
+struct SCurveRamp {
+  static constexpr SCurvePhases phases = scurvePhases(MaxSpeed, StartSpeed, Acceleration, Jerk);
+  static constexpr int length = scurveRampLength(phases);
+  static constexpr uint32_t cruiseDelay = 1000000UL / MaxSpeed;
+
+  static constexpr std::array<uint32_t, length> build() {
+    std::array<uint32_t, length> table{};
+    for (int i = 0; i < length; i++) {
+      table[i] = scurveInterval(phases, i);
+    }
+    return table;
+  }
+
+  static constexpr std::array<uint32_t, length> table = build();
+};
+
+// Ramps used by all default-speed dispensing moves
+typedef TrapezoidRamp<MOTOR_SPEED, MOTOR_ACCELERATION> DefaultRamp;
+typedef SCurveRamp<MOTOR_SPEED, MOTOR_ACCELERATION, MOTOR_JERK> DefaultSCurve;
+
+static_assert(DefaultRamp::length > 0, "MOTOR_SPEED must exceed MOTOR_START_SPEED");
+static_assert(DefaultRamp::table[DefaultRamp::length - 1] >= DefaultRamp::cruiseDelay,
+              "Ramp must not overshoot cruise speed");
+static_assert(DefaultSCurve::length > 0, "MOTOR_SPEED must exceed MOTOR_START_SPEED");
+
+// ========================================
+// BENCHMARK HELPERS
+// ========================================
+
+// Duration (us) of a table-driven move, computed exactly as the step engine
+// clocks it: ramp table up, cruise, ramp table back down.
+constexpr uint64_t rampMoveDuration(int steps, const uint32_t* table, int rampLength,
+                                         uint32_t cruiseDelay) {
+  int ramp = (rampLength < steps / 2) ? rampLength : steps / 2;
+  uint64_t total = 0;
+  for (int i = 0; i < steps; i++) {
+    int fromEnd = steps - 1 - i;
+    if (i < ramp) total += table[i];
+    else if (fromEnd < ramp) total += table[fromEnd];
+    else total += (ramp < rampLength) ? table[ramp] : cruiseDelay;
+  }
+  return total;
+}
+
+// Duration (us) of the original linear-delay profile used before the ramp
+// tables: delay decremented by a fixed amount over min(steps/4, accel) steps.
+constexpr uint64_t legacyMoveDuration(int steps, int maxSpeed, int acceleration,
+                                      uint32_t startDelay = 10000) {
+  int accelSteps = (steps / 4 < acceleration) ? steps / 4 : acceleration;
+  if (accelSteps <= 0) return 0; // Original code divided by zero here
+  uint32_t targetDelay = 1000000UL / maxSpeed;
+  uint32_t delayStep = (startDelay - targetDelay) / accelSteps;
+  uint64_t total = 0;
+  uint32_t currentDelay = startDelay;
+  for (int i = 0; i < accelSteps; i++) { total += currentDelay; currentDelay -= delayStep; }
+  total += (uint64_t)(steps - 2 * accelSteps) * targetDelay;
+  for (int i = 0; i < accelSteps; i++) { total += currentDelay; currentDelay += delayStep; }
+  return total;
+}
+
+#endif // MOTION_PROFILE_H
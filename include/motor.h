@@ -2,6 +2,7 @@
 #define MOTOR_H
 
 #include <Arduino.h>
+#include "motion_profile.h"
 
 // ========================================
 // MOTOR CONTROL MODULE HEADER  
@@ -9,6 +10,32 @@
 // This module handles stepper motor control for food dispensing
 // using DRV8825 driver with NEMA 17 stepper motor
 
+// Outcome of the last feed
+struct DispenseReport {
+  int stepsRequested;     // Nominal portion (step budget)
+  int stepsUsed;          // Steps actually dispensed
+  int chunks;             // Motion commands used
+  bool closedLoop;        // Bowl sensor feedback was used
+  bool targetReached;     // Bowl reached the target before the budget ran out
+  float finalDistance;    // Last bowl reading in cm (-1 if none)
+  unsigned long durationMs;
+  int recoveries;         // Jam-clearing agitation sequences run
+  bool jammed;            // Feed failed: no food reached the bowl
+  bool driverFault;       // Driver fault output seen during the feed
+  bool hopperEmpty;       // Stopped early: the next move would have run the auger dry
+  bool aborted;           // Move stopped (emergency stop) before the portion was out
+};
+
+// Predicted cost of a feed, planned before the first step
+struct DispenseEstimate {
+  int steps;              // Step budget
+  uint32_t pulses;        // STEP pulses including the fine microstep finish
+  int chunks;             // Motion commands (1 for open-loop)
+  bool closedLoop;        // Planned as closed-loop chunks
+  unsigned long motorMs;  // Time the motor is moving
+  unsigned long totalMs;  // Worst case until the feed ends (settle and readings included)
+};
+
 // Motor control functions
 void initializeMotor();
 void enableMotor();
@@ -16,15 +43,30 @@ void disableMotor();
 
 // Feeding functions
 void dispensePortion(int steps);
-void dispensePortionSmooth(int steps, int maxSpeed = 200, int acceleration = 100);
-void manualFeed();
-void automaticFeed();
+uint32_t dispensePortionSmooth(int steps, int maxSpeed = 200, int acceleration = 100,
+                               MotionProfileType profileType = PROFILE_TRAPEZOID);
+bool dispensePortionClosedLoop(int maxSteps, float targetDistance);
+bool manualFeed();      // false if the portion was refused
+bool automaticFeed();
+bool isFeedInProgress();
+const DispenseReport& getLastDispenseReport();
+bool clearFeedingError();   // ERROR_STATE back to IDLE once the auger is checked
+
+// Feed planning
+int getPortionSteps();                // Portion a feed dispenses in the current mode
+DispenseEstimate estimateFeed(int portionSteps, int maxSpeed = MOTOR_SPEED, int acceleration = MOTOR_ACCELERATION,
+                              MotionProfileType profile = DISPENSE_PROFILE);
+unsigned long getFeedTimeRemaining(); // ms until the running feed is predicted to end
 
 // Calibration and utility functions
 void calibrateMotor();
 int gramsToSteps(float grams);
 float stepsToGrams(int steps);
 
+// Motion event servicing (call every loop() iteration)
+void updateMotor();
+void waitForMotorIdle();
+
 // Motor status functions
 bool isMotorEnabled();
 bool isMotorMoving();
@@ -33,5 +75,8 @@ void emergencyStop();
 // Debug and testing functions
 void testMotorMovement();
 void printMotorStatus();
+void printProfileBenchmark();
+void printProfileSimulation(int steps, int sampleEvery = 25);
+void printMicrostepBenchmark();
 
 #endif // MOTOR_H
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define SENSOR_H
 
 #include <Arduino.h>
+#include "sensor_trace.h"
 
 // ========================================
 // SENSOR MODULE HEADER
@@ -9,22 +10,56 @@
 // This module handles all ultrasonic sensor operations
 // for the Smart Pet Feeder project
 
+// Sampling cadence chosen by the adaptive sampler
+enum SamplingMode {
+  SAMPLING_FEEDING = 0,   // Feed in progress
+  SAMPLING_ACTIVE,        // Bowl level changed recently (pet eating)
+  SAMPLING_NORMAL,        // SENSOR_READ_INTERVAL
+  SAMPLING_IDLE           // Level stable for SENSOR_IDLE_AFTER
+};
+
+// Outcome of a trace replay
+struct SensorReplayStats {
+  uint32_t records;
+  uint32_t bowlEmptyChanges;  // bowlEmpty flips during the replay
+  uint32_t mismatches;        // Records where bowlEmpty differs from the recording
+  uint32_t lastTimeMs;        // Recorded time of the last replayed record
+};
+
 // Function declarations for sensor initialization
 void initializeUltrasonicSensor();
 
 // Function declarations for sensor reading and processing
 void updateSensorReadings();
-float readUltrasonicDistance();
+float readUltrasonicDistance();    // Blocking (start-up only)
+uint32_t requestSensorReading();   // Non-blocking, returns the cycle to wait for
+uint32_t getSensorCycleCount();
+float getLastCycleDistance();
 
 // Function declarations for status analysis
 void analyzeBowlStatus();
 
 // Function declarations for debugging and diagnostics
 void printSensorDebug();
+void printSamplingStatus();
+void printSensorHealth();
+
+// Cycle trace (see sensor_trace.h)
+void dumpSensorTrace();
+void beginSensorReplay(const SensorTrace& trace);
+bool isSensorReplayActive();
+const SensorReplayStats& getSensorReplayStats();
+const SensorTrace& getSensorTrace();
+
+// Adaptive sampling status
+SamplingMode getSamplingMode();
+unsigned long getSensorInterval();
+uint32_t getSensorSampleCount(SamplingMode mode);
 
 // Sensor status getter functions
 bool isSensorInitialized();
-float getCurrentDistance();
+float getCurrentDistance();       // Filtered bowl level (cm)
+float getRawDistance();           // Last valid unfiltered reading (cm, -1 if none)
 bool isBowlEmpty();
 
 #endif // SENSOR_H
\ No newline at end of file
@@ -0,0 +1,70 @@
+#ifndef SENSOR_TRACE_H
+#define SENSOR_TRACE_H
+
+#include <stdint.h>
+
+// ========================================
+// SENSOR TRACE HEADER
+// ========================================
+// Compact binary log of bowl sensor cycles. Each record is
+//   varint(time delta ms) | varint(zigzag(distance delta mm)) | flags
+// so a steady reading every second costs 4 bytes. Records go into a byte
+// ring (PSRAM on the device); when it is full the oldest records are
+// dropped whole and folded into the decode base, so the ring always
+// decodes from its first byte. The dump is plain text (header line, hex
+// lines, END) that sensorTraceImport() reads back, on the device or on a
+// host build, for replay. No Arduino dependencies.
+
+const int SENSOR_TRACE_MAX_RECORD = 9;     // 5 + 3 + 1 bytes worst case
+const int SENSOR_TRACE_VERSION = 1;
+
+// Flag layout
+const uint8_t TRACE_RESULT_MASK = 0x03;    // UltrasonicResult of the cycle
+const uint8_t TRACE_CHECKSUM_OK = 0x04;
+const uint8_t TRACE_FEEDING = 0x08;        // Feed in progress
+const uint8_t TRACE_BOWL_EMPTY = 0x10;     // bowlEmpty after the cycle
+const int TRACE_I2C_ERROR_SHIFT = 5;       // Bits 5-7: Wire error code
+
+struct TraceRecord {
+  uint32_t timeMs;
+  uint16_t distanceMm;     // Previous distance repeated for failed cycles
+  uint8_t flags;
+};
+
+struct SensorTrace {
+  uint8_t* buffer;
+  uint32_t capacity;
+  uint32_t head;           // Next byte to write
+  uint32_t tail;           // First byte of the oldest record
+  uint32_t used;
+  uint32_t records;        // Records held
+  uint32_t dropped;        // Records overwritten
+  uint32_t baseTimeMs;     // Values the oldest record is a delta from
+  uint16_t baseMm;
+  uint32_t lastTimeMs;     // Values the next record is a delta from
+  uint16_t lastMm;
+};
+
+struct TraceReader {
+  const SensorTrace* trace;
+  uint32_t position;
+  uint32_t remaining;
+  uint32_t timeMs;
+  uint16_t distanceMm;
+};
+
+// Recording
+void sensorTraceInit(SensorTrace& trace, uint8_t* buffer, uint32_t capacity);
+void sensorTraceClear(SensorTrace& trace);
+void sensorTraceAppend(SensorTrace& trace, const TraceRecord& record);
+
+// Playback
+void sensorTraceBeginRead(const SensorTrace& trace, TraceReader& reader);
+bool sensorTraceNext(TraceReader& reader, TraceRecord& record);
+
+// Text dump format: "TRACE <version> <records> <baseTimeMs> <baseMm> <bytes>",
+// hex lines of the ring contents oldest first, "END"
+uint32_t sensorTraceCopy(const SensorTrace& trace, uint8_t* out, uint32_t maxBytes);
+bool sensorTraceImport(SensorTrace& trace, uint8_t* buffer, uint32_t capacity, const char* text);
+
+#endif // SENSOR_TRACE_H
@@ -0,0 +1,49 @@
+#ifndef SMS_OUTBOX_H
+#define SMS_OUTBOX_H
+
+#include <stdint.h>
+
+// ========================================
+// SMS OUTBOX HEADER
+// ========================================
+// Fixed-capacity SMS queue. Messages are copied into preallocated slots
+// (PSRAM on the device) and a binary heap of slot indexes orders them by
+// priority, then by enqueue order, so push and pop are O(log n) and
+// nothing is allocated after smsOutboxInit(). When the outbox is full a
+// message only gets in by evicting the oldest message of the lowest
+// priority held, if that is lower than its own. No Arduino dependencies.
+
+const int SMS_NUMBER_LENGTH = 20;
+const int SMS_MESSAGE_LENGTH = 192;
+const int SMS_OUTBOX_PRIORITIES = 3;   // 0 = highest (matches SMSPriority)
+
+struct SMSOutboxSlot {
+  char number[SMS_NUMBER_LENGTH];
+  char message[SMS_MESSAGE_LENGTH];
+  uint8_t priority;
+  uint32_t queueTime;        // millis() at enqueue
+  uint32_t sequence;         // Enqueue order within a priority
+};
+
+struct SMSOutbox {
+  SMSOutboxSlot* slots;
+  uint16_t* heap;            // Slot indexes, heap ordered
+  uint16_t* freeSlots;       // Stack of unused slot indexes
+  uint16_t capacity;
+  uint16_t count;
+  uint32_t nextSequence;
+  uint16_t countByPriority[SMS_OUTBOX_PRIORITIES];
+  uint32_t dropped;          // Refused, outbox full of equal or higher priority
+  uint32_t evicted;          // Lower-priority messages pushed out
+};
+
+// Bytes of storage smsOutboxInit() needs for a capacity (one block)
+uint32_t smsOutboxStorageBytes(uint16_t capacity);
+
+void smsOutboxInit(SMSOutbox& outbox, void* storage, uint16_t capacity);
+bool smsOutboxPush(SMSOutbox& outbox, const char* number, const char* message,
+                   uint8_t priority, uint32_t nowMs);
+const SMSOutboxSlot* smsOutboxPeek(const SMSOutbox& outbox);   // nullptr when empty
+void smsOutboxPop(SMSOutbox& outbox);
+
+#endif // SMS_OUTBOX_H
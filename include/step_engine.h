@@ -0,0 +1,73 @@
+#ifndef STEP_ENGINE_H
+#define STEP_ENGINE_H
+
+#include <stdint.h>
+#include "config.h"
+
+// ========================================
+// STEP PULSE ENGINE HEADER
+// ========================================
+// Background step pulse generator for the DRV8825. A move is handed to
+// the engine and clocked out from a hardware timer interrupt, so loop()
+// keeps running while the auger turns.
+// On a host build (no ARDUINO defined) the hardware timer is replaced by
+// a simulated microsecond clock so pulse counts and timing can be checked
+// on Linux.
+// Moves are given in coarse steps. The last fineSteps of a move are
+// clocked in fine microstep mode (MICROSTEPS_PER_STEP pulses per step) so
+// the auger stops gently; the engine only switches resolution on a coarse
+// step boundary and an aborted fine step is completed before stopping.
+
+// Fine microstep pulses per coarse step
+const int MICROSTEPS_PER_STEP = MICROSTEP_FINE / MICROSTEP_COARSE;
+
+// Speed profile of a move (all delays in microseconds between steps).
+// The ramp table holds the intervals for the acceleration phase; the
+// deceleration phase replays it backwards (see motion_profile.h).
+struct StepProfile {
+  const uint32_t* rampTable; // Acceleration intervals, nullptr for constant speed
+  int rampSteps;             // Entries in rampTable
+  uint32_t cruiseDelay;      // Step interval at cruise speed
+};
+
+// A complete move request
+struct StepMove {
+  int steps;             // Number of step pulses (always positive)
+  bool clockwise;        // Direction (clockwise dispenses food)
+  int fineSteps;         // Trailing steps run in fine microstep mode (0 = none)
+  StepProfile profile;
+};
+
+// Engine control functions
+bool stepEngineBegin();
+bool stepEngineStart(const StepMove& move);
+void stepEngineStop();
+void stepEngineClearStop();   // Stops hold until cleared (the motion task's STOP command)
+void stepEngineOnComplete(void (*callback)());
+
+// Engine status functions
+bool stepEngineBusy();
+int stepEngineStepsDone();
+int stepEngineStepsTotal();
+long stepEngineMicrostepsDone();
+bool stepEngineClockwise();
+bool stepEngineFineMode();
+
+// Profile helpers
+uint32_t stepEngineInterval(const StepMove& move, int stepIndex);
+uint64_t stepEngineMoveDuration(const StepMove& move);
+uint32_t stepEngineMovePulses(const StepMove& move);
+
+#ifndef ARDUINO
+// Host-side timer stand-in: advance the simulated clock and inspect the
+// pulses the "ISR" produced.
+void stepEngineHostAdvance(uint64_t microseconds);
+uint64_t stepEngineHostNow();
+uint32_t stepEngineHostPulseCount();
+uint32_t stepEngineHostFinePulseCount();
+uint64_t stepEngineHostFirstPulseTime();
+uint64_t stepEngineHostLastPulseTime();
+void stepEngineHostReset();
+#endif
+
+#endif // STEP_ENGINE_H
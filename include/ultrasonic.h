@@ -0,0 +1,105 @@
+#ifndef ULTRASONIC_H
+#define ULTRASONIC_H
+
+#include <stdint.h>
+#include "config.h"
+
+// ========================================
+// ULTRASONIC MEASUREMENT HEADER
+// ========================================
+// Non-blocking RCWL-9620 measurement. A measurement is split into
+// trigger -> wait -> fetch -> validate. ultrasonicStart() queues the
+// trigger on the I2C bus manager (i2c_bus.h), ultrasonicUpdate() is called
+// every loop() iteration and only queues the read once the conversion
+// time has passed. A cycle costs two queued I2C transactions instead of
+// an 80 ms delay(), and the caller never waits for the bus.
+// Each channel (bowl, hopper) runs its own measurement; the bus manager
+// serialises their transactions.
+// On a host build (no ARDUINO defined) the Wire bus is replaced by
+// simulated RCWL-9620s that model the conversion delay: fetching too
+// early returns the previous measurement, like the real sensor.
+// The conversion wait and the latency run from the moment the bus task
+// wrote the trigger, so time spent in the bus queue or between polls is
+// not mistaken for sensor time.
+
+// Sensors on the bus
+enum UltrasonicChannel {
+  ULTRASONIC_BOWL = 0,     // ULTRASONIC_ADDR, above the bowl
+  ULTRASONIC_HOPPER,       // HOPPER_SENSOR_ADDR, in the hopper lid
+  ULTRASONIC_CHANNELS
+};
+
+// Measurement phases
+enum UltrasonicPhase {
+  ULTRASONIC_IDLE = 0,     // No measurement in flight
+  ULTRASONIC_CONVERTING,   // Trigger sent, sensor is measuring
+  ULTRASONIC_FETCH,        // Conversion time passed, read the result
+  ULTRASONIC_VALIDATE      // Result read, check range and checksum
+};
+
+// Outcome of a completed measurement
+enum UltrasonicResult {
+  ULTRASONIC_OK = 0,
+  ULTRASONIC_WRITE_ERROR,  // Trigger was not acknowledged (see i2cError) or not queued (busFull)
+  ULTRASONIC_SHORT_READ,   // Fewer than 3 bytes returned
+  ULTRASONIC_OUT_OF_RANGE  // Distance outside 0..500 cm
+};
+
+struct UltrasonicSample {
+  UltrasonicResult result;
+  float distanceCm;        // Valid for ULTRASONIC_OK (and OUT_OF_RANGE, for logging)
+  bool checksumOk;         // Checksum mismatches are accepted but flagged
+  uint8_t checksumReceived;
+  uint8_t checksumCalculated;
+  uint8_t i2cError;        // Wire error code for WRITE_ERROR
+  bool busFull;            // WRITE_ERROR because the bus queue could not take the trigger
+  int bytesRead;
+  uint32_t triggerTimeUs;  // micros() when the trigger left the bus
+  uint32_t latencyUs;      // Trigger on the bus to result read off it (0 without a fetch)
+};
+
+// Health counters, one set per channel
+const int ULTRASONIC_I2C_ERROR_CODES = 7;   // Wire codes 0-5 plus short read (6)
+const int ULTRASONIC_LATENCY_BUCKETS = 8;
+// Upper bounds (ms) of the latency buckets; the last bucket is open-ended
+const uint16_t ULTRASONIC_LATENCY_BOUNDS_MS[ULTRASONIC_LATENCY_BUCKETS - 1] = {
+  82, 85, 90, 100, 120, 150, 200
+};
+
+struct UltrasonicHealth {
+  uint32_t cycles;            // Completed measurements
+  uint32_t goodReads;         // In range with a valid checksum
+  uint32_t checksumErrors;    // In range, checksum mismatch (reading still used)
+  uint32_t outOfRange;
+  uint32_t shortReads;
+  uint32_t i2cErrors[ULTRASONIC_I2C_ERROR_CODES]; // Trigger or fetch error by Wire code
+  uint32_t retries;           // Bus retries after a recovery
+  uint32_t busFull;           // Trigger or fetch refused by a full bus queue
+  uint32_t latency[ULTRASONIC_LATENCY_BUCKETS];   // Trigger to data, see bounds above
+  uint32_t latencyMaxUs;
+};
+
+// Measurement control
+bool ultrasonicStart(UltrasonicChannel channel, uint32_t nowUs);
+bool ultrasonicUpdate(UltrasonicChannel channel, uint32_t nowUs, UltrasonicSample& sample);
+UltrasonicPhase ultrasonicPhase(UltrasonicChannel channel);
+bool ultrasonicBusy(UltrasonicChannel channel);
+
+// Health
+const UltrasonicHealth& ultrasonicHealth(UltrasonicChannel channel);
+void ultrasonicResetHealth(UltrasonicChannel channel);
+
+#ifndef ARDUINO
+// Host-side RCWL-9620 stand-in
+void ultrasonicHostSetDistance(UltrasonicChannel channel, float distanceCm);
+void ultrasonicHostSetConversionTime(UltrasonicChannel channel, uint32_t microseconds);
+void ultrasonicHostCorruptChecksum(UltrasonicChannel channel, bool corrupt);
+void ultrasonicHostFailNextTrigger(UltrasonicChannel channel, uint8_t error);
+void ultrasonicHostBusFull(UltrasonicChannel channel, bool full);
+void ultrasonicHostSetBusDelay(UltrasonicChannel channel, uint32_t microseconds);
+uint32_t ultrasonicHostEarlyFetches(UltrasonicChannel channel);
+uint32_t ultrasonicHostTransactions(UltrasonicChannel channel);
+void ultrasonicHostReset();
+#endif
+
+#endif // ULTRASONIC_H
@@ -0,0 +1,500 @@
+// at_engine.cpp
+// AT command engine for Smart Pet Feeder
+// Queues SIM800L commands and completes them from loop() without waiting;
+// modem output arrives as lines through a lock-free queue
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+#include <string.h>
+#include "config.h"
+#include "at_engine.h"
+#include "line_tokenizer.h"
+#include "line_queue.h"
+
+// Command waiting in the queue (the head is the one in flight)
+struct ATCommand {
+  char text[AT_COMMAND_LENGTH];
+  char expect[AT_EXPECT_LENGTH];
+  char terminator;          // '\r' for commands, Ctrl+Z for SMS text
+  int textLength;
+  uint32_t timeoutMs;
+  ATCallback callback;
+  void* context;
+};
+
+static ATCommand commandQueue[AT_QUEUE_LENGTH];
+static int commandHead = 0;
+static int commandCount = 0;
+static bool commandActive = false;
+static int commandWritten = 0;       // Bytes of the head command written so far
+static int commandLength = 0;        // Text plus terminator
+static unsigned long commandActiveAt = 0;  // Head became the command in flight
+static unsigned long commandSentAt = 0;
+static char response[AT_RESPONSE_LENGTH + 1];  // Lines of the command in flight
+static int responseLength = 0;
+
+// Receive side: modem bytes are split into lines and queued. The
+// tokenizer belongs to the receive side, the engine only pops lines.
+static LineTokenizer rxLines;
+static LineQueue rxQueue;
+static ATEngineStats stats = {};
+
+// Unsolicited result code handlers
+struct URCHandler {
+  const char* prefix;
+  ATURCHandler handler;
+};
+static URCHandler urcHandlers[AT_URC_HANDLERS];
+static int urcHandlerCount = 0;
+
+static void receiveBytes(const char* data, int length, uint32_t stampUs);
+
+// ========================================
+// PLATFORM LAYER
+// ========================================
+
+#ifdef ARDUINO
+
+extern HardwareSerial gsmSerial; // Defined in gsm.cpp
+
+static uint32_t nowMicros(unsigned long nowMs) {
+  (void)nowMs;
+  return micros();
+}
+
+// Runs on the core's UART event task, which sleeps on the UART driver's
+// event queue and wakes on received data or an RX idle timeout (how the
+// line-less "> " prompt gets through). loop() never polls the UART.
+static void onModemReceive() {
+  uint8_t buffer[AT_RX_BUDGET];
+  int count;
+  while ((count = gsmSerial.available()) > 0) {
+    if (count > AT_RX_BUDGET) count = AT_RX_BUDGET;
+    count = gsmSerial.read(buffer, count);
+    receiveBytes((const char*)buffer, count, micros());
+  }
+}
+
+static void startReceiver() {
+  gsmSerial.onReceive(onModemReceive);
+}
+
+static void pollReceiver(unsigned long nowMs) {
+  (void)nowMs; // Event driven
+}
+
+// Bytes the UART TX buffer takes without blocking
+static int modemWriteSpace() {
+  return gsmSerial.availableForWrite();
+}
+
+static void modemWrite(const char* data, int length, unsigned long nowMs) {
+  (void)nowMs;
+  gsmSerial.write((const uint8_t*)data, length);
+}
+
+#else
+
+// Simulated SIM800L with echo off: each command line is answered by the
+// first rule whose prefix matches it, after the rule's delay. Lines no
+// rule matches get ERROR, like unknown commands on the real module.
+const int AT_HOST_RULES = 16;
+const int AT_HOST_LOG = 32;
+const int AT_HOST_OUTPUT = 1024;
+
+struct HostRule {
+  char prefix[AT_COMMAND_LENGTH];
+  char response[AT_RESPONSE_LENGTH];
+  uint32_t delayMs;
+};
+
+struct HostModem {
+  HostRule rules[AT_HOST_RULES];
+  int ruleCount;
+  char line[AT_COMMAND_LENGTH];
+  int lineLength;
+  char log[AT_HOST_LOG][AT_COMMAND_LENGTH];
+  int logCount;
+  const HostRule* pending;  // Answer not due yet
+  unsigned long pendingAt;
+  char output[AT_HOST_OUTPUT];
+  int outputHead;
+  int outputLength;
+  int writes;               // modemWrite() calls, one per loop() at most
+  bool txStalled;           // UART takes nothing (availableForWrite() == 0)
+};
+static HostModem hostModem;
+
+static void hostOutput(const char* text) {
+  for (const char* c = text; *c != '\0' && hostModem.outputLength < AT_HOST_OUTPUT; c++) {
+    hostModem.output[(hostModem.outputHead + hostModem.outputLength++) % AT_HOST_OUTPUT] = *c;
+  }
+}
+
+static void hostLineReceived(unsigned long nowMs) {
+  hostModem.line[hostModem.lineLength] = '\0';
+  if (hostModem.logCount < AT_HOST_LOG) {
+    strcpy(hostModem.log[hostModem.logCount++], hostModem.line);
+  }
+  hostModem.lineLength = 0;
+
+  for (int i = 0; i < hostModem.ruleCount; i++) {
+    const HostRule& rule = hostModem.rules[i];
+    if (strncmp(hostModem.line, rule.prefix, strlen(rule.prefix)) == 0) {
+      hostModem.pending = &rule;
+      hostModem.pendingAt = nowMs + rule.delayMs;
+      return;
+    }
+  }
+  hostOutput("\r\nERROR\r\n");
+}
+
+static uint32_t nowMicros(unsigned long nowMs) {
+  return nowMs * 1000UL;
+}
+
+static void startReceiver() {}
+
+// Stands in for the UART event task: delivers what the fake modem has
+// sent, in AT_RX_BUDGET chunks, before the engine looks at the queue
+static void pollReceiver(unsigned long nowMs) {
+  if (hostModem.pending != nullptr && (long)(nowMs - hostModem.pendingAt) >= 0) {
+    hostOutput(hostModem.pending->response);
+    hostModem.pending = nullptr;
+  }
+  while (hostModem.outputLength > 0) {
+    char buffer[AT_RX_BUDGET];
+    int count = 0;
+    while (count < AT_RX_BUDGET && hostModem.outputLength > 0) {
+      buffer[count++] = hostModem.output[hostModem.outputHead];
+      hostModem.outputHead = (hostModem.outputHead + 1) % AT_HOST_OUTPUT;
+      hostModem.outputLength--;
+    }
+    receiveBytes(buffer, count, nowMicros(nowMs));
+  }
+}
+
+static int modemWriteSpace() {
+  return hostModem.txStalled ? 0 : AT_TX_BUDGET;
+}
+
+// '\r' and Ctrl+Z both end a line
+static void modemWrite(const char* data, int length, unsigned long nowMs) {
+  hostModem.writes++;
+  for (int i = 0; i < length; i++) {
+    if (data[i] == '\r' || data[i] == AT_CTRL_Z) {
+      hostLineReceived(nowMs);
+    } else if (hostModem.lineLength < AT_COMMAND_LENGTH - 1) {
+      hostModem.line[hostModem.lineLength++] = data[i];
+    }
+  }
+}
+
+#endif
+
+// ========================================
+// RECEIVE SIDE
+// ========================================
+
+// Producer of rxQueue; the prompt is queued as a "> " line of its own
+static void receiveBytes(const char* data, int length, uint32_t stampUs) {
+  lineTokenizerWrite(rxLines, data, length);
+  char line[AT_LINE_LENGTH];
+  while (lineTokenizerNext(rxLines, line, sizeof(line))) {
+    lineQueuePush(rxQueue, line, stampUs);
+  }
+  if (lineTokenizerPrompt(rxLines)) {
+    lineTokenizerSkipPartial(rxLines);
+    lineQueuePush(rxQueue, "> ", stampUs);
+  }
+}
+
+void atEngineBegin() {
+  lineTokenizerInit(rxLines);
+  lineQueueInit(rxQueue);
+  startReceiver();
+}
+
+// ========================================
+// QUEUEING
+// ========================================
+
+static bool enqueue(const char* text, char terminator, const char* expect, uint32_t timeoutMs,
+                    ATCallback callback, void* context) {
+  if (commandCount >= AT_QUEUE_LENGTH) {
+    return false;
+  }
+  ATCommand& command = commandQueue[(commandHead + commandCount) % AT_QUEUE_LENGTH];
+  strncpy(command.text, text, AT_COMMAND_LENGTH - 2);
+  command.text[AT_COMMAND_LENGTH - 2] = '\0';
+  command.textLength = strlen(command.text);
+  command.text[command.textLength] = terminator; // Written as part of the text
+  strncpy(command.expect, expect, AT_EXPECT_LENGTH - 1);
+  command.expect[AT_EXPECT_LENGTH - 1] = '\0';
+  command.terminator = terminator;
+  command.timeoutMs = timeoutMs;
+  command.callback = callback;
+  command.context = context;
+  commandCount++;
+  return true;
+}
+
+bool atSubmit(const char* command, const char* expect, uint32_t timeoutMs,
+              ATCallback callback, void* context) {
+  return enqueue(command, '\r', expect, timeoutMs, callback, context);
+}
+
+bool atSubmitData(const char* data, const char* expect, uint32_t timeoutMs,
+                  ATCallback callback, void* context) {
+  return enqueue(data, AT_CTRL_Z, expect, timeoutMs, callback, context);
+}
+
+// ========================================
+// ENGINE
+// ========================================
+
+// Response lines are kept one per '\n'; lines past the buffer are dropped
+static void appendResponse(const char* line) {
+  int length = strlen(line);
+  if (responseLength + length + 1 > AT_RESPONSE_LENGTH) {
+    return;
+  }
+  memcpy(response + responseLength, line, length);
+  responseLength += length;
+  response[responseLength++] = '\n';
+  response[responseLength] = '\0';
+}
+
+static bool startsWith(const char* line, const char* prefix) {
+  return strncmp(line, prefix, strlen(prefix)) == 0;
+}
+
+static bool isErrorLine(const char* line) {
+  return strcmp(line, "ERROR") == 0 || startsWith(line, "+CMS ERROR") || startsWith(line, "+CME ERROR");
+}
+
+// "+CREG: 0,1" while AT+CREG? is in flight is its answer, not a URC
+static bool answersCommand(const char* line) {
+  const char* colon = strchr(line, ':');
+  if (!commandActive || colon == nullptr) {
+    return false;
+  }
+  const ATCommand& command = commandQueue[commandHead];
+  return command.textLength > 2 && strncmp(command.text + 2, line, colon - line) == 0;
+}
+
+static bool dispatchURC(const char* line) {
+  if (answersCommand(line)) {
+    return false;
+  }
+  for (int i = 0; i < urcHandlerCount; i++) {
+    if (startsWith(line, urcHandlers[i].prefix)) {
+      stats.urcs++;
+      urcHandlers[i].handler(line);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Pops the head before the callback runs, so callbacks can queue follow-up
+// commands or flush the engine
+static void completeCommand(ATResult result) {
+  ATCommand& command = commandQueue[commandHead];
+  ATCallback callback = command.callback;
+  void* context = command.context;
+  commandHead = (commandHead + 1) % AT_QUEUE_LENGTH;
+  commandCount--;
+  commandActive = false;
+  commandWritten = 0;
+  if (callback != nullptr) {
+    callback(result, response, context);
+  }
+}
+
+// Writes what the UART takes now (at most AT_TX_BUDGET bytes); the
+// response timeout starts once the terminator is out
+static void writeCommand(unsigned long nowMs) {
+  const ATCommand& command = commandQueue[commandHead];
+  int chunk = commandLength - commandWritten;
+  int space = modemWriteSpace();
+  if (chunk > space) chunk = space;
+  if (chunk > AT_TX_BUDGET) chunk = AT_TX_BUDGET;
+  if (chunk <= 0) {
+    return;
+  }
+  modemWrite(command.text + commandWritten, chunk, nowMs);
+  commandWritten += chunk;
+  if (commandWritten == commandLength) {
+    commandSentAt = nowMs;
+  }
+}
+
+static void finishWithResponse(ATResult result, unsigned long nowMs) {
+  uint32_t responseMs = nowMs - commandSentAt;
+  if (responseMs > stats.responseMaxMs) stats.responseMaxMs = responseMs;
+  completeCommand(result);
+}
+
+static void handleLine(const char* line, unsigned long nowMs) {
+  if (dispatchURC(line)) {
+    return;
+  }
+  if (!commandActive || commandWritten < commandLength) {
+    stats.unhandled++; // Echo or output of a cancelled command
+    return;
+  }
+
+  const ATCommand& command = commandQueue[commandHead];
+  appendResponse(line);
+  if (startsWith(line, command.expect)) {
+    finishWithResponse(AT_OK, nowMs);
+  } else if (isErrorLine(line)) {
+    finishWithResponse(AT_ERROR, nowMs);
+  }
+}
+
+// One step per call: handle the lines that have arrived, then write more
+// of the command in flight, finish it, or start the next one
+void atEngineUpdate(unsigned long nowMs) {
+  pollReceiver(nowMs);
+  if (!commandActive && commandCount == 0 && lineQueueEmpty(rxQueue)) {
+    return; // Idle: nothing to do until the modem or a caller wakes us
+  }
+  uint32_t startUs = nowMicros(nowMs);
+
+  char line[AT_LINE_LENGTH];
+  uint32_t stampUs;
+  while (lineQueuePop(rxQueue, line, sizeof(line), stampUs)) {
+    uint32_t latencyUs = nowMicros(nowMs) - stampUs;
+    stats.lines++;
+    stats.lineLatencyTotalUs += latencyUs;
+    if (latencyUs > stats.lineLatencyMaxUs) stats.lineLatencyMaxUs = latencyUs;
+    handleLine(line, nowMs);
+  }
+  stats.updateUs += nowMicros(nowMs) - startUs;
+
+  // A UART that stops taking bytes (stuck TX, flow control) would hold
+  // the queue forever: the write gets the command's timeout as well,
+  // counted from the moment the command became active
+  if (commandActive && commandWritten < commandLength) {
+    if (nowMs - commandActiveAt >= commandQueue[commandHead].timeoutMs) {
+      stats.writeTimeouts++;
+      completeCommand(AT_TIMEOUT);
+      return;
+    }
+    writeCommand(nowMs);
+    return;
+  }
+
+  if (commandActive) {
+    if (nowMs - commandSentAt >= commandQueue[commandHead].timeoutMs) {
+      completeCommand(AT_TIMEOUT);
+    }
+    return;
+  }
+
+  if (commandCount > 0) {
+    responseLength = 0;
+    response[0] = '\0';
+    commandLength = commandQueue[commandHead].textLength + 1;
+    commandWritten = 0;
+    commandActive = true;
+    commandActiveAt = nowMs;
+    writeCommand(nowMs);
+  }
+}
+
+void atEngineFlush() {
+  while (commandCount > 0) {
+    completeCommand(AT_CANCELLED);
+  }
+  commandHead = 0;
+}
+
+bool atEngineBusy() {
+  return commandCount > 0;
+}
+
+int atEnginePending() {
+  return commandCount;
+}
+
+bool atOnURC(const char* prefix, ATURCHandler handler) {
+  if (urcHandlerCount >= AT_URC_HANDLERS) {
+    return false;
+  }
+  urcHandlers[urcHandlerCount].prefix = prefix;
+  urcHandlers[urcHandlerCount].handler = handler;
+  urcHandlerCount++;
+  return true;
+}
+
+const ATEngineStats& atEngineStats() {
+  stats.rxOverflows = rxLines.overflows;
+  stats.queueDrops = rxQueue.dropped.load(std::memory_order_relaxed);
+  return stats;
+}
+
+const char* atResultName(ATResult result) {
+  switch (result) {
+    case AT_OK: return "OK";
+    case AT_ERROR: return "ERROR";
+    case AT_TIMEOUT: return "TIMEOUT";
+    case AT_CANCELLED: return "CANCELLED";
+  }
+  return "?";
+}
+
+// ========================================
+// HOST-SIDE MODEM STAND-IN
+// ========================================
+
+#ifndef ARDUINO
+
+void atHostModemReset() {
+  hostModem = {};
+  commandHead = 0;
+  commandCount = 0;
+  commandActive = false;
+  commandWritten = 0;
+  responseLength = 0;
+  response[0] = '\0';
+  urcHandlerCount = 0;
+  stats = {};
+  atEngineBegin();
+}
+
+bool atHostModemRespond(const char* commandPrefix, const char* reply, uint32_t delayMs) {
+  if (hostModem.ruleCount >= AT_HOST_RULES) {
+    return false;
+  }
+  HostRule& rule = hostModem.rules[hostModem.ruleCount++];
+  strncpy(rule.prefix, commandPrefix, AT_COMMAND_LENGTH - 1);
+  strncpy(rule.response, reply, AT_RESPONSE_LENGTH - 1);
+  rule.delayMs = delayMs;
+  return true;
+}
+
+void atHostModemInject(const char* text) {
+  hostOutput(text);
+}
+
+int atHostModemWrites() {
+  return hostModem.writes;
+}
+
+int atHostModemCommandCount() {
+  return hostModem.logCount;
+}
+
+const char* atHostModemCommand(int index) {
+  return (index >= 0 && index < hostModem.logCount) ? hostModem.log[index] : "";
+}
+
+void atHostModemStallTx(bool stalled) {
+  hostModem.txStalled = stalled;
+}
+
+#endif
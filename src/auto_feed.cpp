@@ -0,0 +1,96 @@
+// auto_feed.cpp
+// Automatic feeding decision for Smart Pet Feeder
+// Empty-bowl confirmation and feed limits over a caller-supplied clock
+
+#include "config.h"
+#include "auto_feed.h"
+
+const unsigned long AUTO_FEED_DAY_MS = 24UL * 60 * 60 * 1000;
+
+void autoFeedInit(AutoFeedState& state, unsigned long nowMs) {
+  state.enabled = true;
+  state.lastFeedTime = 0;  // Allow immediate feeding on startup
+  state.lastCheck = 0;
+  state.emptySince = 0;
+  state.confirmed = false;
+  state.refusedTime = 0;
+  state.dailyCount = 0;
+  state.dailyResetTime = nowMs;
+}
+
+// Same gates, in the same order, as the original loop() logic: limit,
+// feed interval, retry hold, then one bowl check per AUTO_FEED_CHECK_INTERVAL
+uint8_t autoFeedUpdate(AutoFeedState& state, bool bowlEmpty, bool canFeed, unsigned long nowMs) {
+  if (!state.enabled) {
+    return 0;
+  }
+
+  if (state.dailyCount >= MAX_DAILY_AUTO_FEEDS) {
+    return bowlEmpty ? AUTO_FEED_LIMIT_REACHED : 0;
+  }
+
+  if (state.lastFeedTime != 0 && nowMs - state.lastFeedTime < AUTO_FEED_MIN_INTERVAL) {
+    return 0;
+  }
+
+  if (autoFeedRetryHeld(state, nowMs)) {
+    return 0;
+  }
+
+  if (nowMs - state.lastCheck < AUTO_FEED_CHECK_INTERVAL) {
+    return 0;
+  }
+  state.lastCheck = nowMs;
+
+  uint8_t result = AUTO_FEED_CHECKED;
+  if (bowlEmpty) {
+    if (state.emptySince == 0) {
+      // Bowl just became empty, start the confirmation timer
+      state.emptySince = nowMs;
+      state.confirmed = false;
+      result |= AUTO_FEED_EMPTY_DETECTED;
+    } else if (!state.confirmed && nowMs - state.emptySince > BOWL_EMPTY_CONFIRMATION_TIME) {
+      state.confirmed = true;
+      result |= AUTO_FEED_EMPTY_CONFIRMED;
+    }
+  } else {
+    state.emptySince = 0;
+    state.confirmed = false;
+  }
+
+  if (state.confirmed && canFeed) {
+    result |= AUTO_FEED_DISPENSE;
+  }
+  return result;
+}
+
+void autoFeedDispensed(AutoFeedState& state, unsigned long nowMs) {
+  state.lastFeedTime = nowMs;
+  state.dailyCount++;
+  state.confirmed = false;
+  state.emptySince = 0;
+  state.refusedTime = 0;
+}
+
+// The bowl stays confirmed empty, so the feed is tried again as soon as
+// the hold ends
+void autoFeedRefused(AutoFeedState& state, unsigned long nowMs) {
+  state.refusedTime = nowMs;
+}
+
+bool autoFeedRetryHeld(const AutoFeedState& state, unsigned long nowMs) {
+  return state.refusedTime != 0 && nowMs - state.refusedTime < AUTO_FEED_RETRY_INTERVAL;
+}
+
+unsigned long autoFeedRetryIn(const AutoFeedState& state, unsigned long nowMs) {
+  return autoFeedRetryHeld(state, nowMs) ? AUTO_FEED_RETRY_INTERVAL - (nowMs - state.refusedTime) : 0;
+}
+
+bool autoFeedDailyResetDue(const AutoFeedState& state, unsigned long nowMs) {
+  return nowMs - state.dailyResetTime > AUTO_FEED_DAY_MS;
+}
+
+void autoFeedDailyReset(AutoFeedState& state, unsigned long nowMs) {
+  state.dailyCount = 0;
+  state.dailyResetTime = nowMs;
+}
@@ -0,0 +1,283 @@
+// bowl_model.cpp
+// Bowl geometry model for Smart Pet Feeder
+// Interpolated distance -> volume table and food density, persisted in NVS
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "config.h"
+#include "bowl_model.h"
+#include "sensor.h"
+
+// Calibration routine
+const int CALIBRATION_READINGS = 5;        // Readings averaged per calibration point
+const unsigned long POUR_WAIT_MS = 10000;  // Time given to pour each volume step
+
+// Calibration phases (advanced by updateBowlCalibration() from loop())
+enum BowlCalibrationPhase {
+  BOWL_CAL_IDLE = 0,
+  BOWL_CAL_POURING,       // Waiting POUR_WAIT_MS for the user
+  BOWL_CAL_MEASURING      // Collecting CALIBRATION_READINGS sensor cycles
+};
+
+struct BowlCalibration {
+  BowlCalibrationPhase phase;
+  int step;                 // 0 = empty bowl, then one pour per step
+  unsigned long phaseStart;
+  uint32_t waitCycle;       // Sensor cycle the next reading arrives with
+  int readings;
+  int valid;
+  float sum;
+  BowlProfile profile;      // Built up point by point
+};
+static BowlCalibration calibration = {};
+
+BowlProfile bowlProfile;
+Preferences bowlStore;
+
+// Incremental conversion state (updateBowlGrams)
+static int segment = 0;             // Table segment of the last sample
+static float gramsRemaining = 0.0f;
+
+static_assert(BOWL_CALIBRATION_POINTS + 1 <= BOWL_PROFILE_MAX_POINTS,
+              "BOWL_CALIBRATION_POINTS does not fit the bowl profile");
+static_assert(BOWL_FLOOR_DISTANCE_CM > BOWL_RIM_DISTANCE_CM, "Bowl floor must be further than the rim");
+
+// Straight-walled bowl from the nominal grams per cm level
+static void setNominalProfile(BowlProfile& profile) {
+  float mlPerCm = BOWL_GRAMS_PER_CM / BOWL_FOOD_DENSITY;
+  profile.points = 2;
+  profile.distanceMm[0] = (uint16_t)(BOWL_FLOOR_DISTANCE_CM * 10);
+  profile.volumeMl[0] = 0;
+  profile.distanceMm[1] = (uint16_t)(BOWL_RIM_DISTANCE_CM * 10);
+  profile.volumeMl[1] = (uint16_t)(mlPerCm * (BOWL_FLOOR_DISTANCE_CM - BOWL_RIM_DISTANCE_CM) + 0.5f);
+  profile.densityGramsPerMl = BOWL_FOOD_DENSITY;
+}
+
+static bool isValidProfile(const BowlProfile& profile) {
+  if (profile.points < 2 || profile.points > BOWL_PROFILE_MAX_POINTS) return false;
+  if (profile.densityGramsPerMl <= 0) return false;
+  for (int i = 1; i < profile.points; i++) {
+    if (profile.distanceMm[i] >= profile.distanceMm[i - 1]) return false;
+    if (profile.volumeMl[i] < profile.volumeMl[i - 1]) return false;
+  }
+  return true;
+}
+
+static void saveProfile() {
+  if (bowlStore.begin("bowl", false)) {
+    bowlStore.putBytes("profile", &bowlProfile, sizeof(BowlProfile));
+    bowlStore.end();
+  }
+}
+
+// ========================================
+// INITIALIZATION
+// ========================================
+
+void initializeBowlModel() {
+  setNominalProfile(bowlProfile);
+
+  if (bowlStore.begin("bowl", true)) {
+    BowlProfile stored;
+    if (bowlStore.getBytes("profile", &stored, sizeof(stored)) == sizeof(stored) &&
+        isValidProfile(stored)) {
+      bowlProfile = stored;
+    }
+    bowlStore.end();
+  }
+  segment = 0;
+
+  Serial.printf("✓ Bowl model loaded (%d points, %.0f g capacity, %.2f g/ml)\n",
+                bowlProfile.points, getBowlCapacityGrams(), bowlProfile.densityGramsPerMl);
+}
+
+void resetBowlModel() {
+  setNominalProfile(bowlProfile);
+  segment = 0;
+  saveProfile();
+  Serial.println("Bowl model reset to nominal geometry");
+}
+
+void setFoodDensity(float gramsPerMl) {
+  if (gramsPerMl <= 0) return;
+  bowlProfile.densityGramsPerMl = gramsPerMl;
+  saveProfile();
+  Serial.printf("Food density set to %.2f g/ml\n", gramsPerMl);
+}
+
+// ========================================
+// CONVERSIONS
+// ========================================
+
+// Volume on table segment i (between point i and i+1), clamped to the segment
+static float segmentVolume(int i, float distanceMm) {
+  float d0 = bowlProfile.distanceMm[i];
+  float d1 = bowlProfile.distanceMm[i + 1];
+  float t = (d0 - distanceMm) / (d0 - d1);
+  t = constrain(t, 0.0f, 1.0f);
+  return bowlProfile.volumeMl[i] + t * (bowlProfile.volumeMl[i + 1] - bowlProfile.volumeMl[i]);
+}
+
+// Stateless conversion (any distance, linear search)
+float bowlGramsAt(float distanceCm) {
+  float distanceMm = distanceCm * 10.0f;
+  int i = 0;
+  while (i < bowlProfile.points - 2 && distanceMm < bowlProfile.distanceMm[i + 1]) {
+    i++;
+  }
+  return segmentVolume(i, distanceMm) * bowlProfile.densityGramsPerMl;
+}
+
+// Incremental conversion: the level moves little between filtered samples,
+// so the search starts at the previous segment and usually stays there.
+float updateBowlGrams(uint16_t distanceMm) {
+  int last = bowlProfile.points - 2;
+  if (segment > last) segment = last;
+
+  while (segment < last && distanceMm < bowlProfile.distanceMm[segment + 1]) {
+    segment++;
+  }
+  while (segment > 0 && distanceMm > bowlProfile.distanceMm[segment]) {
+    segment--;
+  }
+
+  gramsRemaining = segmentVolume(segment, distanceMm) * bowlProfile.densityGramsPerMl;
+  return gramsRemaining;
+}
+
+float getBowlGrams() {
+  return gramsRemaining;
+}
+
+float getBowlCapacityGrams() {
+  return bowlProfile.volumeMl[bowlProfile.points - 1] * bowlProfile.densityGramsPerMl;
+}
+
+const BowlProfile& getBowlProfile() {
+  return bowlProfile;
+}
+
+// ========================================
+// CALIBRATION
+// ========================================
+
+static void startPourWait() {
+  if (calibration.step == 0) {
+    Serial.printf("Empty the bowl (%lu s)...\n", POUR_WAIT_MS / 1000);
+  } else {
+    Serial.printf("Pour %d ml of food into the bowl (%lu s)...\n", BOWL_CALIBRATION_STEP_ML, POUR_WAIT_MS / 1000);
+  }
+  calibration.phase = BOWL_CAL_POURING;
+  calibration.phaseStart = millis();
+}
+
+// Averaged point done: keep it if it moved the level closer to the sensor
+static void finishPoint() {
+  BowlProfile& profile = calibration.profile;
+  float distance = (calibration.valid > 0) ? calibration.sum / calibration.valid : -1.0f;
+  uint16_t distanceMm = (uint16_t)(distance * 10.0f + 0.5f);
+  int volumeMl = calibration.step * BOWL_CALIBRATION_STEP_ML;
+
+  if (distance <= 0 || (profile.points > 0 && distanceMm >= profile.distanceMm[profile.points - 1])) {
+    Serial.printf("Point %d skipped (%.1f cm)\n", calibration.step, distance);
+  } else {
+    profile.distanceMm[profile.points] = distanceMm;
+    profile.volumeMl[profile.points] = volumeMl;
+    profile.points++;
+    Serial.printf("Point %d: %.1f cm = %d ml\n", calibration.step, distance, volumeMl);
+  }
+}
+
+static void finishCalibration() {
+  calibration.phase = BOWL_CAL_IDLE;
+  if (!isValidProfile(calibration.profile)) {
+    Serial.println("✗ Bowl calibration failed - keeping previous profile");
+    return;
+  }
+
+  bowlProfile = calibration.profile;
+  segment = 0;
+  saveProfile();
+  Serial.printf("✓ Bowl calibration complete (%d points, %.0f g capacity)\n",
+                bowlProfile.points, getBowlCapacityGrams());
+}
+
+// Empty bowl first, then BOWL_CALIBRATION_POINTS pours of
+// BOWL_CALIBRATION_STEP_ML each. Points that do not move the level
+// closer to the sensor are skipped. Returns at once; loop() drives the
+// pours and readings through updateBowlCalibration().
+bool startBowlCalibration() {
+  if (calibration.phase != BOWL_CAL_IDLE) {
+    Serial.println("Bowl calibration already running");
+    return false;
+  }
+  Serial.println("🔧 Starting bowl calibration...");
+  if (!isSensorInitialized()) {
+    Serial.println("✗ Bowl sensor offline - calibration aborted");
+    return false;
+  }
+
+  calibration.profile.densityGramsPerMl = bowlProfile.densityGramsPerMl;
+  calibration.profile.points = 0;
+  calibration.step = 0;
+  startPourWait();
+  return true;
+}
+
+// Each point averages CALIBRATION_READINGS sensor cycles, requested one
+// after the other from the sensor state machine (no blocking reads)
+void updateBowlCalibration() {
+  switch (calibration.phase) {
+    case BOWL_CAL_IDLE:
+      return;
+
+    case BOWL_CAL_POURING:
+      if (millis() - calibration.phaseStart < POUR_WAIT_MS) {
+        return;
+      }
+      calibration.phase = BOWL_CAL_MEASURING;
+      calibration.readings = 0;
+      calibration.valid = 0;
+      calibration.sum = 0;
+      calibration.waitCycle = requestSensorReading();
+      return;
+
+    case BOWL_CAL_MEASURING: {
+      if (!isSensorInitialized()) {
+        Serial.println("✗ Bowl sensor offline - calibration aborted");
+        calibration.phase = BOWL_CAL_IDLE;
+        return;
+      }
+      if ((int32_t)(getSensorCycleCount() - calibration.waitCycle) < 0) {
+        return;
+      }
+      float reading = getLastCycleDistance();
+      if (reading > 0) {
+        calibration.sum += reading;
+        calibration.valid++;
+      }
+      if (++calibration.readings < CALIBRATION_READINGS) {
+        calibration.waitCycle = requestSensorReading();
+        return;
+      }
+
+      finishPoint();
+      if (++calibration.step > BOWL_CALIBRATION_POINTS) {
+        finishCalibration();
+      } else {
+        startPourWait();
+      }
+      return;
+    }
+  }
+}
+
+bool isBowlCalibrating() {
+  return calibration.phase != BOWL_CAL_IDLE;
+}
+
+void printBowlModelStatus() {
+  Serial.printf("   Bowl: %.0f g of %.0f g (%d-point profile, %.2f g/ml)\n",
+                gramsRemaining, getBowlCapacityGrams(), bowlProfile.points,
+                bowlProfile.densityGramsPerMl);
+}
@@ -0,0 +1,144 @@
+// calibration.cpp
+// Dispense calibration module for Smart Pet Feeder
+// Recursive least squares estimate of steps per gram, persisted in NVS
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "config.h"
+#include "calibration.h"
+
+// RLS tuning
+// P is scaled by the measurement noise (units 1/kstep^2): the variance of
+// the estimate is P * noiseVariance in (g/kstep)^2. 400 * (5 g)^2 puts the
+// factory estimate at +/-100 g/kstep, i.e. barely trusted.
+const float INITIAL_COVARIANCE = 400.0f;
+const float MIN_COVARIANCE = 0.5f;         // Keeps the filter responsive to slow drift
+const float OUTLIER_RATIO = 3.0f;          // Reject measurements this far off the estimate
+const float INITIAL_NOISE_VARIANCE = 25.0f; // (5 g)^2 until residuals say otherwise
+const float MAX_RELATIVE_ERROR = 0.5f;     // Relative std error that counts as 0% confidence
+
+// One model per feeding mode (indexed by FeedingMode)
+DispenseModel dispenseModels[2];
+Preferences calibrationStore;
+
+static const char* modelKey(FeedingMode mode) {
+  return (mode == CAT_MODE) ? "cat" : "dog";
+}
+
+static void setFactoryModel(DispenseModel& model) {
+  model.gramsPerKiloStep = 1000.0f / DEFAULT_STEPS_PER_GRAM;
+  model.covariance = INITIAL_COVARIANCE;
+  model.noiseVariance = INITIAL_NOISE_VARIANCE;
+  model.samples = 0;
+}
+
+static void saveModel(FeedingMode mode) {
+  if (calibrationStore.begin("calibration", false)) {
+    calibrationStore.putBytes(modelKey(mode), &dispenseModels[mode], sizeof(DispenseModel));
+    calibrationStore.end();
+  }
+}
+
+// ========================================
+// INITIALIZATION
+// ========================================
+
+void initializeCalibration() {
+  setFactoryModel(dispenseModels[CAT_MODE]);
+  setFactoryModel(dispenseModels[DOG_MODE]);
+
+  if (calibrationStore.begin("calibration", true)) {
+    for (int m = CAT_MODE; m <= DOG_MODE; m++) {
+      FeedingMode mode = (FeedingMode)m;
+      DispenseModel stored;
+      if (calibrationStore.getBytes(modelKey(mode), &stored, sizeof(stored)) == sizeof(stored) &&
+          stored.gramsPerKiloStep > 0) {
+        dispenseModels[mode] = stored;
+      }
+    }
+    calibrationStore.end();
+  }
+
+  Serial.printf("✓ Calibration loaded (CAT %.1f, DOG %.1f steps/g)\n",
+                getStepsPerGram(CAT_MODE), getStepsPerGram(DOG_MODE));
+}
+
+void resetCalibration() {
+  setFactoryModel(dispenseModels[CAT_MODE]);
+  setFactoryModel(dispenseModels[DOG_MODE]);
+  saveModel(CAT_MODE);
+  saveModel(DOG_MODE);
+  Serial.println("Calibration reset to factory steps/gram");
+}
+
+// ========================================
+// RECURSIVE LEAST SQUARES UPDATE
+// ========================================
+
+// One scalar RLS step with forgetting factor, x in ksteps and y in grams.
+// The lambda in the gain stands for unit noise, which is why P is the
+// noise-scaled covariance above:
+//   k = P x / (lambda + x P x)
+//   theta += k (y - x theta)
+//   P = (P - k x P) / lambda
+bool updateCalibration(FeedingMode mode, int steps, float grams) {
+  if (steps <= 0 || grams <= 0) return false;
+
+  DispenseModel& model = dispenseModels[mode];
+  float x = steps / 1000.0f;
+  float measured = grams / x;
+
+  // Pet eating or a bad echo can give wild readings; ignore those
+  if (measured > model.gramsPerKiloStep * OUTLIER_RATIO ||
+      measured < model.gramsPerKiloStep / OUTLIER_RATIO) {
+    Serial.printf("Calibration sample rejected (%.1f g/kstep vs %.1f)\n",
+                  measured, model.gramsPerKiloStep);
+    return false;
+  }
+
+  float residual = grams - x * model.gramsPerKiloStep;
+  model.noiseVariance = 0.9f * model.noiseVariance + 0.1f * residual * residual;
+
+  float lambda = CALIBRATION_FORGETTING;
+  float gain = model.covariance * x / (lambda + x * model.covariance * x);
+  model.gramsPerKiloStep += gain * residual;
+  model.covariance = (model.covariance - gain * x * model.covariance) / lambda;
+  model.covariance = constrain(model.covariance, MIN_COVARIANCE, INITIAL_COVARIANCE);
+  model.samples++;
+
+  saveModel(mode);
+
+  Serial.printf("Calibration %s: %d steps -> %.1fg, now %.2f steps/g (%.0f%% confidence)\n",
+                modelKey(mode), steps, grams, getStepsPerGram(mode),
+                getCalibrationConfidence(mode) * 100.0f);
+  return true;
+}
+
+// ========================================
+// QUERIES
+// ========================================
+
+float getStepsPerGram(FeedingMode mode) {
+  return 1000.0f / dispenseModels[mode].gramsPerKiloStep;
+}
+
+// Confidence from the relative standard error of the estimate:
+// std = sqrt(P * noise), 0% at MAX_RELATIVE_ERROR or worse, 100% at zero
+float getCalibrationConfidence(FeedingMode mode) {
+  const DispenseModel& model = dispenseModels[mode];
+  float stdError = sqrtf(model.covariance * model.noiseVariance);
+  float relative = stdError / model.gramsPerKiloStep;
+  return constrain(1.0f - relative / MAX_RELATIVE_ERROR, 0.0f, 1.0f);
+}
+
+const DispenseModel& getDispenseModel(FeedingMode mode) {
+  return dispenseModels[mode];
+}
+
+void printCalibrationStatus() {
+  Serial.printf("   Calibration: CAT %.2f steps/g (%.0f%%, %lu samples) | DOG %.2f steps/g (%.0f%%, %lu samples)\n",
+                getStepsPerGram(CAT_MODE), getCalibrationConfidence(CAT_MODE) * 100.0f,
+                (unsigned long)dispenseModels[CAT_MODE].samples,
+                getStepsPerGram(DOG_MODE), getCalibrationConfidence(DOG_MODE) * 100.0f,
+                (unsigned long)dispenseModels[DOG_MODE].samples);
+}
@@ -0,0 +1,180 @@
+// eating_monitor.cpp
+// Eating-event detection for Smart Pet Feeder
+// Segments eating sessions from the bowl grams signal and keeps daily totals
+
+#include <Arduino.h>
+#include "config.h"
+#include "eating_monitor.h"
+#include "gsm.h"
+
+// Session history (PSRAM when available)
+const int FALLBACK_SESSIONS = 32;
+static EatingSession fallbackHistory[FALLBACK_SESSIONS];
+static EatingSession* history = fallbackHistory;
+static int historyCapacity = FALLBACK_SESSIONS;
+static int historyHead = 0;     // Next slot to write
+static int historyCount = 0;
+
+// Detector state
+static bool eating = false;
+static float referenceGrams = -1.0f; // Level the next drop is measured from
+static float startGrams = 0.0f;
+static float lowestGrams = 0.0f;
+static unsigned long sessionStart = 0;
+static unsigned long lastDrop = 0;
+
+// Daily totals
+static EatingDay today = {};
+static EatingDay yesterday = {};
+
+// ========================================
+// INITIALIZATION
+// ========================================
+
+void initializeEatingMonitor() {
+  EatingSession* psram = (EatingSession*)ps_malloc(EATING_HISTORY_SESSIONS * sizeof(EatingSession));
+  if (psram != nullptr) {
+    history = psram;
+    historyCapacity = EATING_HISTORY_SESSIONS;
+  }
+  historyHead = 0;
+  historyCount = 0;
+
+  Serial.printf("✓ Eating monitor ready (%d sessions in %s)\n", historyCapacity,
+                psram != nullptr ? "PSRAM" : "internal RAM");
+}
+
+// ========================================
+// SESSION DETECTION
+// ========================================
+
+static void recordSession(unsigned long endMs) {
+  float grams = startGrams - lowestGrams;
+  unsigned long durationMs = endMs - sessionStart;
+
+  EatingSession& session = history[historyHead];
+  session.startSeconds = sessionStart / 1000;
+  session.durationSeconds = (uint16_t)min(durationMs / 1000, 65535UL);
+  session.gramsTenths = (uint16_t)constrain(grams * 10.0f, 0.0f, 65535.0f);
+  historyHead = (historyHead + 1) % historyCapacity;
+  if (historyCount < historyCapacity) historyCount++;
+
+  // Incremental daily totals
+  float minutes = durationMs / 60000.0f;
+  float rate = (minutes > 0) ? grams / minutes : 0.0f;
+  today.sessions++;
+  today.grams += grams;
+  today.eatingSeconds += durationMs / 1000;
+  if (rate > today.fastestRate) today.fastestRate = rate;
+
+  Serial.printf("🐾 Eating session: %.0f g in %lu s (%.1f g/min)\n",
+                grams, durationMs / 1000, rate);
+}
+
+static void endSession(unsigned long endMs) {
+  eating = false;
+  if (startGrams - lowestGrams >= EATING_START_GRAMS) {
+    recordSession(endMs);
+  }
+}
+
+// Feed every filtered bowl reading. Level rises (refills) move the
+// reference up; drops during a feed are the auger's business, not the pet's.
+void updateEatingMonitor(float grams, unsigned long nowMs, bool feeding) {
+  if (grams < 0) return;
+
+  if (feeding) {
+    if (eating) endSession(lastDrop);
+    referenceGrams = grams;
+    return;
+  }
+
+  if (!eating) {
+    if (referenceGrams < 0 || grams > referenceGrams) {
+      referenceGrams = grams;
+    } else if (referenceGrams - grams >= EATING_START_GRAMS) {
+      eating = true;
+      startGrams = referenceGrams;
+      lowestGrams = grams;
+      sessionStart = nowMs;
+      lastDrop = nowMs;
+    }
+    return;
+  }
+
+  if (grams < lowestGrams - EATING_NOISE_GRAMS) {
+    lowestGrams = grams;
+    lastDrop = nowMs;
+  } else if (grams > startGrams + EATING_START_GRAMS) {
+    // Food was added mid-session (manual top-up): close it
+    endSession(lastDrop);
+    referenceGrams = grams;
+    return;
+  }
+
+  if (nowMs - lastDrop >= EATING_END_IDLE_MS) {
+    endSession(lastDrop);
+    referenceGrams = grams;
+  }
+}
+
+void rollEatingDay() {
+  yesterday = today;
+  today = {};
+}
+
+// ========================================
+// QUERIES
+// ========================================
+
+bool isPetEating() {
+  return eating;
+}
+
+int getEatingSessionCount() {
+  return historyCount;
+}
+
+bool getEatingSession(int index, EatingSession& session) {
+  if (index < 0 || index >= historyCount) return false;
+  int slot = (historyHead - 1 - index + historyCapacity) % historyCapacity;
+  session = history[slot];
+  return true;
+}
+
+const EatingDay& getEatingToday() {
+  return today;
+}
+
+const EatingDay& getEatingYesterday() {
+  return yesterday;
+}
+
+float getEatingRate(const EatingDay& day) {
+  if (day.eatingSeconds == 0) return 0.0f;
+  return day.grams / (day.eatingSeconds / 60.0f);
+}
+
+// ========================================
+// REPORTING
+// ========================================
+
+void printEatingStatus() {
+  Serial.printf("   Eating today: %d session(s), %.0f g, avg %.1f g/min%s\n",
+                today.sessions, today.grams, getEatingRate(today),
+                eating ? " | EATING NOW" : "");
+  EatingSession last;
+  if (getEatingSession(0, last)) {
+    Serial.printf("   Last meal: %.1f g in %u s, %lu min ago\n",
+                  last.gramsTenths / 10.0f, last.durationSeconds,
+                  (millis() / 1000 - last.startSeconds) / 60);
+  }
+}
+
+// Summary of the day closed by the last rollEatingDay()
+void sendEatingSummarySMS() {
+  char info[120];
+  snprintf(info, sizeof(info), "Yesterday: %d meal(s), %.0fg eaten, avg %.1f g/min, fastest %.1f g/min",
+           yesterday.sessions, yesterday.grams, getEatingRate(yesterday), yesterday.fastestRate);
+  sendSMSAlert(SMS_EATING_SUMMARY, info);
+}
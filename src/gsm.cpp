@@ -22,6 +22,8 @@
 
 #include "gsm.h"
 #include "config.h"
+#include "at_engine.h"
+#include "sms_outbox.h"
 #include <Arduino.h>
 
 // Global GSM variables
@@ -33,25 +35,140 @@ bool gsmInitialized = false;
 bool smsInProgress = false;
 unsigned long lastSMSSendTime = 0;
 
-// Priority-based SMS queue system
-struct SMSQueueItem {
-  String phoneNumber;
-  String message;
-  SMSPriority priority;
-  unsigned long queueTime;
+// AT command state (commands run in the background, see at_engine.h)
+bool gsmProbeInFlight = false;       // Status probe queued, result not in yet
+bool networkRegistered = false;      // Last AT+CREG? answer
+unsigned long lastLinkCheck = 0;
+unsigned long lastErrorRecovery = 0;
+bool modemReadySeen = false;         // "SMS Ready" since the last reset
+unsigned long gsmDeferStart = 0;     // deferGSMTraffic() window
+unsigned long gsmDeferMs = 0;
+
+// SMS send pipeline: one message at a time, each step started by the
+// AT engine callback of the previous one
+enum SMSSendStep {
+  SMS_STEP_IDLE = 0,
+  SMS_STEP_TEXT_MODE,      // AT+CMGF=1
+  SMS_STEP_PROMPT,         // AT+CMGS="<number>", waiting for "> "
+  SMS_STEP_RESULT          // Text + Ctrl+Z written, waiting for +CMGS: / ERROR
+};
+
+struct SMSSend {
+  SMSSendStep step;
+  char number[24];
+  char body[AT_COMMAND_LENGTH];
+  unsigned long queuedAt;    // When queueSMS() accepted it
+  unsigned long startedAt;   // First AT command queued
 };
+SMSSend outgoingSMS = {};
 
-const int MAX_SMS_QUEUE = 5;
-SMSQueueItem smsQueue[MAX_SMS_QUEUE];
-int queueHead = 0;
-int queueTail = 0;
-int queueCount = 0;
+// Send results and end-to-end latency (queueSMS() to +CMGS:)
+unsigned long smsSentCount = 0;
+unsigned long smsFailedCount = 0;
+int lastSMSReference = -1;
+unsigned long lastSMSLatency = 0;
+unsigned long maxSMSLatency = 0;
+unsigned long totalSMSLatency = 0;
+
+// Priority-based SMS queue system (slots in PSRAM when available)
+const uint16_t FALLBACK_OUTBOX_CAPACITY = 8;
+struct {
+  SMSOutboxSlot slots[FALLBACK_OUTBOX_CAPACITY];  // Same layout as smsOutboxInit() storage
+  uint16_t indexes[2 * FALLBACK_OUTBOX_CAPACITY];
+} fallbackOutbox;
+SMSOutbox smsOutbox = {};
 
 // Priority-based rate limiting
 unsigned long lastHighPrioritySMS = 0;
 unsigned long lastMediumPrioritySMS = 0;
 unsigned long lastLowPrioritySMS = 0;
 
+// ========================================
+// UNSOLICITED RESULT CODES
+// ========================================
+// Registration changes, incoming SMS, delivery reports, calls and power
+// warnings are pushed by the modem and handled as they arrive.
+
+// "+CREG: <stat>" (URC) or "+CREG: <n>,<stat>" (AT+CREG? answer);
+// stat 1 = home network, 5 = roaming
+bool registrationFromLine(const char* line) {
+  const char* colon = strchr(line, ':');
+  if (colon == nullptr) {
+    return false;
+  }
+  char* end;
+  long stat = strtol(colon + 1, &end, 10);
+  if (*end == ',') {
+    stat = strtol(end + 1, &end, 10);
+  }
+  return stat == 1 || stat == 5;
+}
+
+void onRegistrationURC(const char* line) {
+  networkRegistered = registrationFromLine(line);
+  
+  if (networkRegistered && currentGSMStatus == GSM_NETWORK_SEARCHING) {
+    Serial.println("📱 GSM network connected");
+    currentGSMStatus = GSM_NETWORK_CONNECTED;
+    lastGSMStatusCheck = 0; // Enable SMS without waiting for the next check
+  } else if (!networkRegistered &&
+             (currentGSMStatus == GSM_NETWORK_CONNECTED || currentGSMStatus == GSM_SMS_READY)) {
+    Serial.println("📱 GSM network lost, searching...");
+    currentGSMStatus = GSM_NETWORK_SEARCHING;
+    gsmInitStartTime = millis(); // Restart the search timeout
+  }
+}
+
+void onNewSMSURC(const char* line) {
+  Serial.printf("📱 SMS received (%s)\n", line);
+}
+
+// Text mode: "+CDS: <fo>,<mr>,...,<st>"; st 0 = delivered
+void onDeliveryReportURC(const char* line) {
+  const char* comma = strchr(line, ',');
+  const char* last = strrchr(line, ',');
+  if (comma == nullptr || last == nullptr) {
+    return;
+  }
+  int reference = atoi(comma + 1);
+  int status = atoi(last + 1);
+  if (status == 0) {
+    Serial.printf("📱 SMS ref %d delivered\n", reference);
+  } else {
+    Serial.printf("📱 SMS ref %d not delivered (status %d)\n", reference, status);
+  }
+}
+
+void onRingURC(const char* line) {
+  Serial.println("📱 Incoming call rejected");
+  atSubmit("ATH", "OK", 2000);
+}
+
+void onModemReadyURC(const char* line) {
+  modemReadySeen = true;
+  if (currentGSMStatus == GSM_INITIALIZING) {
+    lastGSMStatusCheck = 0; // Booted early, probe now
+  }
+}
+
+// "UNDER-VOLTAGE WARNNING" (sic) or "UNDER-VOLTAGE POWER DOWN"
+void onPowerURC(const char* line) {
+  Serial.printf("⚠️ GSM power: %s\n", line);
+  if (strstr(line, "POWER DOWN") != nullptr) {
+    currentGSMStatus = GSM_ERROR; // Recovery resets the module
+  }
+}
+
+void registerURCHandlers() {
+  atOnURC("+CREG:", onRegistrationURC);
+  atOnURC("+CMTI:", onNewSMSURC);
+  atOnURC("+CDS:", onDeliveryReportURC);
+  atOnURC("RING", onRingURC);
+  atOnURC("SMS Ready", onModemReadyURC);
+  atOnURC("UNDER-VOLTAGE", onPowerURC);
+  atOnURC("NORMAL POWER DOWN", onPowerURC);
+}
+
 void initializeGSM() {
   Serial.println("📱 Initializing GSM module (SIM800L)...");
   
@@ -59,33 +176,26 @@ void initializeGSM() {
   pinMode(GSM_RESET_PIN, OUTPUT);
   digitalWrite(GSM_RESET_PIN, HIGH);
   
-  // Initialize hardware serial for GSM communication
-  gsmSerial.begin(GSM_BAUD_RATE, SERIAL_8N1, GSM_RX_PIN, GSM_TX_PIN);
-  
-  // Wait for serial to stabilize
-  delay(1000);
-  
-  // Perform hardware reset
-  Serial.println("📱 Performing GSM hardware reset...");
-  digitalWrite(GSM_RESET_PIN, LOW);
-  delay(100);
-  digitalWrite(GSM_RESET_PIN, HIGH);
-  delay(3000); // Allow module to boot
+  // Outbox storage is allocated once here; queueing never allocates
+  void* outboxStorage = ps_malloc(smsOutboxStorageBytes(SMS_OUTBOX_CAPACITY));
+  if (outboxStorage != nullptr) {
+    smsOutboxInit(smsOutbox, outboxStorage, SMS_OUTBOX_CAPACITY);
+  } else {
+    Serial.printf("⚠️ No PSRAM for the SMS outbox, using %u slots\n", FALLBACK_OUTBOX_CAPACITY);
+    smsOutboxInit(smsOutbox, &fallbackOutbox, FALLBACK_OUTBOX_CAPACITY);
+  }
   
-  // Start initialization sequence
-  currentGSMStatus = GSM_INITIALIZING;
-  gsmInitStartTime = millis();
-  gsmInitialized = false;
+  registerURCHandlers();
   
-  Serial.println("📱 GSM module reset complete, starting initialization...");
+  // Initialize hardware serial for GSM communication
+  gsmSerial.begin(GSM_BAUD_RATE, SERIAL_8N1, GSM_RX_PIN, GSM_TX_PIN);
   
-  // Clear any pending data
-  while(gsmSerial.available()) {
-    gsmSerial.read();
-  }
+  // Received lines are queued from the UART event task from here on
+  atEngineBegin();
   
-  // Send initial AT command
-  gsmSerial.println("AT");
+  // Perform hardware reset; updateGSMStatus() waits GSM_BOOT_TIME
+  // before the first AT command instead of blocking here
+  resetGSMModule();
   
   Serial.println("📱 GSM initialization started");
 }
@@ -98,88 +208,144 @@ GSMStatus getGSMStatus() {
   return currentGSMStatus;
 }
 
+// ========================================
+// STATUS PROBES
+// ========================================
+// Each state queues one probe on the AT engine; its callback moves the
+// state on. Nothing here waits for the modem.
+
+void onModemAlive(ATResult result, const char* response, void* context) {
+  gsmProbeInFlight = false;
+  if (result == AT_OK && currentGSMStatus == GSM_INITIALIZING) {
+    Serial.println("📱 GSM responds to AT commands");
+    currentGSMStatus = GSM_NETWORK_SEARCHING;
+    atSubmit("AT+CMGF=1", "OK", 2000);          // Set text mode for SMS
+    atSubmit("AT+CREG=1", "OK", 2000);          // +CREG URC on registration changes
+    atSubmit("AT+CNMI=2,1,0,1,0", "OK", 2000);  // +CMTI for new SMS, +CDS for reports
+    atSubmit("AT+CSMP=49,167,0,0", "OK", 2000); // Request delivery reports
+  }
+}
+
+void onRegistration(ATResult result, const char* response, void* context) {
+  gsmProbeInFlight = false;
+  if (result != AT_OK) {
+    return;
+  }
+  const char* creg = strstr(response, "+CREG:");
+  if (creg != nullptr) {
+    onRegistrationURC(creg); // Same handling as a pushed change
+  }
+}
+
+void onTextMode(ATResult result, const char* response, void* context) {
+  gsmProbeInFlight = false;
+  if (result == AT_OK && currentGSMStatus == GSM_NETWORK_CONNECTED) {
+    Serial.println("📱 GSM SMS ready");
+    currentGSMStatus = GSM_SMS_READY;
+    gsmInitialized = true;
+  }
+}
+
+void onLinkCheck(ATResult result, const char* response, void* context) {
+  gsmProbeInFlight = false;
+  if (result != AT_OK && result != AT_CANCELLED && currentGSMStatus == GSM_SMS_READY) {
+    Serial.println("📱 GSM connection lost, reinitializing...");
+    currentGSMStatus = GSM_INITIALIZING;
+    gsmInitStartTime = millis();
+    gsmInitialized = false;
+  }
+}
+
+// A message already being sent carries on; only new traffic waits
+static bool gsmTrafficDeferred() {
+  return millis() - gsmDeferStart < gsmDeferMs;
+}
+
+void deferGSMTraffic(unsigned long durationMs) {
+  gsmDeferStart = millis();
+  gsmDeferMs = durationMs;
+}
+
 void updateGSMStatus() {
-  // Don't update too frequently
-  if (millis() - lastGSMStatusCheck < GSM_STATUS_CHECK_INTERVAL) {
+  // Advance the command in flight every loop
+  atEngineUpdate(millis());
+  
+  // Process SMS queue (rate limited per priority)
+  if (!gsmTrafficDeferred()) {
+    processSMSQueue();
+  }
+  
+  // Don't probe too frequently
+  if (gsmProbeInFlight || millis() - lastGSMStatusCheck < GSM_STATUS_CHECK_INTERVAL) {
     return;
   }
   lastGSMStatusCheck = millis();
   
   // Handle different states
   switch (currentGSMStatus) {
+    case GSM_OFFLINE:
+      break;
+      
     case GSM_INITIALIZING:
+      if (!modemReadySeen && millis() - gsmInitStartTime < GSM_BOOT_TIME) {
+        break; // Module still booting after the reset
+      }
       if (millis() - gsmInitStartTime > GSM_INIT_TIMEOUT) {
         Serial.println("📱 GSM initialization timeout, setting to error state");
         currentGSMStatus = GSM_ERROR;
         break;
       }
       
-      // Try basic AT command
-      if (sendATCommand("AT", "OK", 2000)) {
-        Serial.println("📱 GSM responds to AT commands");
-        currentGSMStatus = GSM_NETWORK_SEARCHING;
-        
-        // Set text mode for SMS
-        gsmSerial.println("AT+CMGF=1");
-        delay(1000);
-      }
+      // Echo off, so SMS text is never read back as a response
+      gsmProbeInFlight = atSubmit("ATE0", "OK", 2000, onModemAlive);
       break;
       
     case GSM_NETWORK_SEARCHING:
-      // Check network registration
-      if (sendATCommand("AT+CREG?", "+CREG: 0,1", 5000) || 
-          sendATCommand("AT+CREG?", "+CREG: 0,5", 5000)) {
-        Serial.println("📱 GSM network connected");
-        currentGSMStatus = GSM_NETWORK_CONNECTED;
-      } else if (millis() - gsmInitStartTime > GSM_INIT_TIMEOUT * 2) {
+      if (millis() - gsmInitStartTime > GSM_INIT_TIMEOUT * 2) {
         Serial.println("📱 GSM network connection timeout");
         currentGSMStatus = GSM_ERROR;
+        break;
       }
+      gsmProbeInFlight = atSubmit("AT+CREG?", "OK", GSM_AT_TIMEOUT, onRegistration);
       break;
       
     case GSM_NETWORK_CONNECTED:
-      // Check if SMS is ready
-      if (sendATCommand("AT+CMGF=1", "OK", 2000)) {
-        Serial.println("📱 GSM SMS ready");
-        currentGSMStatus = GSM_SMS_READY;
-        gsmInitialized = true;
-      }
+      gsmProbeInFlight = atSubmit("AT+CMGF=1", "OK", 2000, onTextMode);
       break;
       
     case GSM_SMS_READY:
       // Periodically verify connection is still active
-      static unsigned long lastConnectionCheck = 0;
-      if (millis() - lastConnectionCheck > 60000) { // Check every minute
-        if (!sendATCommand("AT", "OK", 2000)) {
-          Serial.println("📱 GSM connection lost, reinitializing...");
-          currentGSMStatus = GSM_INITIALIZING;
-          gsmInitStartTime = millis();
-        }
-        lastConnectionCheck = millis();
+      if (!smsInProgress && !gsmTrafficDeferred() && millis() - lastLinkCheck > GSM_LINK_CHECK_INTERVAL) {
+        lastLinkCheck = millis();
+        gsmProbeInFlight = atSubmit("AT", "OK", 2000, onLinkCheck);
       }
       break;
       
     case GSM_ERROR:
       // Try to recover every 30 seconds
-      static unsigned long lastErrorRecovery = 0;
-      if (millis() - lastErrorRecovery > 30000) {
+      if (millis() - lastErrorRecovery > GSM_RECOVERY_INTERVAL) {
         Serial.println("📱 Attempting GSM error recovery...");
-        initializeGSM();
+        resetGSMModule();
         lastErrorRecovery = millis();
       }
       break;
   }
-  
-  // Process SMS queue instead of single pending SMS
-  processSMSQueue();
 }
 
 void resetGSMModule() {
   Serial.println("📱 Resetting GSM module...");
+  
+  // Commands in flight die with the module
+  atEngineFlush();
+  gsmProbeInFlight = false;
+  smsInProgress = false;
+  outgoingSMS.step = SMS_STEP_IDLE;
+  networkRegistered = false;
+  modemReadySeen = false;
+  
   digitalWrite(GSM_RESET_PIN, LOW);
   delay(100);
   digitalWrite(GSM_RESET_PIN, HIGH);
-  delay(3000);
   
   currentGSMStatus = GSM_INITIALIZING;
   gsmInitStartTime = millis();
@@ -196,125 +362,147 @@ void sendSMSAlert(SMSAlertType alertType, const char* additionalInfo) {
     return;
   }
   
-  String message = "";
-  String timeStr = String(millis() / 1000); // Simple timestamp in seconds
+  // Built on the stack; the outbox copies it into a preallocated slot
+  char message[SMS_MESSAGE_LENGTH];
+  unsigned long timeSec = millis() / 1000; // Simple timestamp in seconds
   
   switch (alertType) {
     case SMS_AUTO_FEED:
-      message = "🤖 Smart Pet Feeder: Auto-fed ";
-      message += additionalInfo;
-      message += " - Bowl was empty. Time: ";
-      message += timeStr;
-      message += "s";
+      snprintf(message, sizeof(message), "🤖 Smart Pet Feeder: Auto-fed %s - Bowl was empty. Time: %lus",
+               additionalInfo, timeSec);
       break;
       
     case SMS_MANUAL_FEED:
-      message = "👤 Smart Pet Feeder: Manual feed ";
-      message += additionalInfo;
-      message += " by button press. Time: ";
-      message += timeStr;
-      message += "s";
+      snprintf(message, sizeof(message), "👤 Smart Pet Feeder: Manual feed %s by button press. Time: %lus",
+               additionalInfo, timeSec);
       break;
       
     case SMS_SYSTEM_STATUS:
-      message = "📊 Smart Pet Feeder Status: ";
-      message += additionalInfo;
+      snprintf(message, sizeof(message), "📊 Smart Pet Feeder Status: %s", additionalInfo);
       break;
       
     case SMS_FEEDING_ERROR:
-      message = "⚠️ Smart Pet Feeder ERROR: ";
-      message += additionalInfo;
-      message += " Time: ";
-      message += timeStr;
-      message += "s";
+      snprintf(message, sizeof(message), "⚠️ Smart Pet Feeder ERROR: %s Time: %lus", additionalInfo, timeSec);
       break;
       
     case SMS_BOWL_EMPTY_ALERT:
-      message = "🍽️ Smart Pet Feeder: ";
-      message += additionalInfo;
+      snprintf(message, sizeof(message), "🍽️ Smart Pet Feeder: %s", additionalInfo);
       break;
       
     case SMS_DAILY_RESET:
-      message = "🌅 Smart Pet Feeder: New day started. Feed counter reset. Auto feeding enabled.";
+      snprintf(message, sizeof(message), "🌅 Smart Pet Feeder: New day started. Feed counter reset. Auto feeding enabled.");
+      break;
+      
+    case SMS_EATING_SUMMARY:
+      snprintf(message, sizeof(message), "🐾 Smart Pet Feeder: %s", additionalInfo);
       break;
+      
+    case SMS_HOPPER_LOW:
+      snprintf(message, sizeof(message), "🪣 Smart Pet Feeder: %s", additionalInfo);
+      break;
+      
+    default:
+      return;
   }
   
   // Get priority and send with priority system
   SMSPriority priority = getSMSPriority(alertType);
-  queueSMS(TEST_PHONE_NUMBER, message.c_str(), priority);
+  queueSMS(TEST_PHONE_NUMBER, message, priority);
 }
 
-void sendCustomSMSInternal(const char* phoneNumber, const char* message) {
-  if (currentGSMStatus != GSM_SMS_READY) {
-    // Queue with medium priority by default
-    queueSMS(phoneNumber, message, SMS_PRIORITY_MEDIUM);
-    return;
-  }
-  
-  if (smsInProgress) {
-    Serial.println("📱 SMS already in progress, queueing message");
-    queueSMS(phoneNumber, message, SMS_PRIORITY_MEDIUM);
-    return;
+// ========================================
+// SMS SENDING
+// ========================================
+// Text mode, then AT+CMGS with the number, then the text once the "> "
+// prompt is in, then the +CMGS: <reference> result. The engine writes the
+// text a few bytes per loop(), so nothing stalls while it goes out.
+
+const char* smsStepNames[] = {"IDLE", "TEXT_MODE", "PROMPT", "RESULT"};
+
+void finishSMS(ATResult result, const char* response) {
+  unsigned long now = millis();
+  const char* cmgs = response != nullptr ? strstr(response, "+CMGS:") : nullptr;
+  
+  if (result == AT_OK && cmgs != nullptr) {
+    unsigned long latency = now - outgoingSMS.queuedAt;
+    lastSMSReference = atoi(cmgs + 6);
+    lastSMSLatency = latency;
+    maxSMSLatency = max(maxSMSLatency, latency);
+    totalSMSLatency += latency;
+    smsSentCount++;
+    Serial.printf("📱 SMS sent to %s (ref %d) in %.1f s: %.1f s queued, %.1f s modem\n",
+                  outgoingSMS.number, lastSMSReference, latency / 1000.0f,
+                  (outgoingSMS.startedAt - outgoingSMS.queuedAt) / 1000.0f,
+                  (now - outgoingSMS.startedAt) / 1000.0f);
+  } else {
+    smsFailedCount++;
+    Serial.printf("📱 SMS to %s failed at %s (%s) after %.1f s\n",
+                  outgoingSMS.number, smsStepNames[outgoingSMS.step],
+                  atResultName(result), (now - outgoingSMS.startedAt) / 1000.0f);
+    if (outgoingSMS.step == SMS_STEP_PROMPT && result == AT_TIMEOUT) {
+      // A late prompt would swallow the next command as message text
+      atSubmit("\x1b", "OK", 1000);
+    }
   }
   
-  Serial.printf("📱 Sending SMS to %s: %s\n", phoneNumber, message);
-  
-  smsInProgress = true;
-  lastSMSSendTime = millis();
-  
-  // Set SMS to text mode
-  gsmSerial.println("AT+CMGF=1");
-  delay(1000);
-  
-  // Set recipient
-  gsmSerial.print("AT+CMGS=\"");
-  gsmSerial.print(phoneNumber);
-  gsmSerial.println("\"");
-  delay(1000);
-  
-  // Send message
-  gsmSerial.print(message);
-  delay(500);
-  
-  // Send Ctrl+Z to indicate end of message
-  gsmSerial.write(26);
-  delay(5000); // Wait for SMS to be sent
-  
+  outgoingSMS.step = SMS_STEP_IDLE;
   smsInProgress = false;
-  Serial.println("📱 SMS send command completed");
 }
 
-bool sendATCommand(const char* command, const char* expectedResponse, unsigned long timeout) {
-  String response = "";
-  unsigned long startTime = millis();
-  
-  // Clear input buffer
-  while(gsmSerial.available()) {
-    gsmSerial.read();
+void onSMSStep(ATResult result, const char* response, void* context) {
+  if (result != AT_OK) {
+    finishSMS(result, response);
+    return;
   }
   
-  // Send command
-  gsmSerial.println(command);
-  
-  // Wait for response
-  while (millis() - startTime < timeout) {
-    if (gsmSerial.available()) {
-      char c = gsmSerial.read();
-      response += c;
+  switch (outgoingSMS.step) {
+    case SMS_STEP_TEXT_MODE: {
+      char command[40];
+      snprintf(command, sizeof(command), "AT+CMGS=\"%s\"", outgoingSMS.number);
+      outgoingSMS.step = SMS_STEP_PROMPT;
+      atSubmit(command, "> ", GSM_AT_TIMEOUT, onSMSStep);
+      break;
+    }
       
-      // Check if we got the expected response
-      if (response.indexOf(expectedResponse) != -1) {
-        return true;
-      }
+    case SMS_STEP_PROMPT:
+      // +CMGS: <mr> comes before the final OK
+      outgoingSMS.step = SMS_STEP_RESULT;
+      atSubmitData(outgoingSMS.body, "OK", SMS_SEND_TIMEOUT, onSMSStep);
+      break;
       
-      // Check for error responses
-      if (response.indexOf("ERROR") != -1) {
-        return false;
-      }
-    }
+    case SMS_STEP_RESULT:
+      finishSMS(result, response);
+      break;
+      
+    case SMS_STEP_IDLE:
+      break;
+  }
+}
+
+// Starts the pipeline for a message taken from the outbox; false if it
+// cannot start now (the caller keeps the message queued)
+bool sendCustomSMSInternal(const char* phoneNumber, const char* message, unsigned long queuedAt) {
+  if (currentGSMStatus != GSM_SMS_READY || smsInProgress) {
+    return false;
   }
   
-  return false;
+  if (!atSubmit("AT+CMGF=1", "OK", 2000, onSMSStep)) {
+    return false;
+  }
+  
+  // The later steps are queued from callbacks, so the message is kept here
+  strncpy(outgoingSMS.number, phoneNumber, sizeof(outgoingSMS.number) - 1);
+  outgoingSMS.number[sizeof(outgoingSMS.number) - 1] = '\0';
+  strncpy(outgoingSMS.body, message, sizeof(outgoingSMS.body) - 1);
+  outgoingSMS.body[sizeof(outgoingSMS.body) - 1] = '\0';
+  outgoingSMS.queuedAt = queuedAt;
+  outgoingSMS.startedAt = millis();
+  outgoingSMS.step = SMS_STEP_TEXT_MODE;
+  
+  Serial.printf("📱 Sending SMS to %s: %s\n", phoneNumber, message);
+  smsInProgress = true;
+  lastSMSSendTime = millis();
+  return true;
 }
 
 void printGSMStatus() {
@@ -324,19 +512,13 @@ void printGSMStatus() {
   };
   
   Serial.printf("📱 GSM Status: %s", statusNames[currentGSMStatus]);
-  if (queueCount > 0) {
-    Serial.printf(" | Queue: %d SMS", queueCount);
+  if (smsOutbox.count > 0) {
+    Serial.printf(" | Queue: %u/%u SMS", smsOutbox.count, smsOutbox.capacity);
     
     // Show priority breakdown
-    int highCount = 0, mediumCount = 0, lowCount = 0;
-    for (int i = 0; i < queueCount; i++) {
-      int index = (queueHead + i) % MAX_SMS_QUEUE;
-      switch (smsQueue[index].priority) {
-        case SMS_PRIORITY_HIGH: highCount++; break;
-        case SMS_PRIORITY_MEDIUM: mediumCount++; break;
-        case SMS_PRIORITY_LOW: lowCount++; break;
-      }
-    }
+    int highCount = smsOutbox.countByPriority[SMS_PRIORITY_HIGH];
+    int mediumCount = smsOutbox.countByPriority[SMS_PRIORITY_MEDIUM];
+    int lowCount = smsOutbox.countByPriority[SMS_PRIORITY_LOW];
     
     if (highCount > 0) Serial.printf(" (H:%d", highCount);
     if (mediumCount > 0) Serial.printf("%sM:%d", highCount > 0 ? ", " : " (", mediumCount);
@@ -344,9 +526,39 @@ void printGSMStatus() {
     if (highCount > 0 || mediumCount > 0 || lowCount > 0) Serial.print(")");
   }
   if (smsInProgress) {
-    Serial.print(" | Sending SMS...");
+    Serial.printf(" | Sending SMS (%s)...", smsStepNames[outgoingSMS.step]);
+  }
+  if (atEngineBusy()) {
+    Serial.printf(" | AT queue: %d", atEnginePending());
   }
   Serial.println();
+  
+  const ATEngineStats& at = atEngineStats();
+  if (at.lines > 0) {
+    Serial.printf("   AT link: %lu lines (%lu URC, %lu stray) | line latency avg %lu us, max %lu us"
+                  " | response max %lu ms | %lu us handling",
+                  (unsigned long)at.lines, (unsigned long)at.urcs, (unsigned long)at.unhandled,
+                  (unsigned long)(at.lineLatencyTotalUs / at.lines), (unsigned long)at.lineLatencyMaxUs,
+                  (unsigned long)at.responseMaxMs, (unsigned long)at.updateUs);
+    if (at.rxOverflows > 0 || at.queueDrops > 0) {
+      Serial.printf(" | lost %lu bytes, %lu lines", (unsigned long)at.rxOverflows, (unsigned long)at.queueDrops);
+    }
+    if (at.writeTimeouts > 0) {
+      Serial.printf(" | %lu write timeouts", (unsigned long)at.writeTimeouts);
+    }
+    Serial.println();
+  }
+  
+  if (smsSentCount > 0 || smsFailedCount > 0 || smsOutbox.dropped > 0) {
+    Serial.printf("   SMS: %lu sent, %lu failed, %lu dropped, %lu evicted", smsSentCount, smsFailedCount,
+                  (unsigned long)smsOutbox.dropped, (unsigned long)smsOutbox.evicted);
+    if (smsSentCount > 0) {
+      Serial.printf(" | latency last %.1f s, avg %.1f s, max %.1f s | last ref %d",
+                    lastSMSLatency / 1000.0f, totalSMSLatency / 1000.0f / smsSentCount,
+                    maxSMSLatency / 1000.0f, lastSMSReference);
+    }
+    Serial.println();
+  }
 }
 
 void testGSMModule() {
@@ -358,25 +570,23 @@ void testGSMModule() {
   }
   
   // Send test SMS
-  String testMessage = "🧪 Smart Pet Feeder TEST: GSM module working. Time: ";
-  testMessage += String(millis() / 1000);
-  testMessage += "s";
+  char testMessage[80];
+  snprintf(testMessage, sizeof(testMessage), "🧪 Smart Pet Feeder TEST: GSM module working. Time: %lus", millis() / 1000);
   
-  sendCustomSMS(TEST_PHONE_NUMBER, testMessage.c_str(), SMS_PRIORITY_LOW);
+  sendCustomSMS(TEST_PHONE_NUMBER, testMessage, SMS_PRIORITY_LOW);
 }
 
+// Last known registration; queues a fresh AT+CREG? for the next call
 bool checkNetworkConnection() {
-  return sendATCommand("AT+CREG?", "+CREG: 0,1", 3000) || 
-         sendATCommand("AT+CREG?", "+CREG: 0,5", 3000);
+  if (!gsmProbeInFlight && currentGSMStatus != GSM_OFFLINE && currentGSMStatus != GSM_INITIALIZING) {
+    gsmProbeInFlight = atSubmit("AT+CREG?", "OK", GSM_AT_TIMEOUT, onRegistration);
+  }
+  return networkRegistered;
 }
 
 void processGSMResponse() {
-  // Process any incoming GSM responses (for future enhancements)
-  while(gsmSerial.available()) {
-    String response = gsmSerial.readString();
-    // For now, just clear the buffer
-    // Future: Parse incoming SMS, delivery reports, etc.
-  }
+  // Responses and URCs are consumed by the AT engine
+  atEngineUpdate(millis());
 }
 
 String formatPhoneNumber(const char* number) {
@@ -405,73 +615,38 @@ SMSPriority getSMSPriority(SMSAlertType alertType) {
       
     case SMS_DAILY_RESET:
     case SMS_BOWL_EMPTY_ALERT:
+    case SMS_HOPPER_LOW:
       return SMS_PRIORITY_MEDIUM;
       
     case SMS_SYSTEM_STATUS:
+    case SMS_EATING_SUMMARY:
     default:
       return SMS_PRIORITY_LOW;
   }
 }
 
 void queueSMS(const char* phoneNumber, const char* message, SMSPriority priority) {
-  // Check if queue is full
-  if (queueCount >= MAX_SMS_QUEUE) {
-    // Queue full - check if we can replace a lower priority item
-    int lowestPriorityIndex = -1;
-    SMSPriority lowestPriority = SMS_PRIORITY_HIGH;
-    
-    for (int i = 0; i < MAX_SMS_QUEUE; i++) {
-      int index = (queueHead + i) % MAX_SMS_QUEUE;
-      if (smsQueue[index].priority > lowestPriority) {
-        lowestPriority = smsQueue[index].priority;
-        lowestPriorityIndex = index;
-      }
-    }
-    
-    // If new message has higher priority, replace lower priority message
-    if (priority < lowestPriority) {
-      Serial.printf("📱 SMS Queue: Replacing low priority message with priority %d\n", priority);
-      smsQueue[lowestPriorityIndex].phoneNumber = String(phoneNumber);
-      smsQueue[lowestPriorityIndex].message = String(message);
-      smsQueue[lowestPriorityIndex].priority = priority;
-      smsQueue[lowestPriorityIndex].queueTime = millis();
-      return;
-    } else {
-      Serial.println("📱 SMS Queue: Full, message dropped (lower priority)");
-      return;
-    }
+  uint32_t evicted = smsOutbox.evicted;
+  if (smsOutbox.slots == nullptr || !smsOutboxPush(smsOutbox, phoneNumber, message, priority, millis())) {
+    Serial.println("📱 SMS Queue: Full, message dropped (lower priority)");
+    return;
+  }
+  if (smsOutbox.evicted != evicted) {
+    Serial.printf("📱 SMS Queue: Replacing low priority message with priority %d\n", priority);
+    return;
   }
-  
-  // Add to queue
-  smsQueue[queueTail].phoneNumber = String(phoneNumber);
-  smsQueue[queueTail].message = String(message);
-  smsQueue[queueTail].priority = priority;
-  smsQueue[queueTail].queueTime = millis();
-  
-  queueTail = (queueTail + 1) % MAX_SMS_QUEUE;
-  queueCount++;
   
   Serial.printf("📱 SMS Queued (Priority %d): %s\n", priority, message);
 }
 
 bool processSMSQueue() {
-  if (queueCount == 0 || smsInProgress || currentGSMStatus != GSM_SMS_READY) {
+  if (smsOutbox.count == 0 || smsInProgress || currentGSMStatus != GSM_SMS_READY) {
     return false;
   }
   
-  // Find highest priority message in queue
-  int highestPriorityIndex = -1;
-  SMSPriority highestPriority = static_cast<SMSPriority>(SMS_PRIORITY_LOW + 1); // Lower number = higher priority
-  
-  for (int i = 0; i < queueCount; i++) {
-    int index = (queueHead + i) % MAX_SMS_QUEUE;
-    if (smsQueue[index].priority < highestPriority) {
-      highestPriority = smsQueue[index].priority;
-      highestPriorityIndex = index;
-    }
-  }
-  
-  if (highestPriorityIndex == -1) return false;
+  // Highest priority message, oldest first
+  const SMSOutboxSlot* item = smsOutboxPeek(smsOutbox);
+  SMSPriority highestPriority = (SMSPriority)item->priority;
   
   // Check priority-based rate limiting
   unsigned long currentTime = millis();
@@ -497,19 +672,12 @@ bool processSMSQueue() {
     return false; // Rate limited
   }
   
-  // Send the SMS
-  SMSQueueItem item = smsQueue[highestPriorityIndex];
-  Serial.printf("📱 Sending queued SMS (Priority %d): %s\n", item.priority, item.message.c_str());
-  
-  sendCustomSMSInternal(item.phoneNumber.c_str(), item.message.c_str());
-  
-  // Remove from queue by shifting
-  for (int i = highestPriorityIndex; i != queueTail; i = (i + 1) % MAX_SMS_QUEUE) {
-    int nextIndex = (i + 1) % MAX_SMS_QUEUE;
-    smsQueue[i] = smsQueue[nextIndex];
+  // Send the SMS; it stays queued if the AT engine cannot take it yet
+  Serial.printf("📱 Sending queued SMS (Priority %d): %s\n", item->priority, item->message);
+  if (!sendCustomSMSInternal(item->number, item->message, item->queueTime)) {
+    return false;
   }
-  queueCount--;
-  queueTail = (queueTail - 1 + MAX_SMS_QUEUE) % MAX_SMS_QUEUE;
+  smsOutboxPop(smsOutbox);
   
   *lastSendTime = currentTime;
   return true;
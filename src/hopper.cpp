@@ -0,0 +1,201 @@
+// hopper.cpp
+// Hopper level module for Smart Pet Feeder
+// Measures the food left in the hopper on the second ultrasonic channel
+
+#include <Arduino.h>
+#include "config.h"
+#include "hopper.h"
+#include "ultrasonic.h"
+#include "level_filter.h"
+#include "i2c_bus.h"
+#include "motor.h"
+#include "inventory.h"
+#include "gsm.h"
+
+// External global variables (defined in main.cpp)
+extern SystemState systemState;
+
+// External function declarations (defined in main.cpp)
+extern void playBuzzer(int duration, int frequency);
+
+// Food slides and cones in the hopper, so only a short median is used:
+// no outlier gate and no EMA, a refill has to show up within a few reads
+const LevelFilterConfig HOPPER_LEVEL_FILTER = {3, 0, 0};
+
+static bool hopperSensorFound = false;   // ACKed the start-up probe
+static bool hopperEmpty = false;
+static bool refusalAlertSent = false;   // One SMS per low hopper, cleared by a refill
+static LevelFilter hopperFilter;
+static float hopperGrams = -1.0f;
+static float settledGrams = -1.0f;      // Last level seen outside a feed
+static unsigned long lastHopperRead = 0;
+static uint32_t hopperErrors = 0;
+static uint32_t refusedMoves = 0;
+
+// ========================================
+// INITIALIZATION
+// ========================================
+
+void initializeHopperSensor() {
+  levelFilterInit(hopperFilter, HOPPER_LEVEL_FILTER);
+
+  hopperSensorFound = i2cProbe(HOPPER_SENSOR_ADDR);
+  if (hopperSensorFound) {
+    Serial.printf("✓ Hopper sensor found at 0x%02X\n", HOPPER_SENSOR_ADDR);
+  } else {
+    Serial.printf("⚠️ No hopper sensor at 0x%02X - hopper level not monitored\n", HOPPER_SENSOR_ADDR);
+  }
+}
+
+// ========================================
+// LEVEL UPDATES
+// ========================================
+
+// Linear between the empty and full marks (straight-walled hopper)
+static float gramsAtDistance(float distanceCm) {
+  float fill = (HOPPER_EMPTY_DISTANCE_CM - distanceCm) /
+               (HOPPER_EMPTY_DISTANCE_CM - HOPPER_FULL_DISTANCE_CM);
+  return constrain(fill, 0.0f, 1.0f) * HOPPER_CAPACITY_GRAMS;
+}
+
+// A rise of HOPPER_TOPUP_GRAMS outside a feed is a refill: it resets the
+// dead-reckoning inventory to what the sensor sees.
+static void detectRefill() {
+  if (isFeedInProgress()) {
+    return;
+  }
+  if (settledGrams >= 0 && hopperGrams - settledGrams >= HOPPER_TOPUP_GRAMS) {
+    markHopperRefilled(hopperGrams);
+  }
+  settledGrams = hopperGrams;
+}
+
+// Hysteresis between HOPPER_EMPTY_GRAMS and HOPPER_REFILLED_GRAMS drives
+// ALERT_EMPTY_HOPPER. A feed in progress keeps its state; the motor module
+// switches to the alert when the feed ends.
+static void analyzeHopperStatus() {
+  bool previousEmpty = hopperEmpty;
+  if (hopperGrams <= HOPPER_EMPTY_GRAMS) {
+    hopperEmpty = true;
+  } else if (hopperGrams >= HOPPER_REFILLED_GRAMS) {
+    hopperEmpty = false;
+    refusalAlertSent = false;
+  }
+
+  if (hopperEmpty == previousEmpty) {
+    return;
+  }
+
+  if (hopperEmpty) {
+    Serial.printf("🪣 ALERT: Hopper is EMPTY! (%.0f g left) - dispensing disabled\n", hopperGrams);
+    if (systemState == IDLE) {
+      systemState = ALERT_EMPTY_HOPPER;
+    }
+    playBuzzer(300, 800);
+  } else {
+    Serial.printf("🪣 INFO: Hopper refilled (%.0f g)\n", hopperGrams);
+    if (systemState == ALERT_EMPTY_HOPPER) {
+      systemState = IDLE;
+    }
+    playBuzzer(100, 2000);
+  }
+}
+
+// Non-blocking, like updateSensorReadings(). A hopper cycle is only
+// started while the bowl channel is idle.
+void updateHopperLevel() {
+  if (!hopperSensorFound) {
+    return;
+  }
+
+  UltrasonicSample sample;
+  if (ultrasonicUpdate(ULTRASONIC_HOPPER, micros(), sample)) {
+    if (sample.result == ULTRASONIC_OK) {
+      levelFilterAdd(hopperFilter, (uint16_t)(sample.distanceCm * 10.0f + 0.5f));
+      if (levelFilterReady(hopperFilter)) {
+        hopperGrams = gramsAtDistance(getHopperDistance());
+        detectRefill();
+        analyzeHopperStatus();
+      }
+    } else {
+      hopperErrors++;
+    }
+    return;
+  }
+
+  unsigned long interval = isFeedInProgress() ? HOPPER_FEEDING_INTERVAL : HOPPER_CHECK_INTERVAL;
+  if (!ultrasonicBusy(ULTRASONIC_HOPPER) && !ultrasonicBusy(ULTRASONIC_BOWL) &&
+      (lastHopperRead == 0 || millis() - lastHopperRead >= interval)) {
+    lastHopperRead = millis();
+    ultrasonicStart(ULTRASONIC_HOPPER, micros());
+  }
+}
+
+// ========================================
+// QUERIES
+// ========================================
+
+bool isHopperMonitored() {
+  return hopperSensorFound && hopperGrams >= 0;
+}
+
+bool isHopperEmpty() {
+  return hopperEmpty;
+}
+
+float getHopperDistance() {
+  if (!levelFilterReady(hopperFilter)) return -1.0f;
+  return levelFilterValueMm(hopperFilter) / 10.0f;
+}
+
+float getHopperGrams() {
+  return hopperGrams;
+}
+
+int getHopperPercent() {
+  if (hopperGrams < 0) return -1;
+  return (int)(hopperGrams * 100.0f / HOPPER_CAPACITY_GRAMS + 0.5f);
+}
+
+// Called before every dispense move. Without a hopper reading the move is
+// allowed (jam detection still catches an empty auger). A refusal can come
+// before ALERT_EMPTY_HOPPER (less than a portion above the empty mark), so
+// the first one sends the refill SMS.
+bool hopperCanDispense(float grams) {
+  if (!isHopperMonitored()) {
+    return true;
+  }
+  if (!hopperEmpty && hopperGrams - grams >= HOPPER_EMPTY_GRAMS) {
+    return true;
+  }
+  refusedMoves++;
+  Serial.printf("🪣 Move refused: %.0f g requested, %.0f g in hopper\n", grams, hopperGrams);
+
+  if (!refusalAlertSent) {
+    refusalAlertSent = true;
+    char info[120];
+    snprintf(info, sizeof(info), "Hopper too low to feed: ~%.0fg left, %.0fg needed. Feeding paused - please refill.",
+             hopperGrams, grams);
+    sendSMSAlert(SMS_HOPPER_LOW, info);
+  }
+  return false;
+}
+
+// ========================================
+// REPORTING
+// ========================================
+
+void printHopperStatus() {
+  if (!hopperSensorFound) {
+    Serial.println("   Hopper: not monitored");
+    return;
+  }
+  if (hopperGrams < 0) {
+    Serial.printf("   Hopper: waiting for readings (%lu errors)\n", (unsigned long)hopperErrors);
+    return;
+  }
+  Serial.printf("   Hopper: %.1f cm, ~%.0f g (%d%%)%s | %lu errors, %lu moves refused\n",
+                getHopperDistance(), hopperGrams, getHopperPercent(),
+                hopperEmpty ? " EMPTY" : "",
+                (unsigned long)hopperErrors, (unsigned long)refusedMoves);
+}
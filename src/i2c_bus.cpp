@@ -0,0 +1,294 @@
+// i2c_bus.cpp
+// I2C bus manager for Smart Pet Feeder
+// FreeRTOS task that owns Wire, serialises transactions and recovers the bus
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "config.h"
+#include "i2c_bus.h"
+
+// Recovery timing
+const int RECOVERY_CLOCK_PULSES = 9;       // Enough to finish any byte a slave is sending
+const uint32_t RECOVERY_HALF_PERIOD_US = 5; // ~100 kHz bit-banged clock
+
+static TaskHandle_t busTaskHandle = nullptr;
+static QueueHandle_t transactionQueue = nullptr;
+
+// Statistics (written by the bus task, read from loop())
+static I2CDeviceStats deviceStats[I2C_MAX_DEVICES];
+static uint32_t busRecoveries = 0;
+static portMUX_TYPE statsLock = portMUX_INITIALIZER_UNLOCKED;
+
+// ========================================
+// BUS CONTROL (bus task only)
+// ========================================
+
+static void beginBus() {
+  Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
+  Wire.setClock(I2C_BUS_CLOCK);
+  Wire.setTimeout(I2C_BUS_TIMEOUT);
+}
+
+// A slave that was interrupted mid-byte can hold SDA low forever. Clock
+// SCL by hand until it lets go, send a STOP, then restart Wire.
+static void recoverBus() {
+  Wire.end();
+
+  pinMode(I2C_SDA_PIN, INPUT_PULLUP);
+  pinMode(I2C_SCL_PIN, OUTPUT_OPEN_DRAIN);
+  digitalWrite(I2C_SCL_PIN, HIGH);
+  delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+
+  for (int i = 0; i < RECOVERY_CLOCK_PULSES && digitalRead(I2C_SDA_PIN) == LOW; i++) {
+    digitalWrite(I2C_SCL_PIN, LOW);
+    delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+    digitalWrite(I2C_SCL_PIN, HIGH);
+    delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+  }
+
+  // STOP condition: SDA rises while SCL is high
+  pinMode(I2C_SDA_PIN, OUTPUT_OPEN_DRAIN);
+  digitalWrite(I2C_SCL_PIN, LOW);
+  digitalWrite(I2C_SDA_PIN, LOW);
+  delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+  digitalWrite(I2C_SCL_PIN, HIGH);
+  delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+  digitalWrite(I2C_SDA_PIN, HIGH);
+  delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+
+  beginBus();
+
+  portENTER_CRITICAL(&statsLock);
+  busRecoveries++;
+  portEXIT_CRITICAL(&statsLock);
+}
+
+// One attempt: optional write phase, then optional read phase. With
+// neither, the address alone is sent so the device has to ACK it (probe).
+static uint8_t runTransaction(I2CTransaction& txn) {
+  txn.bytesRead = 0;
+
+  if (txn.writeLength == 0 && txn.readLength == 0) {
+    Wire.beginTransmission(txn.address);
+    return Wire.endTransmission();
+  }
+
+  if (txn.writeLength > 0) {
+    Wire.beginTransmission(txn.address);
+    Wire.write(txn.writeData, txn.writeLength);
+    uint8_t error = Wire.endTransmission();
+    if (error != 0) {
+      return error;
+    }
+  }
+
+  if (txn.readLength > 0) {
+    Wire.requestFrom(txn.address, txn.readLength);
+    while (txn.bytesRead < txn.readLength && Wire.available()) {
+      txn.readData[txn.bytesRead++] = Wire.read();
+    }
+    while (Wire.available()) {
+      Wire.read();
+    }
+    if (txn.bytesRead < txn.readLength) {
+      return I2C_ERROR_SHORT_READ;
+    }
+  }
+  return 0;
+}
+
+// Statistics slot for an address (allocated on first use, nullptr if full)
+static I2CDeviceStats* statsFor(uint8_t address) {
+  for (int i = 0; i < I2C_MAX_DEVICES; i++) {
+    if (deviceStats[i].address == address) return &deviceStats[i];
+  }
+  for (int i = 0; i < I2C_MAX_DEVICES; i++) {
+    if (deviceStats[i].address == 0) {
+      deviceStats[i].address = address;
+      return &deviceStats[i];
+    }
+  }
+  return nullptr;
+}
+
+static void recordStats(const I2CTransaction& txn) {
+  portENTER_CRITICAL(&statsLock);
+  I2CDeviceStats* stats = statsFor(txn.address);
+  if (stats != nullptr) {
+    stats->transactions++;
+    stats->errors[min((int)txn.error, I2C_ERROR_CODES - 1)]++;
+    stats->retries += txn.attempts - 1;
+    if (txn.error == 0) {
+      stats->latencySumUs += txn.transferUs;
+      if (txn.transferUs > stats->latencyMaxUs) stats->latencyMaxUs = txn.transferUs;
+    }
+    if (txn.queuedUs > stats->queueMaxUs) stats->queueMaxUs = txn.queuedUs;
+  }
+  portEXIT_CRITICAL(&statsLock);
+}
+
+// Bus-level failures (stuck line, arbitration, timeout) get a recovery
+// and a retry; NACKs are the device's answer and are reported as they are.
+static void executeTransaction(I2CTransaction& txn) {
+  txn.queuedUs = micros() - txn.queuedUs;
+  txn.attempts = 0;
+
+  for (;;) {
+    unsigned long start = micros();
+    txn.error = runTransaction(txn);
+    txn.transferUs = micros() - start;
+    txn.attempts++;
+
+    bool busFault = (txn.error == I2C_ERROR_OTHER || txn.error == I2C_ERROR_TIMEOUT);
+    if (!busFault || txn.attempts > I2C_MAX_RETRIES) {
+      break;
+    }
+    recoverBus();
+  }
+  txn.doneUs = micros();
+
+  recordStats(txn);
+  txn.state = I2C_DONE;
+}
+
+static void busTask(void* parameter) {
+  beginBus();
+
+  I2CTransaction* txn;
+  for (;;) {
+    if (xQueueReceive(transactionQueue, &txn, portMAX_DELAY) == pdTRUE) {
+      executeTransaction(*txn);
+    }
+  }
+}
+
+// ========================================
+// PUBLIC INTERFACE
+// ========================================
+
+bool initializeI2CBus() {
+  if (transactionQueue != nullptr) {
+    return true;
+  }
+
+  transactionQueue = xQueueCreate(I2C_QUEUE_LENGTH, sizeof(I2CTransaction*));
+  if (transactionQueue == nullptr) {
+    Serial.println("✗ ERROR: I2C queue could not be created");
+    return false;
+  }
+
+  BaseType_t created = xTaskCreatePinnedToCore(busTask, "i2c", I2C_TASK_STACK, nullptr,
+                                               I2C_TASK_PRIORITY, &busTaskHandle, I2C_TASK_CORE);
+  if (created != pdPASS) {
+    Serial.println("✗ ERROR: I2C bus task could not be started");
+    return false;
+  }
+
+  Serial.printf("✓ I2C bus manager running (SDA:%d, SCL:%d, %d kHz)\n",
+                I2C_SDA_PIN, I2C_SCL_PIN, I2C_BUS_CLOCK / 1000);
+  return true;
+}
+
+// Queue a transaction. The result is ready once txn.state is I2C_DONE.
+bool i2cSubmit(I2CTransaction& txn) {
+  if (transactionQueue == nullptr || txn.state == I2C_QUEUED) {
+    return false;
+  }
+
+  I2CTransaction* pointer = &txn;
+  txn.state = I2C_QUEUED;
+  txn.queuedUs = micros();
+  if (xQueueSend(transactionQueue, &pointer, 0) != pdTRUE) {
+    txn.state = I2C_IDLE;
+    return false;
+  }
+  return true;
+}
+
+// Submit and wait. On a timeout the transaction stays queued, so txn must
+// not live on the caller's stack.
+bool i2cTransfer(I2CTransaction& txn, unsigned long timeoutMs) {
+  if (!i2cSubmit(txn)) {
+    return false;
+  }
+  unsigned long start = millis();
+  while (txn.state != I2C_DONE) {
+    if (millis() - start > timeoutMs) {
+      return false;
+    }
+    delay(1);
+  }
+  return txn.error == 0;
+}
+
+// Address-only write: does a device acknowledge at this address?
+bool i2cProbe(uint8_t address) {
+  static I2CTransaction probe;
+  if (probe.state == I2C_QUEUED) {
+    return false; // Previous probe still waiting for the bus
+  }
+  probe.address = address;
+  probe.writeLength = 0;
+  probe.readLength = 0;
+  if (!i2cSubmit(probe)) {
+    return false;
+  }
+  unsigned long start = millis();
+  while (probe.state != I2C_DONE && millis() - start < 100) {
+    delay(1);
+  }
+  if (probe.state != I2C_DONE) {
+    return false;
+  }
+  probe.state = I2C_IDLE;
+  return probe.error == 0;
+}
+
+// ========================================
+// STATISTICS
+// ========================================
+
+bool getI2CDeviceStats(uint8_t address, I2CDeviceStats& stats) {
+  bool found = false;
+  portENTER_CRITICAL(&statsLock);
+  for (int i = 0; i < I2C_MAX_DEVICES; i++) {
+    if (deviceStats[i].address == address) {
+      stats = deviceStats[i];
+      found = true;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&statsLock);
+  return found;
+}
+
+uint32_t getI2CBusRecoveries() {
+  portENTER_CRITICAL(&statsLock);
+  uint32_t recoveries = busRecoveries;
+  portEXIT_CRITICAL(&statsLock);
+  return recoveries;
+}
+
+void printI2CBusStatus() {
+  Serial.printf("   I2C bus: %lu recoveries\n", (unsigned long)getI2CBusRecoveries());
+  for (int i = 0; i < I2C_MAX_DEVICES; i++) {
+    I2CDeviceStats stats;
+    portENTER_CRITICAL(&statsLock);
+    stats = deviceStats[i];
+    portEXIT_CRITICAL(&statsLock);
+    if (stats.address == 0) continue;
+
+    uint32_t ok = stats.errors[0];
+    Serial.printf("   0x%02X: %lu txn, %lu ok | NACK a/d %lu/%lu, other %lu, timeout %lu, short %lu | retries %lu\n",
+                  stats.address, (unsigned long)stats.transactions, (unsigned long)ok,
+                  (unsigned long)stats.errors[I2C_ERROR_NACK_ADDRESS],
+                  (unsigned long)stats.errors[I2C_ERROR_NACK_DATA],
+                  (unsigned long)stats.errors[I2C_ERROR_OTHER],
+                  (unsigned long)stats.errors[I2C_ERROR_TIMEOUT],
+                  (unsigned long)stats.errors[I2C_ERROR_SHORT_READ],
+                  (unsigned long)stats.retries);
+    Serial.printf("         latency avg %lu us, max %lu us | queue wait max %lu us\n",
+                  ok > 0 ? (unsigned long)(stats.latencySumUs / ok) : 0UL,
+                  (unsigned long)stats.latencyMaxUs, (unsigned long)stats.queueMaxUs);
+  }
+}
@@ -0,0 +1,193 @@
+// inventory.cpp
+// Hopper inventory module for Smart Pet Feeder
+// Tracks the food left in the hopper from the auger travel and projects the refill date
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "config.h"
+#include "inventory.h"
+#include "motion.h"
+#include "step_engine.h"
+#include "calibration.h"
+#include "motor.h"
+#include "gsm.h"
+
+// External global variables (defined in main.cpp)
+extern FeedingMode currentMode;
+
+const unsigned long MIN_RATE_WINDOW_MS = 60UL * 60 * 1000; // Extrapolate today only after an hour
+const float MS_PER_DAY = 24.0f * 60 * 60 * 1000;
+
+static InventoryState inventory = {};
+static long accountedPosition = 0;   // Motor position already subtracted
+static unsigned long dayStart = 0;
+static bool dayStartKnown = false;   // False after a reboot until the next day roll
+static float unsavedGrams = 0.0f;    // Auger travel not yet written to NVS
+static Preferences inventoryStore;
+
+static void saveInventory() {
+  unsavedGrams = 0.0f;
+  if (inventoryStore.begin("inventory", false)) {
+    inventoryStore.putBytes("state", &inventory, sizeof(InventoryState));
+    inventoryStore.end();
+  }
+}
+
+// ========================================
+// INITIALIZATION
+// ========================================
+
+void initializeInventory() {
+  bool restored = false;
+  if (inventoryStore.begin("inventory", true)) {
+    InventoryState stored;
+    if (inventoryStore.getBytes("state", &stored, sizeof(stored)) == sizeof(stored) &&
+        stored.refillGrams > 0 && stored.dayCount <= INVENTORY_RATE_DAYS) {
+      inventory = stored;
+      restored = true;
+    }
+    inventoryStore.end();
+  }
+
+  if (!restored) {
+    // First boot: assume the hopper was filled
+    inventory = {};
+    inventory.refillGrams = HOPPER_CAPACITY_GRAMS;
+  }
+
+  // millis() restarts at boot, so a restored day has no start time:
+  // todayGrams covers time before the reboot
+  accountedPosition = getMotorPosition();
+  dayStart = millis();
+  dayStartKnown = !restored;
+
+  Serial.printf("✓ Hopper inventory %s: ~%.0f g left\n",
+                restored ? "restored" : "started", getInventoryGrams());
+}
+
+// ========================================
+// ACCOUNTING
+// ========================================
+
+static void checkLowHopper() {
+  if (inventory.lowAlertSent) {
+    return;
+  }
+
+  float grams = getInventoryGrams();
+  float days = getDaysUntilEmpty();
+  if (grams > INVENTORY_LOW_GRAMS && (days < 0 || days > INVENTORY_LOW_DAYS)) {
+    return;
+  }
+
+  inventory.lowAlertSent = true;
+  saveInventory();
+
+  // No real-time clock: the date is given relative to now
+  char info[120];
+  if (days >= 0) {
+    snprintf(info, sizeof(info), "Hopper low: ~%.0fg left, using %.0fg/day. Predicted empty in %.1f days - please refill.",
+             grams, getInventoryDailyRate(), days);
+  } else {
+    snprintf(info, sizeof(info), "Hopper low: ~%.0fg left - please refill.", grams);
+  }
+  Serial.printf("🪣 %s\n", info);
+  sendSMSAlert(SMS_HOPPER_LOW, info);
+}
+
+// Motor position only changes when a move finishes, so this is one
+// comparison per loop(). NVS is written once the feed is over, or every
+// INVENTORY_SAVE_GRAMS of travel during a long one.
+void updateInventory() {
+  long position = getMotorPosition();
+  long microsteps = position - accountedPosition;
+  if (microsteps != 0) {
+    accountedPosition = position;
+
+    // Net travel: agitation pushes food back as much as it moves it forward
+    float steps = (float)microsteps / MICROSTEPS_PER_STEP;
+    float grams = steps / getStepsPerGram(currentMode);
+    inventory.dispensedGrams += grams;
+    inventory.todayGrams += grams;
+    unsavedGrams += fabsf(grams);
+    checkLowHopper();
+  }
+
+  if (unsavedGrams > 0 && (!isFeedInProgress() || unsavedGrams >= INVENTORY_SAVE_GRAMS)) {
+    saveInventory();
+  }
+}
+
+void markHopperRefilled(float grams) {
+  inventory.refillGrams = grams;
+  inventory.dispensedGrams = 0.0f;
+  inventory.lowAlertSent = false;
+  saveInventory();
+  Serial.printf("🪣 Hopper refilled: inventory set to %.0f g\n", grams);
+}
+
+void rollInventoryDay() {
+  inventory.dailyGrams[inventory.dayHead] = inventory.todayGrams;
+  inventory.dayHead = (inventory.dayHead + 1) % INVENTORY_RATE_DAYS;
+  if (inventory.dayCount < INVENTORY_RATE_DAYS) inventory.dayCount++;
+  inventory.todayGrams = 0.0f;
+  dayStart = millis();
+  dayStartKnown = true;
+  saveInventory();
+
+  checkLowHopper();
+}
+
+// ========================================
+// QUERIES
+// ========================================
+
+float getInventoryGrams() {
+  float grams = inventory.refillGrams - inventory.dispensedGrams;
+  return grams > 0 ? grams : 0.0f;
+}
+
+// Average of the completed days; before the first day is complete,
+// today's amount extrapolated over the time elapsed (not after a reboot,
+// which loses the day's start)
+float getInventoryDailyRate() {
+  if (inventory.dayCount > 0) {
+    float total = 0.0f;
+    for (int i = 0; i < inventory.dayCount; i++) {
+      total += inventory.dailyGrams[i];
+    }
+    return total / inventory.dayCount;
+  }
+
+  unsigned long elapsed = millis() - dayStart;
+  if (!dayStartKnown || elapsed < MIN_RATE_WINDOW_MS || inventory.todayGrams <= 0) {
+    return -1.0f;
+  }
+  return inventory.todayGrams * MS_PER_DAY / elapsed;
+}
+
+float getDaysUntilEmpty() {
+  float rate = getInventoryDailyRate();
+  if (rate <= 0) return -1.0f;
+  return getInventoryGrams() / rate;
+}
+
+const InventoryState& getInventoryState() {
+  return inventory;
+}
+
+// ========================================
+// REPORTING
+// ========================================
+
+void printInventoryStatus() {
+  float rate = getInventoryDailyRate();
+  Serial.printf("   Inventory: ~%.0f g of %.0f g left | today %.0f g", getInventoryGrams(),
+                inventory.refillGrams, inventory.todayGrams);
+  if (rate > 0) {
+    Serial.printf(" | %.0f g/day (%d day avg), empty in %.1f days\n",
+                  rate, inventory.dayCount, getDaysUntilEmpty());
+  } else {
+    Serial.println(" | rate not known yet");
+  }
+}
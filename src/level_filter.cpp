@@ -0,0 +1,141 @@
+// level_filter.cpp
+// Ultrasonic level filter for Smart Pet Feeder
+// Outlier rejection, median and EMA stages over a fixed ring buffer
+
+#include "config.h"
+#include "level_filter.h"
+
+static_assert(BOWL_FILTER_MEDIAN_WINDOW >= 1 && BOWL_FILTER_MEDIAN_WINDOW <= LEVEL_FILTER_MAX_WINDOW,
+              "BOWL_FILTER_MEDIAN_WINDOW must be 1..LEVEL_FILTER_MAX_WINDOW");
+static_assert(BOWL_FILTER_EMA_SHIFT < 16, "BOWL_FILTER_EMA_SHIFT too large");
+
+// ========================================
+// STAGES
+// ========================================
+
+// Median of the samples in the ring (insertion sort, at most 9 entries)
+static uint16_t ringMedian(const LevelFilter& filter) {
+  uint16_t sorted[LEVEL_FILTER_MAX_WINDOW];
+  int n = filter.count;
+  for (int i = 0; i < n; i++) {
+    uint16_t value = filter.ring[i];
+    int j = i;
+    while (j > 0 && sorted[j - 1] > value) {
+      sorted[j] = sorted[j - 1];
+      j--;
+    }
+    sorted[j] = value;
+  }
+  // Even counts (while filling up) take the lower middle
+  return sorted[(n - 1) / 2];
+}
+
+static bool isOutlier(const LevelFilter& filter, uint16_t sampleMm) {
+  if (filter.config.outlierMm == 0 || filter.count < filter.config.medianWindow) {
+    return false; // Stage off, or not enough history to judge
+  }
+  int diff = (int)sampleMm - (int)filter.medianMm;
+  if (diff < 0) diff = -diff;
+  return diff > filter.config.outlierMm;
+}
+
+// True if sampleMm lies within outlierMm of every sample in the reject run
+static bool clustersWithRejects(const LevelFilter& filter, uint16_t sampleMm) {
+  for (int i = 0; i < filter.rejectStreak; i++) {
+    int diff = (int)sampleMm - (int)filter.rejectRing[i];
+    if (diff < 0) diff = -diff;
+    if (diff > filter.config.outlierMm) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// ========================================
+// FILTER CONTROL
+// ========================================
+
+void levelFilterInit(LevelFilter& filter, const LevelFilterConfig& config) {
+  filter.config = config;
+  if (filter.config.medianWindow < 1) filter.config.medianWindow = 1;
+  if (filter.config.medianWindow > LEVEL_FILTER_MAX_WINDOW) filter.config.medianWindow = LEVEL_FILTER_MAX_WINDOW;
+  if (filter.config.emaShift > 15) filter.config.emaShift = 15;
+  levelFilterReset(filter);
+}
+
+void levelFilterReset(LevelFilter& filter) {
+  filter.head = 0;
+  filter.count = 0;
+  filter.rejectStreak = 0;
+  filter.rawMm = 0;
+  filter.medianMm = 0;
+  filter.emaQ8 = 0;
+  filter.accepted = 0;
+  filter.rejected = 0;
+}
+
+// Feed one raw sample. Returns false if it was rejected as an outlier.
+bool levelFilterAdd(LevelFilter& filter, uint16_t sampleMm) {
+  filter.rawMm = sampleMm;
+
+  if (isOutlier(filter, sampleMm)) {
+    // A sample that does not agree with the run so far starts a new run
+    if (!clustersWithRejects(filter, sampleMm)) {
+      filter.rejectStreak = 0;
+    }
+    filter.rejectRing[filter.rejectStreak++] = sampleMm;
+    if (filter.rejectStreak < filter.config.medianWindow) {
+      filter.rejected++;
+      return false;
+    }
+    // A full window of agreeing "outliers" is a real level change: start
+    // over from the run, the EMA included
+    for (int i = 0; i < filter.rejectStreak; i++) {
+      filter.ring[i] = filter.rejectRing[i];
+    }
+    filter.count = filter.rejectStreak;
+    filter.head = filter.rejectStreak % filter.config.medianWindow;
+    filter.medianMm = ringMedian(filter);
+    filter.emaQ8 = (int32_t)filter.medianMm << 8;
+    filter.rejectStreak = 0;
+    filter.accepted++;
+    return true;
+  }
+  filter.rejectStreak = 0;
+  filter.accepted++;
+
+  bool first = (filter.count == 0);
+  filter.ring[filter.head] = sampleMm;
+  filter.head = (filter.head + 1) % filter.config.medianWindow;
+  if (filter.count < filter.config.medianWindow) filter.count++;
+
+  filter.medianMm = ringMedian(filter);
+
+  int32_t targetQ8 = (int32_t)filter.medianMm << 8;
+  if (first || filter.config.emaShift == 0) {
+    filter.emaQ8 = targetQ8;
+  } else {
+    filter.emaQ8 += (targetQ8 - filter.emaQ8) >> filter.config.emaShift;
+  }
+  return true;
+}
+
+// ========================================
+// FILTER OUTPUTS
+// ========================================
+
+bool levelFilterReady(const LevelFilter& filter) {
+  return filter.count > 0;
+}
+
+uint16_t levelFilterRawMm(const LevelFilter& filter) {
+  return filter.rawMm;
+}
+
+uint16_t levelFilterMedianMm(const LevelFilter& filter) {
+  return filter.medianMm;
+}
+
+uint16_t levelFilterValueMm(const LevelFilter& filter) {
+  return (uint16_t)((filter.emaQ8 + 128) >> 8);
+}
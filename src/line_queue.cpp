@@ -0,0 +1,49 @@
+// line_queue.cpp
+// Modem line queue for Smart Pet Feeder
+// Lock-free SPSC ring between the UART receive side and the AT engine
+
+#include <string.h>
+#include "line_queue.h"
+
+static_assert((GSM_LINE_QUEUE_LENGTH & (GSM_LINE_QUEUE_LENGTH - 1)) == 0,
+              "GSM_LINE_QUEUE_LENGTH must be a power of two");
+
+void lineQueueInit(LineQueue& queue) {
+  queue.head.store(0, std::memory_order_relaxed);
+  queue.tail.store(0, std::memory_order_relaxed);
+  queue.dropped.store(0, std::memory_order_relaxed);
+}
+
+bool lineQueuePush(LineQueue& queue, const char* line, uint32_t stampUs) {
+  uint32_t head = queue.head.load(std::memory_order_relaxed);
+  uint32_t tail = queue.tail.load(std::memory_order_acquire);
+  if (head - tail >= (uint32_t)GSM_LINE_QUEUE_LENGTH) {
+    queue.dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  uint32_t slot = head & (GSM_LINE_QUEUE_LENGTH - 1);
+  strncpy(queue.lines[slot], line, LINE_QUEUE_LINE_LENGTH - 1);
+  queue.lines[slot][LINE_QUEUE_LINE_LENGTH - 1] = '\0';
+  queue.stampUs[slot] = stampUs;
+  queue.head.store(head + 1, std::memory_order_release); // Publishes the slot
+  return true;
+}
+
+bool lineQueuePop(LineQueue& queue, char* line, int maxLength, uint32_t& stampUs) {
+  uint32_t tail = queue.tail.load(std::memory_order_relaxed);
+  if (tail == queue.head.load(std::memory_order_acquire)) {
+    return false;
+  }
+
+  uint32_t slot = tail & (GSM_LINE_QUEUE_LENGTH - 1);
+  strncpy(line, queue.lines[slot], maxLength - 1);
+  line[maxLength - 1] = '\0';
+  stampUs = queue.stampUs[slot];
+  queue.tail.store(tail + 1, std::memory_order_release); // Hands the slot back
+  return true;
+}
+
+bool lineQueueEmpty(const LineQueue& queue) {
+  return queue.tail.load(std::memory_order_relaxed) == queue.head.load(std::memory_order_acquire);
+}
@@ -0,0 +1,77 @@
+// line_tokenizer.cpp
+// Modem line tokenizer for Smart Pet Feeder
+// Incremental CR/LF splitting over a fixed byte ring
+
+#include "line_tokenizer.h"
+
+static_assert((LINE_TOKENIZER_BYTES & (LINE_TOKENIZER_BYTES - 1)) == 0,
+              "LINE_TOKENIZER_BYTES must be a power of two");
+
+static char ringAt(const LineTokenizer& tokenizer, uint16_t index) {
+  return tokenizer.ring[index & (LINE_TOKENIZER_BYTES - 1)];
+}
+
+static bool isLineEnd(char c) {
+  return c == '\r' || c == '\n';
+}
+
+void lineTokenizerInit(LineTokenizer& tokenizer) {
+  tokenizer.head = 0;
+  tokenizer.tail = 0;
+  tokenizer.scanned = 0;
+  tokenizer.overflows = 0;
+}
+
+int lineTokenizerWrite(LineTokenizer& tokenizer, const char* data, int length) {
+  uint16_t space = LINE_TOKENIZER_BYTES - (uint16_t)(tokenizer.head - tokenizer.tail);
+  int taken = length < space ? length : space;
+  for (int i = 0; i < taken; i++) {
+    tokenizer.ring[(tokenizer.head + i) & (LINE_TOKENIZER_BYTES - 1)] = data[i];
+  }
+  tokenizer.head += taken;
+  tokenizer.overflows += length - taken;
+  return taken;
+}
+
+bool lineTokenizerNext(LineTokenizer& tokenizer, char* line, int maxLength) {
+  while (true) {
+    // Skip line ends left over from the previous line (CR LF, blank lines)
+    while (tokenizer.tail != tokenizer.head && isLineEnd(ringAt(tokenizer, tokenizer.tail))) {
+      tokenizer.tail++;
+      tokenizer.scanned = 0;
+    }
+
+    uint16_t pending = tokenizer.head - tokenizer.tail;
+    while (tokenizer.scanned < pending && !isLineEnd(ringAt(tokenizer, tokenizer.tail + tokenizer.scanned))) {
+      tokenizer.scanned++;
+    }
+    if (tokenizer.scanned == pending) {
+      // No line end yet; a full ring of one line is handed out as is
+      if (pending < LINE_TOKENIZER_BYTES || pending == 0) {
+        return false;
+      }
+    }
+
+    int length = 0;
+    for (uint16_t i = 0; i < tokenizer.scanned && length < maxLength - 1; i++) {
+      line[length++] = ringAt(tokenizer, tokenizer.tail + i);
+    }
+    line[length] = '\0';
+    tokenizer.tail += tokenizer.scanned;
+    tokenizer.scanned = 0;
+    if (length > 0) {
+      return true;
+    }
+  }
+}
+
+bool lineTokenizerPrompt(const LineTokenizer& tokenizer) {
+  uint16_t pending = tokenizer.head - tokenizer.tail;
+  return pending >= 2 && ringAt(tokenizer, tokenizer.tail) == '>' &&
+         ringAt(tokenizer, tokenizer.tail + 1) == ' ';
+}
+
+void lineTokenizerSkipPartial(LineTokenizer& tokenizer) {
+  tokenizer.tail = tokenizer.head;
+  tokenizer.scanned = 0;
+}
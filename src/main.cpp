@@ -26,11 +26,16 @@
  */
 
 #include <Arduino.h>
-#include <Wire.h>  // For I2C communication
+#include "i2c_bus.h" // I2C bus manager (owns Wire)
 #include "config.h"
 #include "sensor.h"  // Include sensor module header
 #include "motor.h"   // Include motor module header
 #include "gsm.h"     // Include GSM module header (Phase 5)
+#include "bowl_model.h"
+#include "eating_monitor.h"
+#include "hopper.h"
+#include "inventory.h"
+#include "auto_feed.h"
 
 // Global variables for input handling
 bool lastButtonState = HIGH;
@@ -52,20 +57,17 @@ unsigned long lastSensorRead = 0;
 bool bowlEmpty = false;
 bool sensorInitialized = false;
 
-// Phase 4: Automatic feeding variables
-unsigned long lastAutoFeedTime = 0;
-unsigned long lastAutoFeedCheck = 0;
-unsigned long bowlEmptyStartTime = 0;
-bool bowlEmptyConfirmed = false;
-int dailyAutoFeedCount = 0;
-unsigned long dailyResetTime = 0;
-bool automaticFeedingEnabled = true;
+// Phase 4: Automatic feeding state (see auto_feed.h)
+AutoFeedState autoFeed;
+AutoFeedState replayAutoFeed;  // Dry run on a sensor replay, never dispenses
 
 // Function declarations (non-sensor functions)
 void initializeSystem();
 void handleManualControls();
+void handleSerialCommands();
 void handleAutomaticFeeding();
 void performAutomaticFeed();
+void replayAutomaticFeeding();
 void resetDailyFeedCount();
 void playBuzzer(int duration, int frequency = 2000);
 void playStartupSequence();
@@ -96,29 +98,54 @@ void setup() {
   Serial.println("\nPhase 5 Ready! SMS alert system active...");
   Serial.println("- Manual feed: Press feed button anytime");  
   Serial.println("- Mode toggle: Press mode button for Cat/Dog switching");
-  Serial.println("- Auto feed: System will feed when bowl is empty for 1 minute");
+  Serial.printf("- Auto feed: System will feed when bowl is empty for %d seconds\n",
+                BOWL_EMPTY_CONFIRMATION_TIME / 1000);
   Serial.println("- Safety: Max 8 automatic feeds per day, 30min intervals");
   Serial.println("- SMS Alerts: Automatic feeding, manual feeding, and system status");
   Serial.println("- Test SMS: GSM module will send alerts to +639291145133");
+  Serial.println("- Serial: 's' = status, 'h' = sensor health, 't' = dump bowl sensor trace");
+  Serial.println("          'b' = ramp profile benchmark, 'p' = profile simulation (CSV),");
+  Serial.println("          'm' = microstep benchmark, 'c' = calibrate bowl, 'd0.45' = food density (g/ml),");
+  Serial.println("          'n' = nominal bowl geometry, 'r' = replay the bowl sensor trace,");
+  Serial.println("          'e' = clear a feeding error (after checking the auger)");
   Serial.println("==========================================\n");
 }
 
 void loop() {
   // Update ultrasonic sensor readings
   updateSensorReadings();
+  updateHopperLevel();
   
-  // Update GSM status (Phase 5) - non-blocking
+  // Bowl calibration pours and readings (idle unless started with 'c')
+  updateBowlCalibration();
+  
+  // Subtract finished auger moves from the hopper inventory
+  updateInventory();
+  
+  // Finish any background motor move
+  updateMotor();
+  
+  // Update GSM status (Phase 5). AT commands run in the background, but
+  // new SMS sends wait for the end of a running feed as planned by
+  // estimateFeed(), so the SIM800L's transmit bursts stay off the motor
+  // supply. A feed that overruns its plan holds them no longer.
+  unsigned long feedRemainingMs = getFeedTimeRemaining();
+  deferGSMTraffic(feedRemainingMs);
   updateGSMStatus();
   
   // Handle manual controls (button and switch)
   handleManualControls();
   
+  // Diagnostics requested over the USB serial port
+  handleSerialCommands();
+  
   // Phase 4: Automatic feeding logic based on bowl status
   handleAutomaticFeeding();
   
-  // Print sensor status every 2 seconds
+  // Print sensor status every 2 seconds, except while a feed is predicted
+  // to run (the closed loop logs its own readings)
   static unsigned long lastDebugPrint = 0;
-  if (millis() - lastDebugPrint > 2000) {
+  if (feedRemainingMs == 0 && millis() - lastDebugPrint > 2000) {
     // Only print sensor debug info
     printSensorDebug();
     lastDebugPrint = millis();
@@ -146,9 +173,22 @@ void initializeSystem() {
   pinMode(BUZZER_PIN, OUTPUT);
   digitalWrite(BUZZER_PIN, LOW); // Ensure buzzer starts off
   
+  // Eating session history (PSRAM) before the first bowl reading
+  initializeEatingMonitor();
+  
   // Initialize I2C for ultrasonic sensor
   initializeUltrasonicSensor();
   
+  // Hopper level sensor on the same bus
+  initializeHopperSensor();
+  
+  // Dead-reckoning hopper inventory. Holding the feed button during
+  // power-up marks the hopper as refilled (no hopper sensor needed).
+  initializeInventory();
+  if (digitalRead(FEED_BUTTON_PIN) == LOW) {
+    markHopperRefilled();
+  }
+  
   // Initialize stepper motor
   initializeMotor();
   
@@ -164,13 +204,7 @@ void initializeSystem() {
   currentMode = (lastModeState == LOW) ? DOG_MODE : CAT_MODE;
   
   // Initialize Phase 4: Automatic feeding variables
-  lastAutoFeedTime = 0;  // Allow immediate feeding on startup
-  lastAutoFeedCheck = 0;
-  bowlEmptyStartTime = 0;
-  bowlEmptyConfirmed = false;
-  dailyAutoFeedCount = 0;
-  dailyResetTime = millis();
-  automaticFeedingEnabled = true;
+  autoFeedInit(autoFeed, millis());
   
   Serial.println("✓ GPIO pins configured");
   Serial.println("✓ I2C ultrasonic sensor initialized");
@@ -187,14 +221,17 @@ void handleManualControls() {
   if (readButtonWithDebounce(FEED_BUTTON_PIN, lastButtonState, lastDebounceTime)) {
     Serial.println("\n🔘 MANUAL FEED BUTTON PRESSED!");
     
-    // Prepare SMS alert message
-    String feedInfo = (currentMode == CAT_MODE) ? "CAT (20g)" : "DOG (50g)";
+    // Prepare SMS alert message (portion and bowl level in grams)
+    int portionSteps = getPortionSteps();
+    char feedInfo[64];
+    snprintf(feedInfo, sizeof(feedInfo), "%s (~%.0fg, bowl had %.0fg)",
+             (currentMode == CAT_MODE) ? "CAT" : "DOG", stepsToGrams(portionSteps), getBowlGrams());
     
-    // Trigger manual feeding using motor control
-    manualFeed();
-    
-    // Send SMS alert for manual feed (Phase 5)
-    sendSMSAlert(SMS_MANUAL_FEED, feedInfo.c_str());
+    // Trigger manual feeding using motor control; only report a feed that started
+    if (manualFeed()) {
+      // Send SMS alert for manual feed (Phase 5)
+      sendSMSAlert(SMS_MANUAL_FEED, feedInfo);
+    }
   }
   
   // Check mode button (toggle between CAT and DOG modes)
@@ -222,6 +259,72 @@ void handleManualControls() {
   }
 }
 
+// Single-character diagnostic commands on the USB serial port
+void handleSerialCommands() {
+  while (Serial.available()) {
+    char command = Serial.read();
+    switch (command) {
+      case 't':
+        // Bowl sensor trace for offline replay (see sensor_trace.h)
+        dumpSensorTrace();
+        break;
+      case 's':
+        printSystemStatus();
+        break;
+      case 'h':
+        printSensorHealth();
+        break;
+      case 'b':
+        printProfileBenchmark();
+        break;
+      case 'p':
+        printProfileSimulation(CAT_MIN_PORTION);
+        break;
+      case 'm':
+        printMicrostepBenchmark();
+        break;
+      case 'c':
+        // Walks through the pours over the serial monitor while loop() runs
+        if (isFeedInProgress()) {
+          Serial.println("Feeding in progress - bowl calibration refused");
+        } else {
+          startBowlCalibration();
+        }
+        break;
+      case 'd': {
+        // Density in g/ml follows the letter, e.g. "d0.45"
+        float density = Serial.parseFloat();
+        if (density > 0) {
+          setFoodDensity(density);
+        } else {
+          Serial.println("Usage: d<grams per ml>, e.g. d0.45");
+        }
+        break;
+      }
+      case 'n':
+        resetBowlModel();
+        break;
+      case 'e':
+        if (!clearFeedingError()) {
+          Serial.println("No feeding error to clear");
+        }
+        break;
+      case 'r':
+        // Recorded cycles drive the bowl status instead of the sensor;
+        // automatic feeding only logs what it would have done
+        if (isFeedInProgress() || isBowlCalibrating()) {
+          Serial.println("Feeding or calibration in progress - sensor replay refused");
+        } else if (!isSensorReplayActive()) {
+          autoFeedInit(replayAutoFeed, getSensorTrace().baseTimeMs);
+          beginSensorReplay(getSensorTrace());
+        }
+        break;
+      default:
+        break;
+    }
+  }
+}
+
 bool readButtonWithDebounce(int pin, bool &lastState, unsigned long &lastDebounceTime) {
   bool currentState = digitalRead(pin);
   bool buttonPressed = false;
@@ -287,24 +390,40 @@ void printSystemStatus() {
     default: Serial.println("UNKNOWN"); break;
   }
   
-  Serial.printf("   Distance: %.1f cm\n", currentDistance);
+  Serial.printf("   Distance: %.1f cm (raw %.1f cm)\n", currentDistance, getRawDistance());
   Serial.printf("   Bowl Status: %s\n", bowlEmpty ? "EMPTY" : "HAS FOOD");
+  printBowlModelStatus();
+  printEatingStatus();
   Serial.printf("   Sensor: %s\n", sensorInitialized ? "ONLINE" : "ERROR");
+  printSamplingStatus();
+  printSensorHealth();
+  printHopperStatus();
+  printInventoryStatus();
+  printI2CBusStatus();
   
   // Add motor status
   printMotorStatus();
   
+  // Planned cost of the next portion (manual and automatic feeds are the same size)
+  int portionSteps = getPortionSteps();
+  DispenseEstimate plan = estimateFeed(portionSteps);
+  Serial.printf("   Portion plan: %d steps (~%.0fg), %.1f s (motor %.1f s)\n",
+                portionSteps, stepsToGrams(portionSteps), plan.totalMs / 1000.0, plan.motorMs / 1000.0);
+  
   // Phase 5: Add GSM status
   printGSMStatus();
   
   // Phase 4: Add automatic feeding status
-  Serial.printf("   Auto Feeding: %s\n", automaticFeedingEnabled ? "ENABLED" : "DISABLED");
-  Serial.printf("   Daily Auto Feeds: %d/%d\n", dailyAutoFeedCount, MAX_DAILY_AUTO_FEEDS);
-  Serial.printf("   Last Auto Feed: %lu min ago\n", (millis() - lastAutoFeedTime) / 60000);
-  if (bowlEmpty && bowlEmptyConfirmed) {
+  Serial.printf("   Auto Feeding: %s\n", autoFeed.enabled ? "ENABLED" : "DISABLED");
+  Serial.printf("   Daily Auto Feeds: %d/%d\n", autoFeed.dailyCount, MAX_DAILY_AUTO_FEEDS);
+  Serial.printf("   Last Auto Feed: %lu min ago\n", (millis() - autoFeed.lastFeedTime) / 60000);
+  if (autoFeedRetryHeld(autoFeed, millis())) {
+    Serial.printf("   Next Auto Feed: retry in %lu sec (hopper too low for a portion)\n",
+                  autoFeedRetryIn(autoFeed, millis()) / 1000);
+  } else if (bowlEmpty && autoFeed.confirmed) {
     Serial.printf("   Next Auto Feed: READY (bowl confirmed empty)\n");
-  } else if (bowlEmpty && bowlEmptyStartTime > 0) {
-    unsigned long elapsedTime = millis() - bowlEmptyStartTime;
+  } else if (bowlEmpty && autoFeed.emptySince > 0) {
+    unsigned long elapsedTime = millis() - autoFeed.emptySince;
     if (elapsedTime < BOWL_EMPTY_CONFIRMATION_TIME) {
       unsigned long timeLeft = BOWL_EMPTY_CONFIRMATION_TIME - elapsedTime;
       Serial.printf("   Next Auto Feed: %lu sec (confirming empty bowl)\n", timeLeft / 1000);
@@ -326,91 +445,101 @@ void printSystemStatus() {
 // ===============================================
 
 void handleAutomaticFeeding() {
+  // During a sensor replay the bowl status comes from the recording
+  if (isSensorReplayActive()) {
+    replayAutomaticFeeding();
+    return;
+  }
+  
   // Debug: Check what's happening with auto-feeding
   static unsigned long lastAutoFeedDebug = 0;
   if (millis() - lastAutoFeedDebug > 15000) { // Debug every 15 seconds
-    Serial.printf("🔧 AUTO-FEED DEBUG: bowlEmpty=%s, enabled=%s, dailyCount=%d/%d\n",
-                  bowlEmpty ? "YES" : "NO",
-                  automaticFeedingEnabled ? "YES" : "NO", 
-                  dailyAutoFeedCount, MAX_DAILY_AUTO_FEEDS);
+    Serial.printf("🔧 AUTO-FEED DEBUG: bowlEmpty=%s (%.0fg), enabled=%s, dailyCount=%d/%d\n",
+                  bowlEmpty ? "YES" : "NO", getBowlGrams(),
+                  autoFeed.enabled ? "YES" : "NO", 
+                  autoFeed.dailyCount, MAX_DAILY_AUTO_FEEDS);
     Serial.printf("   Time since last check: %lu ms (interval: %d ms)\n", 
-                  millis() - lastAutoFeedCheck, AUTO_FEED_CHECK_INTERVAL);
+                  millis() - autoFeed.lastCheck, AUTO_FEED_CHECK_INTERVAL);
     Serial.printf("   Time since last feed: %lu ms (min interval: %d ms)\n",
-                  millis() - lastAutoFeedTime, AUTO_FEED_MIN_INTERVAL);
+                  millis() - autoFeed.lastFeedTime, AUTO_FEED_MIN_INTERVAL);
     lastAutoFeedDebug = millis();
   }
   
   // Reset daily feed count at midnight (24 hours since last reset)
-  if (millis() - dailyResetTime > 24UL * 60 * 60 * 1000) {
+  if (autoFeedDailyResetDue(autoFeed, millis())) {
     resetDailyFeedCount();
   }
   
-  // Only proceed if automatic feeding is enabled
-  if (!automaticFeedingEnabled) {
-    return;
-  }
+  // Limits, intervals and the empty bowl confirmation (auto_feed.h);
+  // never feed with an empty hopper, into a reported jam or into a bowl
+  // being calibrated
+  bool canFeed = sensorInitialized && !isFeedInProgress() && !isHopperEmpty() &&
+                 systemState != ERROR_STATE && !isBowlCalibrating();
+  uint8_t decision = autoFeedUpdate(autoFeed, bowlEmpty, canFeed, millis());
   
-  // Safety check: Don't exceed daily feed limit
-  if (dailyAutoFeedCount >= MAX_DAILY_AUTO_FEEDS) {
+  if (decision & AUTO_FEED_LIMIT_REACHED) {
     // Send alert if bowl is empty but max feeds reached (Phase 5)
     static unsigned long lastMaxFeedAlert = 0;
-    if (bowlEmpty && (millis() - lastMaxFeedAlert > 3600000)) { // Alert once per hour
-      String alertMsg = "Bowl empty but max daily feeds reached (" + String(MAX_DAILY_AUTO_FEEDS) + "/" + String(MAX_DAILY_AUTO_FEEDS) + ")";
-      sendSMSAlert(SMS_BOWL_EMPTY_ALERT, alertMsg.c_str());
+    if (millis() - lastMaxFeedAlert > 3600000) { // Alert once per hour
+      char alertMsg[96];
+      snprintf(alertMsg, sizeof(alertMsg), "Bowl empty (%.0fg left) but max daily feeds reached (%d/%d)",
+               getBowlGrams(), MAX_DAILY_AUTO_FEEDS, MAX_DAILY_AUTO_FEEDS);
+      sendSMSAlert(SMS_BOWL_EMPTY_ALERT, alertMsg);
       lastMaxFeedAlert = millis();
     }
     return;
   }
   
-  // Safety check: Minimum interval between automatic feeds (skip on first feed)
-  if (lastAutoFeedTime != 0 && millis() - lastAutoFeedTime < AUTO_FEED_MIN_INTERVAL) {
-    return;
+  if (decision & AUTO_FEED_CHECKED) {
+    Serial.println("🔧 AUTO-FEED: Performing check..."); // Debug message
   }
-  
-  // Check if it's time to evaluate feeding (every 5 seconds)
-  if (millis() - lastAutoFeedCheck < AUTO_FEED_CHECK_INTERVAL) {
-    return;
+  if (decision & AUTO_FEED_EMPTY_DETECTED) {
+    Serial.println("🍽️ BOWL DETECTED EMPTY - Starting confirmation timer...");
   }
-  lastAutoFeedCheck = millis();
-  
-  Serial.println("🔧 AUTO-FEED: Performing check..."); // Debug message
-  
-  // Handle bowl empty confirmation logic
-  if (bowlEmpty) {
-    if (bowlEmptyStartTime == 0) {
-      // Bowl just became empty, start confirmation timer
-      bowlEmptyStartTime = millis();
-      bowlEmptyConfirmed = false;
-      Serial.println("🍽️ BOWL DETECTED EMPTY - Starting confirmation timer...");
-    } else if (!bowlEmptyConfirmed && (millis() - bowlEmptyStartTime > BOWL_EMPTY_CONFIRMATION_TIME)) {
-      // Bowl has been empty long enough, confirm and prepare to feed
-      bowlEmptyConfirmed = true;
-      Serial.println("✅ BOWL EMPTY CONFIRMED - Ready for automatic feeding");
-      
-      // Play alert sound for automatic feeding
-      playBuzzer(200, 1800);
-      delay(100);
-      playBuzzer(200, 2200);
-      delay(100);
-      playBuzzer(200, 1800);
-    }
-  } else {
-    // Bowl is not empty, reset confirmation
-    bowlEmptyStartTime = 0;
-    bowlEmptyConfirmed = false;
+  if (decision & AUTO_FEED_EMPTY_CONFIRMED) {
+    Serial.println("✅ BOWL EMPTY CONFIRMED - Ready for automatic feeding");
+    
+    // Play alert sound for automatic feeding
+    playBuzzer(200, 1800);
+    delay(100);
+    playBuzzer(200, 2200);
+    delay(100);
+    playBuzzer(200, 1800);
   }
   
-  // Perform automatic feed if conditions are met (simplified - no hopper check)
-  if (bowlEmptyConfirmed && sensorInitialized) {
+  if (decision & AUTO_FEED_DISPENSE) {
     performAutomaticFeed();
   }
 }
 
+// Dry run of the automatic feeding decision on the replayed bowl status,
+// one step per replayed record on its recorded timestamp. Logs the feeds
+// the recording would have triggered; nothing is dispensed or sent.
+void replayAutomaticFeeding() {
+  const SensorReplayStats& replay = getSensorReplayStats();
+  if (replay.records == 0) {
+    return;
+  }
+  unsigned long recordedMs = replay.lastTimeMs;
+  
+  if (autoFeedDailyResetDue(replayAutoFeed, recordedMs)) {
+    autoFeedDailyReset(replayAutoFeed, recordedMs);
+  }
+  if (autoFeedUpdate(replayAutoFeed, bowlEmpty, true, recordedMs) & AUTO_FEED_DISPENSE) {
+    autoFeedDispensed(replayAutoFeed, recordedMs);
+    Serial.printf("▶️ Replay: automatic feed at %lu ms (%d/%d daily feeds)\n",
+                  recordedMs, replayAutoFeed.dailyCount, MAX_DAILY_AUTO_FEEDS);
+  }
+}
+
 void performAutomaticFeed() {
+  int portionSteps = getPortionSteps();
+  float bowlGrams = getBowlGrams();
+  
   Serial.println("\n🤖 AUTOMATIC FEEDING INITIATED");
-  Serial.printf("Mode: %s | Portion: %s\n", 
+  Serial.printf("Mode: %s | Portion: ~%.0fg | Bowl: %.0fg\n", 
     currentMode == CAT_MODE ? "CAT" : "DOG",
-    currentMode == CAT_MODE ? "20g" : "50g");
+    stepsToGrams(portionSteps), bowlGrams);
   
   systemState = DISPENSING;
   
@@ -422,35 +551,47 @@ void performAutomaticFeed() {
   playBuzzer(200, 2000);  // Medium pitch, longer
   
   // Dispense appropriate portion using motor module
-  manualFeed();
+  if (!automaticFeed()) {
+    // Refused (hopper too low): no feed to count or report. The bowl stays
+    // confirmed empty; hold the retry so the feed sequence is not replayed
+    // on every check.
+    systemState = isHopperEmpty() ? ALERT_EMPTY_HOPPER : IDLE;
+    autoFeedRefused(autoFeed, millis());
+    Serial.printf("✗ AUTOMATIC FEEDING REFUSED - retry in %lu min\n", AUTO_FEED_RETRY_INTERVAL / 60000);
+    return;
+  }
   
   // Update automatic feeding tracking
-  lastAutoFeedTime = millis();
-  dailyAutoFeedCount++;
-  bowlEmptyConfirmed = false;
-  bowlEmptyStartTime = 0;
+  autoFeedDispensed(autoFeed, millis());
   
   // Prepare SMS alert message (Phase 5)
-  String feedInfo = (currentMode == CAT_MODE) ? "CAT (20g)" : "DOG (50g)";
-  String statusInfo = feedInfo + " - Daily feeds: " + String(dailyAutoFeedCount) + "/8";
+  char statusInfo[96];
+  snprintf(statusInfo, sizeof(statusInfo), "%s (~%.0fg, bowl had %.0fg) - Daily feeds: %d/%d",
+           (currentMode == CAT_MODE) ? "CAT" : "DOG", stepsToGrams(portionSteps), bowlGrams,
+           autoFeed.dailyCount, MAX_DAILY_AUTO_FEEDS);
   
   // Send SMS alert for automatic feed (Phase 5)
-  sendSMSAlert(SMS_AUTO_FEED, statusInfo.c_str());
-  
-  systemState = IDLE;
+  sendSMSAlert(SMS_AUTO_FEED, statusInfo);
   
-  Serial.printf("✅ AUTOMATIC FEEDING COMPLETE (%d/%d daily feeds used)\n", 
-    dailyAutoFeedCount, MAX_DAILY_AUTO_FEEDS);
+  // The motor module returns the system to IDLE when the portion is out
+  Serial.printf("✅ AUTOMATIC FEEDING STARTED (%d/%d daily feeds used)\n", 
+    autoFeed.dailyCount, MAX_DAILY_AUTO_FEEDS);
   
   // Play completion sound
   playBuzzer(300, 2200);
 }
 
 void resetDailyFeedCount() {
-  dailyAutoFeedCount = 0;
-  dailyResetTime = millis();
+  autoFeedDailyReset(autoFeed, millis());
   Serial.println("🕛 Daily feed count reset - New feeding cycle started");
   
   // Send SMS alert for daily reset (Phase 5)
   sendSMSAlert(SMS_DAILY_RESET);
+  
+  // Close the day's dispensed total used for the refill prediction
+  rollInventoryDay();
+  
+  // Close the eating totals and report the day that just ended
+  rollEatingDay();
+  sendEatingSummarySMS();
 }
@@ -0,0 +1,446 @@
+// motion.cpp
+// Motion subsystem for Smart Pet Feeder
+// FreeRTOS task that owns the stepper driver and executes queued move commands
+
+#include <Arduino.h>
+#include "config.h"
+#include "motion.h"
+#include "motor.h"
+
+// Task and queues
+static TaskHandle_t motionTaskHandle = nullptr;
+static QueueHandle_t commandQueue = nullptr;
+static QueueHandle_t eventQueue = nullptr;
+
+// Motion state (written by the motion task, read from loop())
+static volatile bool commandExecuting = false;
+static volatile bool stopPending = false;
+static volatile bool engineReady = false;
+static volatile long motorPosition = 0;     // Fine microsteps (see MICROSTEPS_PER_STEP)
+static volatile uint32_t eventsDropped = 0; // Event queue full (the task does not print)
+static uint32_t nextCommandId = 1;
+
+// Ramp table for non-default speed/acceleration requests (filled by the task)
+const int MAX_CUSTOM_RAMP_STEPS = 512;
+static uint32_t customRampTable[MAX_CUSTOM_RAMP_STEPS];
+static uint32_t estimateRampTable[MAX_CUSTOM_RAMP_STEPS]; // estimateMotionCommand() only
+
+// Motor duty tracking (rolling window of moving time)
+const unsigned long DUTY_BUCKET_MS = MOTOR_DUTY_WINDOW_MS / MOTOR_DUTY_BUCKETS;
+const int DUTY_BUCKETS = MOTOR_DUTY_BUCKETS;
+struct DutyBucket {
+  uint32_t epoch;          // millis() / DUTY_BUCKET_MS this bucket belongs to
+  unsigned long movingMs;  // Step engine time within the bucket
+};
+static DutyBucket dutyBuckets[DUTY_BUCKETS];
+static unsigned long totalMovingMs = 0;
+static portMUX_TYPE dutyLock = portMUX_INITIALIZER_UNLOCKED;
+
+// ========================================
+// PROFILE CONSTRUCTION
+// ========================================
+
+// Build a step profile into rampBuffer (MAX_CUSTOM_RAMP_STEPS entries);
+// the default speed uses the compile-time tables and leaves it untouched.
+static StepProfile fillStepProfile(MotionProfileType type, int maxSpeed, int acceleration,
+                                   uint32_t* rampBuffer) {
+  StepProfile profile;
+
+  maxSpeed = constrain(maxSpeed, (int)(1000000UL / MAX_STEP_DELAY), (int)(1000000UL / MIN_STEP_DELAY));
+
+  if (type == PROFILE_CONSTANT) {
+    profile.rampTable = nullptr;
+    profile.rampSteps = 0;
+    profile.cruiseDelay = 1000000UL / maxSpeed;
+    return profile;
+  }
+
+  if (maxSpeed == MOTOR_SPEED && acceleration == MOTOR_ACCELERATION) {
+    if (type == PROFILE_SCURVE) {
+      profile.rampTable = DefaultSCurve::table.data();
+      profile.rampSteps = DefaultSCurve::length;
+      profile.cruiseDelay = DefaultSCurve::cruiseDelay;
+    } else {
+      profile.rampTable = DefaultRamp::table.data();
+      profile.rampSteps = DefaultRamp::length;
+      profile.cruiseDelay = DefaultRamp::cruiseDelay;
+    }
+    return profile;
+  }
+
+  acceleration = max(acceleration, 1);
+
+  int rampSteps;
+  SCurvePhases phases = scurvePhases(maxSpeed, MOTOR_START_SPEED, acceleration, MOTOR_JERK);
+  if (type == PROFILE_SCURVE) {
+    rampSteps = scurveRampLength(phases);
+  } else {
+    rampSteps = trapezoidRampLength(maxSpeed, MOTOR_START_SPEED, acceleration);
+  }
+  // Runs on the motion task too, so a longer ramp is cut without a log line;
+  // the move just leaves the ramp early at the last tabulated interval
+  if (rampSteps > MAX_CUSTOM_RAMP_STEPS) {
+    rampSteps = MAX_CUSTOM_RAMP_STEPS;
+  }
+  if (type == PROFILE_SCURVE) {
+    fillSCurveRamp(rampBuffer, rampSteps, phases);
+  } else {
+    fillTrapezoidRamp(rampBuffer, rampSteps, MOTOR_START_SPEED, acceleration);
+  }
+
+  profile.rampTable = rampBuffer;
+  profile.rampSteps = rampSteps;
+  profile.cruiseDelay = max(1000000UL / maxSpeed, (unsigned long)rampBuffer[max(rampSteps - 1, 0)]);
+  return profile;
+}
+
+// Other speeds fill customRampTable, so only the motion task may ask for them.
+StepProfile buildStepProfile(MotionProfileType type, int maxSpeed, int acceleration) {
+  return fillStepProfile(type, maxSpeed, acceleration, customRampTable);
+}
+
+// ========================================
+// MOVE ESTIMATION
+// ========================================
+
+// Predict what the motion task will clock out for a command. Uses the same
+// profile tables and step engine math as executeCommand(), so the result is
+// the exact timer time of the move (motor enable and task switching excluded).
+// Non-default speeds use their own table, so this is safe from loop().
+MoveEstimate estimateMotionCommand(const MotionCommand& cmd) {
+  MoveEstimate estimate = {0, 0};
+  if (cmd.steps <= 0) return estimate;
+
+  StepMove move;
+  move.steps = cmd.steps;
+  move.clockwise = (cmd.type == MOTION_DISPENSE);
+  move.fineSteps = (cmd.type == MOTION_DISPENSE) ? MICROSTEP_FINISH_STEPS : 0;
+
+  switch (cmd.type) {
+    case MOTION_DISPENSE:
+    case MOTION_REVERSE:
+      move.profile = fillStepProfile(cmd.profile, cmd.maxSpeed, cmd.acceleration, estimateRampTable);
+      estimate.durationUs = stepEngineMoveDuration(move);
+      estimate.pulses = stepEngineMovePulses(move);
+      break;
+
+    case MOTION_AGITATE:
+      // Every stroke is the same constant-speed move in alternating directions
+      move.profile = fillStepProfile(PROFILE_CONSTANT, cmd.maxSpeed, cmd.acceleration, estimateRampTable);
+      estimate.durationUs = stepEngineMoveDuration(move) * cmd.cycles * 2;
+      estimate.pulses = stepEngineMovePulses(move) * cmd.cycles * 2;
+      break;
+
+    case MOTION_STOP:
+      break;
+  }
+  return estimate;
+}
+
+MoveEstimate estimateDispenseMove(int steps, int maxSpeed, int acceleration, MotionProfileType profile) {
+  MotionCommand cmd = {MOTION_DISPENSE, steps, 0, maxSpeed, acceleration, profile, 0};
+  return estimateMotionCommand(cmd);
+}
+
+// ========================================
+// MOTOR DUTY TRACKING
+// ========================================
+
+// Moving time is kept in fixed time buckets covering the last
+// MOTOR_DUTY_WINDOW_MS. A bucket is reused once its epoch has passed, so
+// no history is rescanned or shifted. Written by the motion task, read
+// from loop() on the other core, hence the spinlock.
+static void recordMovingTime(unsigned long start, unsigned long end) {
+  portENTER_CRITICAL(&dutyLock);
+  totalMovingMs += end - start;
+  while (start < end) {
+    uint32_t epoch = start / DUTY_BUCKET_MS;
+    unsigned long bucketEnd = (unsigned long)(epoch + 1) * DUTY_BUCKET_MS;
+    unsigned long sliceEnd = min(end, bucketEnd);
+    DutyBucket& bucket = dutyBuckets[epoch % DUTY_BUCKETS];
+    if (bucket.epoch != epoch) {
+      bucket.epoch = epoch;
+      bucket.movingMs = 0;
+    }
+    bucket.movingMs += sliceEnd - start;
+    start = sliceEnd;
+  }
+  portEXIT_CRITICAL(&dutyLock);
+}
+
+// Fraction of the window (or of the uptime, if shorter) the motor spent moving
+float getMotorDutyCycle() {
+  unsigned long now = millis();
+  uint32_t currentEpoch = now / DUTY_BUCKET_MS;
+  unsigned long movingMs = 0;
+
+  portENTER_CRITICAL(&dutyLock);
+  for (int i = 0; i < DUTY_BUCKETS; i++) {
+    if (dutyBuckets[i].epoch + DUTY_BUCKETS > currentEpoch && dutyBuckets[i].epoch <= currentEpoch) {
+      movingMs += dutyBuckets[i].movingMs;
+    }
+  }
+  portEXIT_CRITICAL(&dutyLock);
+
+  unsigned long windowMs = (DUTY_BUCKETS - 1) * DUTY_BUCKET_MS + now % DUTY_BUCKET_MS;
+  if (now < windowMs) windowMs = now;
+  if (windowMs == 0) return 0.0f;
+  return min(1.0f, (float)movingMs / windowMs);
+}
+
+unsigned long getMotorMovingTime() {
+  portENTER_CRITICAL(&dutyLock);
+  unsigned long total = totalMovingMs;
+  portEXIT_CRITICAL(&dutyLock);
+  return total;
+}
+
+// ========================================
+// MOTION TASK
+// ========================================
+
+// Step engine ISR callback: wake the motion task
+static void IRAM_ATTR onMoveComplete() {
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(motionTaskHandle, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+// Run one move on the step engine and wait for it; returns steps moved.
+// The last fineSteps steps are clocked in fine microstep mode.
+static int runMove(int steps, bool clockwise, int fineSteps, const StepProfile& profile, bool& ok) {
+  StepMove move;
+  move.steps = steps;
+  move.clockwise = clockwise;
+  move.fineSteps = fineSteps;
+  move.profile = profile;
+
+  // A stop that arrived before the move started: do not start it at all
+  if (stopPending) {
+    ok = true;
+    return 0;
+  }
+
+  if (!isMotorEnabled()) {
+    enableMotor();
+  }
+
+  ulTaskNotifyTake(pdTRUE, 0); // Clear any stale notification
+  unsigned long startTime = millis();
+  if (!stepEngineStart(move)) {
+    ok = false;
+    return 0;
+  }
+
+  // The ISR notifies on completion; the timeout is only a safety net
+  while (stepEngineBusy()) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(50));
+  }
+  recordMovingTime(startTime, millis());
+
+  long microsteps = stepEngineMicrostepsDone();
+  motorPosition += clockwise ? microsteps : -microsteps;
+  int moved = stepEngineStepsDone();
+  ok = true;
+  return moved;
+}
+
+static void postEvent(const MotionEvent& event) {
+  if (xQueueSend(eventQueue, &event, 0) != pdTRUE) {
+    eventsDropped++;
+  }
+}
+
+static void executeCommand(const MotionCommand& cmd) {
+  MotionEvent event;
+  event.type = MOTION_EVENT_COMPLETED;
+  event.command = cmd.type;
+  event.id = cmd.id;
+  event.stepsRequested = cmd.steps;
+  event.stepsMoved = 0;
+  event.driverFault = false;
+
+  unsigned long startTime = millis();
+  bool ok = true;
+
+  switch (cmd.type) {
+    case MOTION_DISPENSE: {
+      StepProfile profile = buildStepProfile(cmd.profile, cmd.maxSpeed, cmd.acceleration);
+      event.stepsMoved = runMove(cmd.steps, true, MICROSTEP_FINISH_STEPS, profile, ok);
+      break;
+    }
+
+    case MOTION_REVERSE: {
+      StepProfile profile = buildStepProfile(cmd.profile, cmd.maxSpeed, cmd.acceleration);
+      event.stepsMoved = -runMove(cmd.steps, false, 0, profile, ok);
+      break;
+    }
+
+    case MOTION_AGITATE: {
+      StepProfile profile = buildStepProfile(PROFILE_CONSTANT, cmd.maxSpeed, cmd.acceleration);
+      event.stepsRequested = cmd.steps * cmd.cycles * 2;
+      for (int i = 0; i < cmd.cycles && ok && !stopPending; i++) {
+        event.stepsMoved -= runMove(cmd.steps, false, 0, profile, ok);
+        if (!ok || stopPending) break;
+        event.stepsMoved += runMove(cmd.steps, true, 0, profile, ok);
+      }
+      break;
+    }
+
+    case MOTION_STOP:
+      stopPending = false;
+      stepEngineClearStop();
+      disableMotor();
+      break;
+  }
+
+#if MOTOR_FAULT_PIN >= 0
+  // DRV8825 nFAULT (active LOW): over-current or over-temperature, e.g. a stalled auger
+  event.driverFault = (digitalRead(MOTOR_FAULT_PIN) == LOW);
+#endif
+
+  if (!ok) {
+    event.type = MOTION_EVENT_FAILED;
+  } else if (cmd.type != MOTION_STOP && stopPending) {
+    event.type = MOTION_EVENT_STOPPED;
+  }
+  event.durationMs = millis() - startTime;
+  postEvent(event);
+}
+
+static void motionTask(void* parameter) {
+  // Attach the step timer here so its interrupt is serviced on this core
+  if (stepEngineBegin()) {
+    stepEngineOnComplete(&onMoveComplete);
+    engineReady = true;
+  }
+
+  MotionCommand cmd;
+  for (;;) {
+    // Peek first so the command still counts as queued until it is marked executing
+    if (xQueuePeek(commandQueue, &cmd, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+    commandExecuting = true;
+    // motionStop() may have reset the queue since the peek: run whatever
+    // is at the front now (its STOP), or nothing
+    if (xQueueReceive(commandQueue, &cmd, 0) != pdTRUE) {
+      commandExecuting = false;
+      continue;
+    }
+
+    executeCommand(cmd);
+
+    // Release the driver once there is nothing left to do
+    if (uxQueueMessagesWaiting(commandQueue) == 0 && isMotorEnabled()) {
+      disableMotor();
+    }
+    commandExecuting = false;
+  }
+}
+
+// ========================================
+// PUBLIC INTERFACE
+// ========================================
+
+bool initializeMotion() {
+  commandQueue = xQueueCreate(MOTION_QUEUE_LENGTH, sizeof(MotionCommand));
+  eventQueue = xQueueCreate(MOTION_QUEUE_LENGTH, sizeof(MotionEvent));
+  if (commandQueue == nullptr || eventQueue == nullptr) {
+    Serial.println("✗ ERROR: Motion queues could not be created");
+    return false;
+  }
+
+  BaseType_t created = xTaskCreatePinnedToCore(motionTask, "motion", MOTION_TASK_STACK, nullptr,
+                                               MOTION_TASK_PRIORITY, &motionTaskHandle,
+                                               MOTION_TASK_CORE);
+  if (created != pdPASS) {
+    Serial.println("✗ ERROR: Motion task could not be started");
+    return false;
+  }
+
+  // Wait briefly for the task to attach the step timer
+  unsigned long start = millis();
+  while (!engineReady && millis() - start < 500) {
+    delay(1);
+  }
+  if (!engineReady) {
+    Serial.println("✗ ERROR: Step engine timer unavailable");
+    return false;
+  }
+
+  Serial.printf("✓ Motion task running on core %d (priority %d)\n",
+                MOTION_TASK_CORE, MOTION_TASK_PRIORITY);
+  return true;
+}
+
+uint32_t queueMotionCommand(MotionCommand command) {
+  if (commandQueue == nullptr) {
+    return 0;
+  }
+
+  command.id = nextCommandId++;
+  if (nextCommandId == 0) nextCommandId = 1;
+
+  if (xQueueSend(commandQueue, &command, 0) != pdTRUE) {
+    Serial.println("Motion queue full - command rejected");
+    return 0;
+  }
+  return command.id;
+}
+
+uint32_t motionDispense(int steps, int maxSpeed, int acceleration, MotionProfileType profile) {
+  if (steps <= 0) return 0;
+  MotionCommand cmd = {MOTION_DISPENSE, steps, 0, maxSpeed, acceleration, profile, 0};
+  return queueMotionCommand(cmd);
+}
+
+uint32_t motionReverse(int steps, int maxSpeed) {
+  if (steps <= 0) return 0;
+  MotionCommand cmd = {MOTION_REVERSE, steps, 0, maxSpeed, MOTOR_ACCELERATION, PROFILE_CONSTANT, 0};
+  return queueMotionCommand(cmd);
+}
+
+uint32_t motionAgitate(int steps, int cycles) {
+  if (steps <= 0 || cycles <= 0) return 0;
+  MotionCommand cmd = {MOTION_AGITATE, steps, cycles, MOTOR_START_SPEED, MOTOR_ACCELERATION,
+                       PROFILE_CONSTANT, 0};
+  return queueMotionCommand(cmd);
+}
+
+// Abort the running move, drop everything queued and release the driver.
+// STOP goes to the front of the queue so the task handles it next.
+void motionStop() {
+  if (commandQueue == nullptr) return;
+
+  stopPending = true;
+  xQueueReset(commandQueue);
+  stepEngineStop();
+
+  MotionCommand cmd = {MOTION_STOP, 0, 0, 0, 0, PROFILE_CONSTANT, 0};
+  cmd.id = nextCommandId++;
+  xQueueSendToFront(commandQueue, &cmd, 0);
+}
+
+bool pollMotionEvent(MotionEvent& event) {
+  if (eventQueue == nullptr) return false;
+  return xQueueReceive(eventQueue, &event, 0) == pdTRUE;
+}
+
+bool isMotionBusy() {
+  if (commandQueue == nullptr) return false;
+  return commandExecuting || uxQueueMessagesWaiting(commandQueue) > 0;
+}
+
+int getMotionQueueDepth() {
+  if (commandQueue == nullptr) return 0;
+  return uxQueueMessagesWaiting(commandQueue);
+}
+
+long getMotorPosition() {
+  return motorPosition;
+}
+
+uint32_t getMotionEventsDropped() {
+  return eventsDropped;
+}
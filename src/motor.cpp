@@ -5,6 +5,13 @@
 #include <Arduino.h>
 #include "config.h"
 #include "motor.h"
+#include "motion.h"
+#include "fast_gpio.h"
+#include "sensor.h"
+#include "calibration.h"
+#include "bowl_model.h"
+#include "hopper.h"
+#include "gsm.h"
 
 // External global variables (defined in main.cpp)
 extern SystemState systemState;
@@ -13,16 +20,49 @@ extern FeedingMode currentMode;
 // External function declarations (defined in main.cpp)
 extern void playBuzzer(int duration, int frequency);
 
+// DRV8825 enable (active LOW); toggled by the motion task around every move
+typedef FastOutputPin<MOTOR_ENABLE_PIN> EnablePin;
+
 // Motor control variables
-bool motorEnabled = false;
-bool motorMoving = false;
-int currentPosition = 0;
+volatile bool motorEnabled = false;
 unsigned long lastMotorAction = 0;
 
+// Feeding command in flight (completion handled by updateMotor())
+bool feedInProgress = false;
+uint32_t feedCommandId = 0;        // Open-loop feed command, 0 = none
+SystemState stateAfterMove = IDLE; // State restored when the feed ends
+const char* completionMessage = nullptr;
+int completionToneFrequency = 0;   // 0 = no completion beep
+unsigned long feedStartTime = 0;
+unsigned long feedPredictedMs = 0; // Worst-case duration planned at feed start
+
 // Motor timing variables
 unsigned long stepDelay = 2500; // Microseconds between steps (400 Hz default)
-const unsigned long MIN_STEP_DELAY = 1000; // Max speed limit (1000 Hz)
-const unsigned long MAX_STEP_DELAY = 10000; // Min speed limit (100 Hz)
+
+// Closed-loop dispensing state
+struct ClosedLoopState {
+  bool active;
+  bool settling;          // Chunk done, waiting before the bowl reading
+  bool measuring;         // Settled, waiting for the requested bowl reading
+  uint32_t sensorCycle;   // Sensor cycle that answers the request
+  int maxSteps;           // Step budget for the whole portion
+  float targetDistance;   // Stop once the bowl reading is at or below this (cm)
+  float startDistance;    // Bowl reading before the first chunk (cm, -1 if unknown)
+  float lastDistance;     // Bowl reading after the previous chunk (cm, -1 if unknown)
+  int stalledSteps;       // Steps dispensed since the bowl level last rose
+  bool recovering;        // chunkId is an agitation command, not a chunk
+  int lastChunkSteps;     // Steps moved by the chunk that just finished
+  FeedingMode mode;       // Calibration model the measurement belongs to
+  uint32_t chunkId;       // Motion command of the chunk in flight
+  unsigned long settleStart;
+  unsigned long startTime;
+};
+ClosedLoopState closedLoop = {};
+DispenseReport lastReport = {};
+
+static bool queueNextChunk();
+static void endClosedLoop();
+static void finishFeed();
 
 // ========================================
 // MOTOR INITIALIZATION
@@ -35,20 +75,33 @@ void initializeMotor() {
   pinMode(MOTOR_STEP_PIN, OUTPUT);
   pinMode(MOTOR_DIR_PIN, OUTPUT);
   pinMode(MOTOR_ENABLE_PIN, OUTPUT);
+  pinMode(MOTOR_M0_PIN, OUTPUT);
+  pinMode(MOTOR_M1_PIN, OUTPUT);
+  pinMode(MOTOR_M2_PIN, OUTPUT);
+#if MOTOR_FAULT_PIN >= 0
+  pinMode(MOTOR_FAULT_PIN, INPUT_PULLUP); // nFAULT is open-drain
+#endif
   
   // Initialize pins to safe state
   digitalWrite(MOTOR_STEP_PIN, LOW);
   digitalWrite(MOTOR_DIR_PIN, LOW);
   digitalWrite(MOTOR_ENABLE_PIN, HIGH); // Disable motor (active LOW)
   
-  Serial.printf("✓ Motor pins configured (STEP:%d, DIR:%d, EN:%d)\n", 
-                MOTOR_STEP_PIN, MOTOR_DIR_PIN, MOTOR_ENABLE_PIN);
+  Serial.printf("✓ Motor pins configured (STEP:%d, DIR:%d, EN:%d, M0-M2:%d/%d/%d)\n", 
+                MOTOR_STEP_PIN, MOTOR_DIR_PIN, MOTOR_ENABLE_PIN,
+                MOTOR_M0_PIN, MOTOR_M1_PIN, MOTOR_M2_PIN);
   
   // Test motor enable/disable
   enableMotor();
   delay(100);
   disableMotor();
   
+  // Start the motion task; from here on it owns the driver
+  initializeMotion();
+  
+  // Load the steps-per-gram models from NVS
+  initializeCalibration();
+  
   Serial.println("✓ Motor initialization complete");
 }
 
@@ -56,23 +109,33 @@ void initializeMotor() {
 // BASIC MOTOR CONTROL
 // ========================================
 
+// Also called from the motion task, so no Serial output here
 void enableMotor() {
-  digitalWrite(MOTOR_ENABLE_PIN, LOW); // Active LOW
+  EnablePin::clear(); // Active LOW
   motorEnabled = true;
-  Serial.println("Motor enabled");
   delay(2); // Allow motor to energize
 }
 
 void disableMotor() {
-  digitalWrite(MOTOR_ENABLE_PIN, HIGH); // Disable
+  EnablePin::set(); // Disable
   motorEnabled = false;
-  motorMoving = false;
-  Serial.println("Motor disabled");
 }
 
 void emergencyStop() {
+  // Queue producer: the motion task aborts the move and releases the driver.
+  // The enable pin is also dropped here so the motor stops immediately.
+  motionStop();
   disableMotor();
-  motorMoving = false;
+  
+  if (feedInProgress) {
+    systemState = stateAfterMove;
+    feedInProgress = false;
+    feedCommandId = 0;
+    closedLoop.active = false;
+    completionMessage = nullptr;
+    completionToneFrequency = 0;
+    lastReport.aborted = true;
+  }
   Serial.println("🚨 EMERGENCY STOP - Motor disabled");
   
   // Play warning sound
@@ -86,35 +149,22 @@ void emergencyStop() {
 // STEPPING FUNCTIONS
 // ========================================
 
-void stepMotor(int steps, bool clockwise = true) {
-  if (!motorEnabled) {
-    Serial.println("Motor not enabled - cannot step");
-    return;
+// Block until the motion task is idle (calibration and test helpers only)
+void waitForMotorIdle() {
+  while (isMotorMoving()) {
+    updateMotor();
+    delay(1);
   }
+}
+
+void stepMotor(int steps, bool clockwise = true) {
+  int speed = 1000000UL / stepDelay;
+  MotionCommand cmd = {clockwise ? MOTION_DISPENSE : MOTION_REVERSE, abs(steps), 0,
+                       speed, MOTOR_ACCELERATION, PROFILE_CONSTANT, 0};
   
-  motorMoving = true;
-  
-  // Set direction
-  digitalWrite(MOTOR_DIR_PIN, clockwise ? HIGH : LOW);
-  delayMicroseconds(5); // Direction setup time
-  
-  // Execute steps
-  for (int i = 0; i < abs(steps); i++) {
-    digitalWrite(MOTOR_STEP_PIN, HIGH);
-    delayMicroseconds(5); // Pulse width
-    digitalWrite(MOTOR_STEP_PIN, LOW);
-    delayMicroseconds(stepDelay);
-    
-    // Update position tracking
-    currentPosition += clockwise ? 1 : -1;
-    
-    // Yield to system occasionally for long moves
-    if (i % 50 == 0) {
-      yield();
-    }
+  if (queueMotionCommand(cmd) != 0) {
+    waitForMotorIdle();
   }
-  
-  motorMoving = false;
 }
 
 void dispensePortion(int steps) {
@@ -125,10 +175,7 @@ void dispensePortion(int steps) {
   
   Serial.printf("Dispensing %d steps...\n", steps);
   
-  enableMotor();
   stepMotor(steps, true); // Clockwise to dispense
-  delay(100); // Allow movement to complete
-  disableMotor();
   
   Serial.printf("✓ Portion dispensed (%d steps)\n", steps);
   lastMotorAction = millis();
@@ -138,90 +185,457 @@ void dispensePortion(int steps) {
 // SMOOTH MOTOR CONTROL WITH ACCELERATION
 // ========================================
 
-void dispensePortionSmooth(int steps, int maxSpeed, int acceleration) {
-  if (steps <= 0) return;
+// Queues the move and returns its command id (0 if rejected)
+uint32_t dispensePortionSmooth(int steps, int maxSpeed, int acceleration, MotionProfileType profileType) {
+  if (steps <= 0) return 0;
   
-  Serial.printf("Smooth dispensing %d steps (speed:%d, accel:%d)...\n", 
-                steps, maxSpeed, acceleration);
+  Serial.printf("Smooth dispensing %d steps (speed:%d, accel:%d, %s)...\n", 
+                steps, maxSpeed, acceleration,
+                profileType == PROFILE_SCURVE ? "S-curve" : "trapezoid");
   
-  enableMotor();
-  motorMoving = true;
+  return motionDispense(steps, maxSpeed, acceleration, profileType);
+}
+
+// ========================================
+// CLOSED-LOOP DISPENSING
+// ========================================
+
+// Deliver the portion in chunks and check the bowl sensor after each one;
+// stop as soon as the food level reaches the target distance. maxSteps is
+// the step budget (normally the nominal portion), so a closed-loop feed
+// never dispenses more than the open-loop one would have.
+bool dispensePortionClosedLoop(int maxSteps, float targetDistance) {
+  if (maxSteps <= 0 || closedLoop.active) return false;
+  
+  closedLoop.active = true;
+  closedLoop.settling = false;
+  closedLoop.measuring = false;
+  closedLoop.maxSteps = maxSteps;
+  closedLoop.targetDistance = targetDistance;
+  // Unfiltered, like the per-chunk readings it is compared with
+  closedLoop.startDistance = isSensorInitialized() ? getRawDistance() : -1.0f;
+  closedLoop.lastDistance = closedLoop.startDistance;
+  closedLoop.stalledSteps = 0;
+  closedLoop.recovering = false;
+  closedLoop.mode = currentMode;
+  closedLoop.startTime = millis();
+  
+  lastReport.stepsRequested = maxSteps;
+  lastReport.stepsUsed = 0;
+  lastReport.chunks = 0;
+  lastReport.closedLoop = true;
+  lastReport.targetReached = false;
+  lastReport.finalDistance = -1.0f;
+  lastReport.durationMs = 0;
+  lastReport.recoveries = 0;
+  lastReport.jammed = false;
+  lastReport.driverFault = false;
+  lastReport.hopperEmpty = false;
+  lastReport.aborted = false;
+  
+  Serial.printf("Closed-loop dispensing up to %d steps (target %.1f cm, chunk %d)\n",
+                maxSteps, targetDistance, CLOSED_LOOP_CHUNK_STEPS);
+  
+  if (!queueNextChunk()) {
+    closedLoop.active = false;
+    return false;
+  }
+  return true;
+}
+
+static bool queueNextChunk() {
+  int remaining = closedLoop.maxSteps - lastReport.stepsUsed;
+  int chunk = min(remaining, CLOSED_LOOP_CHUNK_STEPS);
   
-  digitalWrite(MOTOR_DIR_PIN, HIGH); // Clockwise
-  delayMicroseconds(5);
+  if (!hopperCanDispense(stepsToGrams(chunk))) {
+    lastReport.hopperEmpty = true;
+    return false;
+  }
   
-  // Calculate acceleration profile
-  int accelSteps = min(steps / 4, acceleration); // 1/4 of move for accel
-  int cruiseSteps = steps - (2 * accelSteps);
-  int decelSteps = accelSteps;
+  closedLoop.chunkId = motionDispense(chunk, MOTOR_SPEED, MOTOR_ACCELERATION, DISPENSE_PROFILE);
+  if (closedLoop.chunkId == 0) {
+    return false;
+  }
+  lastReport.chunks++;
+  return true;
+}
+
+// Track whether the last chunk raised the bowl level. Returns true once
+// JAM_DETECT_STEPS have been dispensed without any measurable change.
+static bool detectStall(float distance, int chunkSteps) {
+  if (distance <= 0) {
+    return false; // No valid reading, no verdict
+  }
   
-  unsigned long currentDelay = MAX_STEP_DELAY; // Start slow
-  unsigned long targetDelay = 1000000UL / maxSpeed; // Convert Hz to microseconds
-  unsigned long delayStep = (currentDelay - targetDelay) / accelSteps;
+  if (closedLoop.lastDistance > 0 &&
+      closedLoop.lastDistance - distance < JAM_MIN_LEVEL_CHANGE_CM) {
+    closedLoop.stalledSteps += chunkSteps;
+  } else {
+    closedLoop.stalledSteps = 0;
+  }
+  closedLoop.lastDistance = distance;
   
-  int stepCount = 0;
+  return closedLoop.stalledSteps >= JAM_DETECT_STEPS;
+}
+
+// Reverse/forward agitation to clear the auger. The steps that produced
+// no food are given back to the budget so the portion is still delivered.
+static bool startJamRecovery() {
+  if (lastReport.recoveries >= JAM_MAX_RECOVERIES) {
+    return false;
+  }
   
-  // Acceleration phase
-  for (int i = 0; i < accelSteps; i++) {
-    digitalWrite(MOTOR_STEP_PIN, HIGH);
-    delayMicroseconds(5);
-    digitalWrite(MOTOR_STEP_PIN, LOW);
-    delayMicroseconds(currentDelay);
-    
-    currentDelay -= delayStep;
-    stepCount++;
-    if (stepCount % 20 == 0) yield();
+  lastReport.recoveries++;
+  closedLoop.maxSteps += closedLoop.stalledSteps;
+  closedLoop.stalledSteps = 0;
+  
+  Serial.printf("⚠️ No food reaching bowl - agitating auger (attempt %d/%d)\n",
+                lastReport.recoveries, JAM_MAX_RECOVERIES);
+  
+  closedLoop.chunkId = motionAgitate(JAM_AGITATE_STEPS, JAM_AGITATE_CYCLES);
+  if (closedLoop.chunkId == 0) {
+    return false;
   }
+  closedLoop.recovering = true;
+  return true;
+}
+
+// Measure after the settle time and decide whether another chunk is needed.
+// The reading comes from the sensor state machine, so loop() never waits
+// for the conversion.
+static void updateClosedLoop() {
+  if (!closedLoop.active) return;
+  
+  if (closedLoop.settling) {
+    if (millis() - closedLoop.settleStart < CLOSED_LOOP_SETTLE_TIME) return;
+    closedLoop.settling = false;
+    closedLoop.measuring = true;
+    closedLoop.sensorCycle = requestSensorReading();
+    return;
+  }
+  
+  if (!closedLoop.measuring) return;
+  if (isSensorInitialized() && (int32_t)(getSensorCycleCount() - closedLoop.sensorCycle) < 0) return;
+  closedLoop.measuring = false;
   
-  // Cruise phase
-  for (int i = 0; i < cruiseSteps; i++) {
-    digitalWrite(MOTOR_STEP_PIN, HIGH);
-    delayMicroseconds(5);
-    digitalWrite(MOTOR_STEP_PIN, LOW);
-    delayMicroseconds(targetDelay);
+  float distance = isSensorInitialized() ? getLastCycleDistance() : -1.0f;
+  if (distance > 0) {
+    lastReport.finalDistance = distance;
+  }
+  
+  if (distance > 0 && distance <= closedLoop.targetDistance) {
+    lastReport.targetReached = true;
+  } else if (detectStall(distance, closedLoop.lastChunkSteps)) {
+    if (startJamRecovery()) {
+      return; // Resume chunks once the agitation is done
+    }
+    lastReport.jammed = true;
+  } else if (lastReport.stepsUsed < closedLoop.maxSteps && queueNextChunk()) {
+    return; // Keep dispensing
+  }
+  
+  endClosedLoop();
+}
+
+static void endClosedLoop() {
+  closedLoop.active = false;
+  lastReport.durationMs = millis() - closedLoop.startTime;
+  Serial.printf("Closed-loop result: %d/%d steps in %d chunks, bowl %.1f cm (%s)\n",
+                lastReport.stepsUsed, lastReport.stepsRequested, lastReport.chunks,
+                lastReport.finalDistance,
+                lastReport.jammed ? "JAMMED" :
+                lastReport.aborted ? "aborted" :
+                lastReport.targetReached ? "target reached" :
+                lastReport.hopperEmpty ? "hopper empty" : "step budget used");
+  
+  // Feed the measured bowl level change into the steps-per-gram model
+  // (skipped after a jam or an abort: the steps do not match the food)
+  if (!lastReport.jammed && !lastReport.aborted && lastReport.recoveries == 0 &&
+      closedLoop.startDistance > 0 && lastReport.finalDistance > 0) {
+    float deltaCm = closedLoop.startDistance - lastReport.finalDistance;
+    if (deltaCm >= CALIBRATION_MIN_DELTA_CM) {
+      float grams = bowlGramsAt(lastReport.finalDistance) - bowlGramsAt(closedLoop.startDistance);
+      updateCalibration(closedLoop.mode, lastReport.stepsUsed, grams);
+    }
+  }
+  
+  finishFeed();
+}
+
+// ========================================
+// MOTION EVENT HANDLING
+// ========================================
+
+// Called from loop(): consumes motion task completion events
+void updateMotor() {
+  MotionEvent event;
+  
+  while (pollMotionEvent(event)) {
+    if (event.type == MOTION_EVENT_FAILED) {
+      Serial.printf("✗ Motion command %lu failed\n", (unsigned long)event.id);
+    } else if (event.type == MOTION_EVENT_STOPPED) {
+      Serial.printf("Motion command %lu stopped after %d steps\n",
+                    (unsigned long)event.id, event.stepsMoved);
+    }
+    
+    // Closed-loop chunk finished: let the food settle, then measure
+    if (closedLoop.active && event.id == closedLoop.chunkId) {
+      closedLoop.chunkId = 0;
+      
+      if (event.driverFault) {
+        Serial.println("⚠️ Motor driver reported a fault");
+        lastReport.driverFault = true;
+      }
+      
+      if (closedLoop.recovering) {
+        // Agitation done: carry on with the portion
+        closedLoop.recovering = false;
+        if (event.type == MOTION_EVENT_STOPPED) {
+          lastReport.aborted = true;
+        } else if (event.type == MOTION_EVENT_COMPLETED && !event.driverFault && queueNextChunk()) {
+          continue;
+        } else {
+          lastReport.jammed = !lastReport.hopperEmpty;
+        }
+        endClosedLoop();
+        continue;
+      }
+      
+      lastReport.stepsUsed += event.stepsMoved;
+      closedLoop.lastChunkSteps = event.stepsMoved;
+      
+      if (event.driverFault) {
+        // Driver stall/fault feedback: go straight to recovery
+        closedLoop.stalledSteps += event.stepsMoved;
+        if (!startJamRecovery()) {
+          lastReport.jammed = true;
+          endClosedLoop();
+        }
+      } else if (event.type == MOTION_EVENT_COMPLETED) {
+        closedLoop.settling = true;
+        closedLoop.settleStart = millis();
+      } else {
+        // Stopped or rejected chunk: the portion was not delivered,
+        // handled like an open-loop move that ends the same way
+        lastReport.aborted = (event.type == MOTION_EVENT_STOPPED);
+        lastReport.jammed = (event.type == MOTION_EVENT_FAILED);
+        endClosedLoop();
+      }
+      continue;
+    }
     
-    stepCount++;
-    if (stepCount % 20 == 0) yield();
+    if (event.id != feedCommandId) {
+      continue;
+    }
+    
+    feedCommandId = 0;
+    lastReport.stepsRequested = event.stepsRequested;
+    lastReport.stepsUsed = event.stepsMoved;
+    lastReport.chunks = 1;
+    lastReport.closedLoop = false;
+    lastReport.targetReached = false;
+    lastReport.finalDistance = -1.0f;
+    lastReport.durationMs = event.durationMs;
+    lastReport.recoveries = 0;
+    lastReport.jammed = event.driverFault || event.type == MOTION_EVENT_FAILED;
+    lastReport.driverFault = event.driverFault;
+    lastReport.hopperEmpty = false;
+    lastReport.aborted = (event.type == MOTION_EVENT_STOPPED);
+    finishFeed();
   }
   
-  // Deceleration phase
-  for (int i = 0; i < decelSteps; i++) {
-    digitalWrite(MOTOR_STEP_PIN, HIGH);
-    delayMicroseconds(5);
-    digitalWrite(MOTOR_STEP_PIN, LOW);
-    delayMicroseconds(currentDelay);
+  updateClosedLoop();
+}
+
+// Common end of a feed (open- or closed-loop)
+static void finishFeed() {
+  lastMotorAction = millis();
+  feedInProgress = false;
+  
+  if (lastReport.jammed) {
+    // Report it instead of pretending the pet was fed. The state stays
+    // ERROR_STATE until clearFeedingError() or a successful manual feed.
+    systemState = ERROR_STATE;
+    completionMessage = nullptr;
+    completionToneFrequency = 0;
     
-    currentDelay += delayStep;
-    stepCount++;
-    if (stepCount % 20 == 0) yield();
+    // Word the alert by what actually stopped the feed
+    char info[96];
+    if (lastReport.driverFault) {
+      snprintf(info, sizeof(info),
+               "Motor driver fault after %d steps. Check motor wiring/auger.",
+               lastReport.stepsUsed);
+    } else if (lastReport.recoveries > 0) {
+      snprintf(info, sizeof(info),
+               "No food reached the bowl after %d unjam attempts. Check auger/hopper.",
+               lastReport.recoveries);
+    } else if (lastReport.closedLoop && lastReport.stepsUsed > 0) {
+      snprintf(info, sizeof(info),
+               "No food reached the bowl after %d steps. Check auger/hopper.",
+               lastReport.stepsUsed);
+    } else {
+      snprintf(info, sizeof(info), "Motor command rejected. Check the motor.");
+    }
+    Serial.printf("✗ Feeding FAILED: %s\n", info);
+    sendSMSAlert(SMS_FEEDING_ERROR, info);
+    
+    for (int i = 0; i < 3; i++) {
+      playBuzzer(300, 800);
+      delay(100);
+    }
+    return;
   }
   
-  currentPosition += steps;
-  motorMoving = false;
-  disableMotor();
+  systemState = stateAfterMove;
+  if (systemState == IDLE && isHopperEmpty()) {
+    systemState = ALERT_EMPTY_HOPPER;
+  }
   
-  Serial.printf("✓ Smooth portion complete (%d steps)\n", steps);
-  lastMotorAction = millis();
+  if (lastReport.hopperEmpty || lastReport.aborted) {
+    // Part of the portion at most: no "feeding complete" report
+    Serial.printf("⚠️ Feed stopped: %s (%d/%d steps)\n",
+                  lastReport.aborted ? "move aborted" : "hopper empty",
+                  lastReport.stepsUsed, lastReport.stepsRequested);
+    completionMessage = nullptr;
+    completionToneFrequency = 0;
+    return;
+  }
+  
+  Serial.printf("✓ Smooth portion complete (%d steps, %lu ms)\n",
+                lastReport.stepsUsed, lastReport.durationMs);
+  
+  // Play completion sound
+  if (completionToneFrequency > 0) {
+    playBuzzer(150, completionToneFrequency);
+    completionToneFrequency = 0;
+  }
+  
+  if (completionMessage != nullptr) {
+    Serial.println(completionMessage);
+    completionMessage = nullptr;
+  }
+}
+
+// Leave ERROR_STATE once someone has looked at the auger. The next feed
+// shows whether the jam is really gone.
+bool clearFeedingError() {
+  if (systemState != ERROR_STATE || feedInProgress) {
+    return false;
+  }
+  systemState = isHopperEmpty() ? ALERT_EMPTY_HOPPER : IDLE;
+  lastReport.jammed = false;
+  Serial.println("✓ Feeding error cleared");
+  return true;
+}
+
+// Start a feed in closed-loop mode when the bowl sensor is available
+static bool startFeed(int portionSteps) {
+  if (isHopperEmpty()) {
+    Serial.println("🪣 Hopper empty - feed refused");
+    return false;
+  }
+  if (isBowlCalibrating()) {
+    Serial.println("Bowl calibration running - feed refused");
+    return false;
+  }
+  
+  DispenseEstimate estimate = estimateFeed(portionSteps, MOTOR_SPEED, MOTOR_ACCELERATION, DISPENSE_PROFILE);
+  Serial.printf("Feed plan: %d steps, %d move(s), %lu pulses, motor %.1f s, up to %.1f s total\n",
+                estimate.steps, estimate.chunks, (unsigned long)estimate.pulses,
+                estimate.motorMs / 1000.0, estimate.totalMs / 1000.0);
+  if (estimate.totalMs > FEEDING_TIMEOUT) {
+    Serial.printf("⚠️ Feed may take longer than FEEDING_TIMEOUT (%d ms)\n", FEEDING_TIMEOUT);
+  }
+  feedStartTime = millis();
+  feedPredictedMs = estimate.totalMs;
+  
+  if (estimate.closedLoop) {
+    return dispensePortionClosedLoop(portionSteps, CLOSED_LOOP_TARGET_DISTANCE);
+  }
+  
+  if (!hopperCanDispense(stepsToGrams(portionSteps))) {
+    return false;
+  }
+  feedCommandId = dispensePortionSmooth(portionSteps, MOTOR_SPEED, MOTOR_ACCELERATION, DISPENSE_PROFILE);
+  return feedCommandId != 0;
+}
+
+// Plan a feed the way startFeed() will run it. Closed-loop feeds are
+// estimated for the full step budget (the target may stop them earlier);
+// jam recovery is not included.
+DispenseEstimate estimateFeed(int portionSteps, int maxSpeed, int acceleration, MotionProfileType profile) {
+  DispenseEstimate estimate = {};
+  estimate.steps = max(portionSteps, 0);
+  estimate.closedLoop = CLOSED_LOOP_DISPENSE && isSensorInitialized();
+  
+  uint64_t motorUs = 0;
+  if (estimate.closedLoop) {
+    int fullChunks = estimate.steps / CLOSED_LOOP_CHUNK_STEPS;
+    int lastChunk = estimate.steps % CLOSED_LOOP_CHUNK_STEPS;
+    if (fullChunks > 0) {
+      MoveEstimate chunk = estimateDispenseMove(CLOSED_LOOP_CHUNK_STEPS, maxSpeed, acceleration, profile);
+      motorUs += chunk.durationUs * fullChunks;
+      estimate.pulses += chunk.pulses * fullChunks;
+    }
+    if (lastChunk > 0) {
+      MoveEstimate chunk = estimateDispenseMove(lastChunk, maxSpeed, acceleration, profile);
+      motorUs += chunk.durationUs;
+      estimate.pulses += chunk.pulses;
+    }
+    estimate.chunks = fullChunks + (lastChunk > 0 ? 1 : 0);
+  } else if (estimate.steps > 0) {
+    MoveEstimate move = estimateDispenseMove(estimate.steps, maxSpeed, acceleration, profile);
+    motorUs = move.durationUs;
+    estimate.pulses = move.pulses;
+    estimate.chunks = 1;
+  }
+  
+  estimate.motorMs = (unsigned long)((motorUs + 999) / 1000);
+  estimate.totalMs = estimate.motorMs;
+  if (estimate.closedLoop) {
+    // Settle time plus one sensor conversion after every chunk
+    estimate.totalMs += (unsigned long)estimate.chunks * (CLOSED_LOOP_SETTLE_TIME + SENSOR_CONVERSION_TIME);
+  }
+  return estimate;
+}
+
+unsigned long getFeedTimeRemaining() {
+  if (!feedInProgress) return 0;
+  unsigned long elapsed = millis() - feedStartTime;
+  return (elapsed < feedPredictedMs) ? feedPredictedMs - elapsed : 0;
+}
+
+bool isFeedInProgress() {
+  return feedInProgress;
+}
+
+const DispenseReport& getLastDispenseReport() {
+  return lastReport;
 }
 
 // ========================================
 // FEEDING FUNCTIONS
 // ========================================
 
-void manualFeed() {
+// Manual and automatic feeds both dispense the minimum portion for the
+// mode (closed-loop feeds may stop earlier at the bowl target). Every
+// caller that plans or reports a portion asks here.
+int getPortionSteps() {
+  return (currentMode == CAT_MODE) ? CAT_MIN_PORTION : DOG_MIN_PORTION;
+}
+
+// Returns true if the portion was started
+bool manualFeed() {
   Serial.println("🍽️ Manual feeding triggered");
   
-  int portionSteps;
-  const char* modeName;
-  
-  if (currentMode == CAT_MODE) {
-    portionSteps = CAT_MIN_PORTION; // Start with minimum portion
-    modeName = "CAT";
-  } else {
-    portionSteps = DOG_MIN_PORTION;
-    modeName = "DOG";
+  if (isFeedInProgress()) {
+    Serial.println("Feeding already in progress - request ignored");
+    return false;
   }
   
+  int portionSteps = getPortionSteps();
+  const char* modeName = (currentMode == CAT_MODE) ? "CAT" : "DOG";
+  
   Serial.printf("Manual feed: %s mode (%d steps, ~%.1fg)\n", 
                 modeName, portionSteps, stepsToGrams(portionSteps));
   
@@ -230,28 +644,28 @@ void manualFeed() {
   delay(50);
   playBuzzer(100, 2200);
   
-  // Dispense portion with smooth acceleration
+  // Queue the portion for the motion task (runs in the background)
+  if (!startFeed(portionSteps)) {
+    return false;
+  }
+  feedInProgress = true;
   systemState = MANUAL_FEEDING;
-  dispensePortionSmooth(portionSteps, MOTOR_SPEED, MOTOR_ACCELERATION);
-  systemState = IDLE;
-  
-  // Play completion sound
-  playBuzzer(150, 2500);
-  
-  Serial.println("✓ Manual feeding complete");
+  stateAfterMove = IDLE;
+  completionToneFrequency = 2500;
+  completionMessage = "✓ Manual feeding complete";
+  return true;
 }
 
-void automaticFeed() {
+bool automaticFeed() {
   Serial.println("🤖 Automatic feeding triggered");
   
-  int portionSteps;
-  
-  if (currentMode == CAT_MODE) {
-    portionSteps = (CAT_MIN_PORTION + CAT_MAX_PORTION) / 2; // Medium portion
-  } else {
-    portionSteps = (DOG_MIN_PORTION + DOG_MAX_PORTION) / 2;
+  if (isFeedInProgress()) {
+    Serial.println("Feeding already in progress - request ignored");
+    return false;
   }
   
+  int portionSteps = getPortionSteps();
+  
   Serial.printf("Auto feed: %s mode (%d steps, ~%.1fg)\n", 
                 (currentMode == CAT_MODE) ? "CAT" : "DOG", 
                 portionSteps, stepsToGrams(portionSteps));
@@ -262,11 +676,15 @@ void automaticFeed() {
     delay(30);
   }
   
+  if (!startFeed(portionSteps)) {
+    return false;
+  }
+  feedInProgress = true;
   systemState = DISPENSING;
-  dispensePortionSmooth(portionSteps, MOTOR_SPEED, MOTOR_ACCELERATION);
-  systemState = IDLE;
-  
-  Serial.println("✓ Automatic feeding complete");
+  stateAfterMove = IDLE;
+  completionToneFrequency = 0;
+  completionMessage = "✓ Automatic feeding complete";
+  return true;
 }
 
 // ========================================
@@ -274,13 +692,13 @@ void automaticFeed() {
 // ========================================
 
 int gramsToSteps(float grams) {
-  // Calibration: approximately 17 steps per gram (to be refined)
-  return (int)(grams * 17.0f);
+  // Online estimate for the current mode (see calibration.cpp)
+  return (int)(grams * getStepsPerGram(currentMode));
 }
 
 float stepsToGrams(int steps) {
   // Inverse calibration
-  return (float)steps / 17.0f;
+  return (float)steps / getStepsPerGram(currentMode);
 }
 
 void calibrateMotor() {
@@ -303,7 +721,7 @@ void calibrateMotor() {
   }
   
   Serial.println("\n✓ Calibration test complete");
-  Serial.println("Update STEPS_PER_GRAM in config.h based on measurements");
+  Serial.println("Steps/gram is also refined automatically after each closed-loop feed");
 }
 
 // ========================================
@@ -315,14 +733,12 @@ bool isMotorEnabled() {
 }
 
 bool isMotorMoving() {
-  return motorMoving;
+  return isMotionBusy();
 }
 
 void testMotorMovement() {
   Serial.println("🧪 Testing motor movement...");
   
-  enableMotor();
-  
   // Test small movements in both directions
   Serial.println("Testing clockwise rotation...");
   stepMotor(200, true);
@@ -335,15 +751,137 @@ void testMotorMovement() {
   // Test smooth movement
   Serial.println("Testing smooth movement...");
   dispensePortionSmooth(100, 200, 50);
+  waitForMotorIdle();
   
-  disableMotor();
   Serial.println("✓ Motor test complete");
 }
 
+void printProfileBenchmark() {
+  Serial.println("📈 Dispense time: linear-delay (old) vs trapezoidal vs S-curve ramp");
+  
+  const int portions[] = {CAT_MIN_PORTION, CAT_MAX_PORTION, DOG_MIN_PORTION, DOG_MAX_PORTION};
+  const char* names[] = {"CAT min", "CAT max", "DOG min", "DOG max"};
+  
+  for (int i = 0; i < 4; i++) {
+    uint64_t oldUs = legacyMoveDuration(portions[i], MOTOR_SPEED, MOTOR_ACCELERATION, MAX_STEP_DELAY);
+    uint64_t newUs = rampMoveDuration(portions[i], DefaultRamp::table.data(),
+                                           DefaultRamp::length, DefaultRamp::cruiseDelay);
+    uint64_t sUs = rampMoveDuration(portions[i], DefaultSCurve::table.data(),
+                                         DefaultSCurve::length, DefaultSCurve::cruiseDelay);
+    Serial.printf("   %-8s %5d steps | old: %6.2f s | ramp: %6.2f s | S-curve: %6.2f s\n",
+                  names[i], portions[i], oldUs / 1e6, newUs / 1e6, sUs / 1e6);
+  }
+  Serial.printf("   Ramp table: %d steps, %lu -> %lu us\n", DefaultRamp::length,
+                (unsigned long)DefaultRamp::table[0], (unsigned long)DefaultRamp::cruiseDelay);
+}
+
+// Velocity/time curve of one move per profile type, as the step engine
+// would clock it. Output is CSV so it can be pasted into a plotting tool.
+void printProfileSimulation(int steps, int sampleEvery) {
+  const MotionProfileType types[] = {PROFILE_TRAPEZOID, PROFILE_SCURVE};
+  const char* names[] = {"trapezoid", "scurve"};
+  
+  if (steps <= 0 || sampleEvery <= 0) return;
+  
+  Serial.printf("📈 Profile simulation: %d steps\n", steps);
+  Serial.println("profile,step,time_s,speed_steps_per_s");
+  
+  uint64_t totals[2] = {0, 0};
+  for (int t = 0; t < 2; t++) {
+    StepMove move;
+    move.steps = steps;
+    move.clockwise = true;
+    move.fineSteps = 0;
+    move.profile = buildStepProfile(types[t], MOTOR_SPEED, MOTOR_ACCELERATION);
+    
+    uint64_t elapsed = 0;
+    for (int i = 0; i < steps; i++) {
+      uint32_t interval = stepEngineInterval(move, i);
+      if (i % sampleEvery == 0 || i == steps - 1) {
+        Serial.printf("%s,%d,%.4f,%.1f\n", names[t], i, elapsed / 1e6, 1e6 / interval);
+      }
+      elapsed += interval;
+    }
+    totals[t] = elapsed;
+  }
+  
+  Serial.printf("Total move time: trapezoid %.3f s | S-curve %.3f s\n",
+                totals[0] / 1e6, totals[1] / 1e6);
+}
+
+// Pulses and move time for the dispense portions when the whole move runs
+// in fine microsteps versus coarse cruise with a fine finish. Pure table
+// math (same as the step engine), so it also runs against the host build.
+void printMicrostepBenchmark() {
+  // Before the switch every move was full-step. The fine finish takes the
+  // same time to the rounding of the split intervals; what it buys is the
+  // final 1/MICROSTEP_FINE position, for far fewer pulses than running
+  // the whole move fine.
+  Serial.printf("📈 Microstep switching: full step (before) vs 1/%d cruise + last %d steps at 1/%d\n",
+                MICROSTEP_COARSE, MICROSTEP_FINISH_STEPS, MICROSTEP_FINE);
+  
+  const int portions[] = {CAT_MIN_PORTION, CAT_MAX_PORTION, DOG_MIN_PORTION, DOG_MAX_PORTION};
+  const char* names[] = {"CAT min", "CAT max", "DOG min", "DOG max"};
+  
+  for (int i = 0; i < 4; i++) {
+    StepMove move;
+    move.steps = portions[i];
+    move.clockwise = true;
+    move.profile = buildStepProfile(DISPENSE_PROFILE, MOTOR_SPEED, MOTOR_ACCELERATION);
+    
+    move.fineSteps = 0;
+    uint32_t fullPulses = stepEngineMovePulses(move);
+    uint64_t fullUs = stepEngineMoveDuration(move);
+    
+    move.fineSteps = move.steps;
+    uint32_t finePulses = stepEngineMovePulses(move);
+    
+    move.fineSteps = MICROSTEP_FINISH_STEPS;
+    uint32_t mixedPulses = stepEngineMovePulses(move);
+    uint64_t mixedUs = stepEngineMoveDuration(move);
+    
+    Serial.printf("   %-8s %5d steps | before: %5lu pulses %6.2f s | switched: %5lu pulses %6.2f s, "
+                  "stops on 1/%d (all 1/%d: %lu pulses)\n",
+                  names[i], portions[i],
+                  (unsigned long)fullPulses, fullUs / 1e6,
+                  (unsigned long)mixedPulses, mixedUs / 1e6, MICROSTEP_FINE,
+                  MICROSTEP_FINE, (unsigned long)finePulses);
+  }
+}
+
 void printMotorStatus() {
-  Serial.printf("MOTOR: %s | Moving: %s | Position: %d | Last: %lus ago\n",
+  long position = getMotorPosition();
+  Serial.printf("MOTOR: %s | Moving: %s | Position: %ld steps + %ld/%d | Last: %lus ago\n",
                 motorEnabled ? "ON" : "OFF",
-                motorMoving ? "YES" : "NO", 
-                currentPosition,
+                isMotorMoving() ? "YES" : "NO", 
+                position / MICROSTEPS_PER_STEP, labs(position % MICROSTEPS_PER_STEP),
+                MICROSTEPS_PER_STEP,
                 (millis() - lastMotorAction) / 1000);
+  if (isMotorMoving()) {
+    Serial.printf("   Move progress: %d/%d steps | Queued: %d\n",
+                  stepEngineStepsDone(), stepEngineStepsTotal(), getMotionQueueDepth());
+  }
+  if (feedInProgress) {
+    Serial.printf("   Feed: %.1f s of %.1f s planned remaining\n",
+                  getFeedTimeRemaining() / 1000.0, feedPredictedMs / 1000.0);
+  }
+  Serial.printf("   Duty: %.1f%% over %lu min | Moving total: %lu s\n",
+                getMotorDutyCycle() * 100.0f, MOTOR_DUTY_WINDOW_MS / 60000,
+                getMotorMovingTime() / 1000);
+  if (getMotionEventsDropped() > 0) {
+    Serial.printf("   Motion events dropped: %lu\n", (unsigned long)getMotionEventsDropped());
+  }
+  printCalibrationStatus();
+  if (lastReport.chunks > 0) {
+    Serial.printf("   Last feed: %d/%d steps, %d chunk(s), %s\n",
+                  lastReport.stepsUsed, lastReport.stepsRequested, lastReport.chunks,
+                  lastReport.jammed ? "JAMMED" :
+                  lastReport.aborted ? "aborted" :
+                  lastReport.hopperEmpty ? "stopped, hopper empty" :
+                  !lastReport.closedLoop ? "open-loop" :
+                  lastReport.targetReached ? "bowl target reached" : "step budget used");
+    if (lastReport.recoveries > 0) {
+      Serial.printf("   Jam recoveries on last feed: %d\n", lastReport.recoveries);
+    }
+  }
 }
\ No newline at end of file
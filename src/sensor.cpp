@@ -3,9 +3,15 @@
 // Handles RCWL-9620 I2C ultrasonic sensor operations
 
 #include <Arduino.h>
-#include <Wire.h>
 #include "config.h"
 #include "sensor.h"
+#include "i2c_bus.h"
+#include "ultrasonic.h"
+#include "level_filter.h"
+#include "bowl_model.h"
+#include "eating_monitor.h"
+#include "sensor_trace.h"
+#include "hopper.h"
 
 // External global variables (defined in main.cpp)
 extern float currentDistance;
@@ -18,6 +24,47 @@ extern SystemState systemState;
 // External function declarations (defined in main.cpp)
 extern void playBuzzer(int duration, int frequency);
 
+// Measurement cycles (driven by updateSensorReadings())
+static uint32_t sensorCycles = 0;       // Completed measurements, valid or not
+static float lastCycleDistance = -1.0f; // Result of the last cycle (-1 if invalid)
+static bool readingRequested = false;   // Start a cycle without waiting for the interval
+
+// Bowl level pipeline: currentDistance is the filtered value
+static LevelFilter bowlFilter;
+static float rawDistance = -1.0f;       // Last valid unfiltered reading (cm)
+
+// Adaptive sampling
+const int SAMPLING_MODES = SAMPLING_IDLE + 1;
+static SamplingMode samplingMode = SAMPLING_NORMAL;
+static uint32_t samplesByMode[SAMPLING_MODES] = {};
+static uint16_t activityLevelMm = 0;    // Filtered level at the last detected change
+static unsigned long lastLevelChange = 0;
+static unsigned long sensorBusyUs = 0;  // Time spent in I2C measurement calls
+
+// Cycle trace (PSRAM when available) and replay
+const uint32_t FALLBACK_TRACE_BYTES = 1024;
+static uint8_t fallbackTraceBuffer[FALLBACK_TRACE_BYTES];
+static SensorTrace sensorTrace;
+static bool replayActive = false;
+static TraceReader replayReader;
+static SensorReplayStats replayStats = {};
+
+// Live bowl pipeline, put aside while a replay runs through it
+struct BowlPipelineState {
+  LevelFilter filter;
+  float rawDistance;
+  float currentDistance;
+  bool bowlEmpty;
+  uint16_t activityLevelMm;
+  unsigned long lastLevelChange;
+  uint32_t sensorCycles;
+  float lastCycleDistance;
+};
+static BowlPipelineState liveState;
+
+static void applyBowlReading(float distanceCm, unsigned long nowMs, bool feeding);
+static void trackLevelActivity(unsigned long nowMs);
+
 
 // ========================================
 // PHASE 2: ULTRASONIC SENSOR FUNCTIONS
@@ -26,10 +73,21 @@ extern void playBuzzer(int duration, int frequency);
 void initializeUltrasonicSensor() {
   Serial.println("Initializing RCWL-9620 sensor...");
   
-  // Initialize I2C with custom pins and slower speed for stability
-  Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
-  Wire.setClock(50000); // 50kHz for better stability with RCWL-9620
-  Wire.setTimeout(1000); // 1 second timeout
+  levelFilterInit(bowlFilter);
+  initializeBowlModel();
+  
+  uint8_t* traceBuffer = (uint8_t*)ps_malloc(SENSOR_TRACE_BYTES);
+  if (traceBuffer != nullptr) {
+    sensorTraceInit(sensorTrace, traceBuffer, SENSOR_TRACE_BYTES);
+  } else {
+    sensorTraceInit(sensorTrace, fallbackTraceBuffer, FALLBACK_TRACE_BYTES);
+  }
+  
+  // The bus manager task owns Wire (clock and timeout in config.h)
+  if (!initializeI2CBus()) {
+    sensorInitialized = false;
+    return;
+  }
   
   // Give the sensor time to initialize
   delay(100);
@@ -39,15 +97,12 @@ void initializeUltrasonicSensor() {
   for (int attempt = 1; attempt <= 3; attempt++) {
     Serial.printf("Sensor attempt %d/3...\n", attempt);
     
-    Wire.beginTransmission(ULTRASONIC_ADDR);
-    byte error = Wire.endTransmission();
-    
-    if (error == 0) {
+    if (i2cProbe(ULTRASONIC_ADDR)) {
       sensorFound = true;
       Serial.printf("✓ Sensor found at 0x%02X\n", ULTRASONIC_ADDR);
       break;
     } else {
-      Serial.printf("Attempt %d failed (error %d)\n", attempt, error);
+      Serial.printf("Attempt %d failed\n", attempt);
     }
     delay(100); // Wait before retry
   }
@@ -58,7 +113,7 @@ void initializeUltrasonicSensor() {
     // Take initial reading
     float reading = readUltrasonicDistance();
     if (reading > 0) {
-      currentDistance = reading;
+      applyBowlReading(reading, millis(), false);
       Serial.printf("✓ Initial reading: %.1f cm\n", reading);
     }
   } else {
@@ -69,101 +124,309 @@ void initializeUltrasonicSensor() {
   }
 }
 
-void updateSensorReadings() {
-  // Only update sensor readings at specified intervals
-  if (millis() - lastSensorRead >= SENSOR_READ_INTERVAL) {
-    if (sensorInitialized) {
-      float newDistance = readUltrasonicDistance();
-      
-      if (newDistance > 0) {
-        currentDistance = newDistance;
-        
-        // Analyze bowl status based on distance
-        analyzeBowlStatus();
+// Run a valid reading through the filter chain; currentDistance follows
+// the filtered level, so a single bad echo cannot flip bowlEmpty
+static void applyBowlReading(float distanceCm, unsigned long nowMs, bool feeding) {
+  rawDistance = distanceCm;
+  levelFilterAdd(bowlFilter, (uint16_t)(distanceCm * 10.0f + 0.5f));
+  currentDistance = levelFilterValueMm(bowlFilter) / 10.0f;
+  updateBowlGrams(levelFilterValueMm(bowlFilter));
+  if (!replayActive) {
+    updateEatingMonitor(getBowlGrams(), nowMs, feeding); // Sessions are real events only
+  }
+  trackLevelActivity(nowMs);
+}
+
+// Log a completed measurement and return its distance (-1 if invalid)
+static float handleSample(const UltrasonicSample& sample) {
+  switch (sample.result) {
+    case ULTRASONIC_OK:
+      // Accept reading but show checksum status
+      if (!sample.checksumOk) {
+        Serial.printf("Checksum error (got:0x%02X calc:0x%02X) - accepting %.1f cm\n",
+                      sample.checksumReceived, sample.checksumCalculated, sample.distanceCm);
       }
-    }
+      return sample.distanceCm;
+    case ULTRASONIC_WRITE_ERROR:
+      if (sample.busFull) {
+        Serial.println("Sensor trigger not sent: I2C bus queue full");
+      } else {
+        Serial.printf("Sensor write error: %d\n", sample.i2cError);
+      }
+      return -1.0;
+    case ULTRASONIC_SHORT_READ:
+      Serial.printf("Insufficient sensor data: %d bytes\n", sample.bytesRead);
+      return -1.0;
+    case ULTRASONIC_OUT_OF_RANGE:
+    default:
+      Serial.printf("Distance out of range: %.1f cm\n", sample.distanceCm);
+      return -1.0;
+  }
+}
+
+// ========================================
+// ADAPTIVE SAMPLING
+// ========================================
+
+// Pick the cadence from the system state and recent bowl activity
+static SamplingMode selectSamplingMode() {
+  if (systemState == DISPENSING || systemState == MANUAL_FEEDING) {
+    return SAMPLING_FEEDING;
+  }
+  unsigned long stableFor = millis() - lastLevelChange;
+  if (stableFor < SENSOR_ACTIVITY_HOLD) {
+    return SAMPLING_ACTIVE;
+  }
+  if (stableFor >= SENSOR_IDLE_AFTER) {
+    return SAMPLING_IDLE;
+  }
+  return SAMPLING_NORMAL;
+}
+
+static unsigned long samplingInterval(SamplingMode mode) {
+  switch (mode) {
+    case SAMPLING_FEEDING: return SENSOR_FEEDING_INTERVAL;
+    case SAMPLING_ACTIVE:  return SENSOR_ACTIVE_INTERVAL;
+    case SAMPLING_IDLE:    return SENSOR_IDLE_INTERVAL;
+    case SAMPLING_NORMAL:
+    default:               return SENSOR_READ_INTERVAL;
+  }
+}
+
+// A filtered level change of SENSOR_ACTIVITY_MM or more restarts the
+// activity hold (pet eating, food dispensed, bowl moved)
+static void trackLevelActivity(unsigned long nowMs) {
+  uint16_t levelMm = levelFilterValueMm(bowlFilter);
+  int change = (int)levelMm - (int)activityLevelMm;
+  if (change < 0) change = -change;
+  if (change >= SENSOR_ACTIVITY_MM) {
+    activityLevelMm = levelMm;
+    lastLevelChange = nowMs;
+  }
+}
+
+// ========================================
+// CYCLE PROCESSING
+// ========================================
+
+// One completed measurement, live or replayed, through the same path
+static void processCycle(const UltrasonicSample& sample, unsigned long nowMs, bool feeding) {
+  float newDistance = handleSample(sample);
+  lastCycleDistance = newDistance;
+  sensorCycles++;
+  
+  if (newDistance > 0) {
+    applyBowlReading(newDistance, nowMs, feeding);
     
+    // Analyze bowl status based on the filtered distance
+    analyzeBowlStatus();
+  }
+}
+
+static void recordCycle(const UltrasonicSample& sample, unsigned long nowMs, bool feeding) {
+  TraceRecord record;
+  record.timeMs = nowMs;
+  if (sample.result == ULTRASONIC_OK || sample.result == ULTRASONIC_OUT_OF_RANGE) {
+    record.distanceMm = (uint16_t)constrain(sample.distanceCm * 10.0f + 0.5f, 0.0f, 65535.0f);
+  } else {
+    record.distanceMm = sensorTrace.lastMm;
+  }
+  record.flags = (uint8_t)(sample.result & TRACE_RESULT_MASK);
+  if (sample.checksumOk) record.flags |= TRACE_CHECKSUM_OK;
+  if (feeding) record.flags |= TRACE_FEEDING;
+  if (bowlEmpty) record.flags |= TRACE_BOWL_EMPTY;
+  record.flags |= (uint8_t)(min((int)sample.i2cError, 7) << TRACE_I2C_ERROR_SHIFT);
+  sensorTraceAppend(sensorTrace, record);
+}
+
+static void saveLiveState() {
+  liveState.filter = bowlFilter;
+  liveState.rawDistance = rawDistance;
+  liveState.currentDistance = currentDistance;
+  liveState.bowlEmpty = bowlEmpty;
+  liveState.activityLevelMm = activityLevelMm;
+  liveState.lastLevelChange = lastLevelChange;
+  liveState.sensorCycles = sensorCycles;
+  liveState.lastCycleDistance = lastCycleDistance;
+}
+
+// The bowl grams follow the restored filter
+static void restoreLiveState() {
+  bowlFilter = liveState.filter;
+  rawDistance = liveState.rawDistance;
+  currentDistance = liveState.currentDistance;
+  bowlEmpty = liveState.bowlEmpty;
+  activityLevelMm = liveState.activityLevelMm;
+  lastLevelChange = liveState.lastLevelChange;
+  sensorCycles = liveState.sensorCycles;
+  lastCycleDistance = liveState.lastCycleDistance;
+  if (levelFilterReady(bowlFilter)) {
+    updateBowlGrams(levelFilterValueMm(bowlFilter));
+  }
+}
+
+// Feed the next trace record in place of a measurement. Runs as fast as
+// updateSensorReadings() is called, on the recorded timestamps.
+static void replayNextRecord() {
+  TraceRecord record;
+  if (!sensorTraceNext(replayReader, record)) {
+    replayActive = false;
+    restoreLiveState();
+    Serial.printf("▶️ Replay done: %lu records, %lu bowl status changes, %lu differ from the recording\n",
+                  (unsigned long)replayStats.records, (unsigned long)replayStats.bowlEmptyChanges,
+                  (unsigned long)replayStats.mismatches);
+    return;
+  }
+  
+  UltrasonicSample sample = {};
+  sample.result = (UltrasonicResult)(record.flags & TRACE_RESULT_MASK);
+  sample.distanceCm = record.distanceMm / 10.0f;
+  sample.checksumOk = (record.flags & TRACE_CHECKSUM_OK) != 0;
+  sample.i2cError = record.flags >> TRACE_I2C_ERROR_SHIFT;
+  sample.bytesRead = (sample.result == ULTRASONIC_SHORT_READ) ? 0 : 3;
+  
+  bool previousBowlEmpty = bowlEmpty;
+  processCycle(sample, record.timeMs, (record.flags & TRACE_FEEDING) != 0);
+  
+  replayStats.records++;
+  replayStats.lastTimeMs = record.timeMs;
+  if (bowlEmpty != previousBowlEmpty) replayStats.bowlEmptyChanges++;
+  if (bowlEmpty != ((record.flags & TRACE_BOWL_EMPTY) != 0)) replayStats.mismatches++;
+}
+
+// Non-blocking: triggers a measurement at the adaptive interval (or on
+// request) and picks the result up once the conversion time has passed.
+// Each call costs at most one short I2C transaction.
+void updateSensorReadings() {
+  if (replayActive) {
+    replayNextRecord();
+    return;
+  }
+  if (!sensorInitialized) {
+    return;
+  }
+  
+  UltrasonicSample sample;
+  unsigned long callStart = micros();
+  if (ultrasonicUpdate(ULTRASONIC_BOWL, callStart, sample)) {
+    sensorBusyUs += micros() - callStart;
+    bool feeding = (systemState == DISPENSING || systemState == MANUAL_FEEDING);
+    processCycle(sample, millis(), feeding);
+    recordCycle(sample, millis(), feeding);
+  }
+  
+  // One ping at a time: the hopper sensor's echo would corrupt ours
+  samplingMode = selectSamplingMode();
+  if (!ultrasonicBusy(ULTRASONIC_BOWL) && !ultrasonicBusy(ULTRASONIC_HOPPER) &&
+      (readingRequested || millis() - lastSensorRead >= samplingInterval(samplingMode))) {
+    readingRequested = false;
     lastSensorRead = millis();
+    samplesByMode[samplingMode]++;
+    
+    unsigned long triggerStart = micros();
+    ultrasonicStart(ULTRASONIC_BOWL, triggerStart);
+    sensorBusyUs += micros() - triggerStart;
   }
 }
 
+// Ask for a fresh measurement. Returns the cycle count that the answer
+// will carry: wait until getSensorCycleCount() reaches it, then read
+// getLastCycleDistance(). A cycle already in flight was triggered too
+// early to count.
+uint32_t requestSensorReading() {
+  readingRequested = true;
+  return sensorCycles + (ultrasonicBusy(ULTRASONIC_BOWL) ? 2 : 1);
+}
+
+uint32_t getSensorCycleCount() {
+  return sensorCycles;
+}
+
+float getLastCycleDistance() {
+  return lastCycleDistance;
+}
+
+// Blocking measurement for start-up. Runs the same
+// state machine, waiting out the conversion time here.
 float readUltrasonicDistance() {
   if (!sensorInitialized) {
     return -1.0; // Error indicator
   }
   
-  // RCWL-9620 specific communication protocol
-  // Step 1: Send measurement trigger command
-  Wire.beginTransmission(ULTRASONIC_ADDR);
-  Wire.write(0x01); // Trigger measurement command
-  byte error = Wire.endTransmission();
-  
-  if (error != 0) {
-    // Try to reinitialize I2C on error 5 (timeout)
-    if (error == 5) {
-      Serial.println("I2C timeout, reinitializing...");
-      Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
-      Wire.setClock(100000);
-      delay(10);
-      
-      // Retry the command
-      Wire.beginTransmission(ULTRASONIC_ADDR);
-      Wire.write(0x01);
-      error = Wire.endTransmission();
-      
-      if (error != 0) {
-        Serial.printf("Sensor write error after retry: %d\n", error);
-        return -1.0;
-      }
-    } else {
-      Serial.printf("Sensor write error: %d\n", error);
-      return -1.0;
-    }
+  UltrasonicSample sample;
+  // Let a measurement already in flight finish first
+  while (ultrasonicBusy(ULTRASONIC_BOWL)) {
+    if (ultrasonicUpdate(ULTRASONIC_BOWL, micros(), sample)) break;
+    delay(1);
+  }
+  // and a hopper cycle, which its owner picks up
+  while (ultrasonicBusy(ULTRASONIC_HOPPER)) {
+    updateHopperLevel();
+    delay(1);
   }
   
-  // Step 2: Wait for measurement completion (RCWL-9620 needs ~60-80ms)
-  delay(80);
-  
-  // Step 3: Read the distance data (3 bytes: high, low, checksum)
-  Wire.requestFrom(ULTRASONIC_ADDR, 3);
-  
-  if (Wire.available() >= 3) {
-    byte highByte = Wire.read();
-    byte lowByte = Wire.read();
-    byte checksumReceived = Wire.read();
-    
-    // Calculate distance in mm, then convert to cm
-    uint16_t distance_mm = (highByte << 8) | lowByte;
-    float distance_cm = distance_mm / 10.0;
-    
-    // RCWL-9620 checksum calculation: sum of high and low bytes
-    byte calculatedChecksum = (highByte + lowByte) & 0xFF;
-    
-    // Validate the reading
-    if (distance_cm > 0 && distance_cm < 500) { // Valid range check
-      // Accept reading but show checksum status
-      if (checksumReceived != calculatedChecksum) {
-        Serial.printf("Checksum error (got:0x%02X calc:0x%02X) - accepting %.1f cm\n", 
-                     checksumReceived, calculatedChecksum, distance_cm);
-      }
-      return distance_cm;
-    } else {
-      Serial.printf("Distance out of range: %.1f cm\n", distance_cm);
-      return -1.0;
+  ultrasonicStart(ULTRASONIC_BOWL, micros());
+  while (!ultrasonicUpdate(ULTRASONIC_BOWL, micros(), sample)) {
+    delay(1);
+  }
+  return handleSample(sample);
+}
+
+// ========================================
+// TRACE DUMP AND REPLAY
+// ========================================
+
+// Text dump for sensorTraceImport(): header, 32 bytes of hex per line, END
+void dumpSensorTrace() {
+  Serial.printf("TRACE %d %lu %lu %u %lu\n", SENSOR_TRACE_VERSION,
+                (unsigned long)sensorTrace.records, (unsigned long)sensorTrace.baseTimeMs,
+                sensorTrace.baseMm, (unsigned long)sensorTrace.used);
+  for (uint32_t i = 0; i < sensorTrace.used; i++) {
+    Serial.printf("%02X", sensorTrace.buffer[(sensorTrace.tail + i) % sensorTrace.capacity]);
+    if (i % 32 == 31 || i == sensorTrace.used - 1) {
+      Serial.println();
     }
-  } else {
-    Serial.printf("Insufficient sensor data: %d bytes\n", Wire.available());
-    return -1.0;
   }
+  Serial.println("END");
+}
+
+// Replay a trace through the bowl pipeline (filter, grams, bowl status)
+// instead of the sensor. The replay starts from an empty filter and a
+// bowl with food, like a boot; the live state is restored when it ends.
+// Eating sessions are not detected on replayed readings.
+void beginSensorReplay(const SensorTrace& trace) {
+  saveLiveState();
+  levelFilterReset(bowlFilter);
+  rawDistance = -1.0f;
+  bowlEmpty = false;
+  activityLevelMm = 0;
+  lastLevelChange = 0;
+  replayStats = {};
+  sensorTraceBeginRead(trace, replayReader);
+  replayActive = true;
+  Serial.printf("▶️ Replaying %lu sensor records\n", (unsigned long)trace.records);
+}
+
+bool isSensorReplayActive() {
+  return replayActive;
+}
+
+const SensorReplayStats& getSensorReplayStats() {
+  return replayStats;
+}
+
+const SensorTrace& getSensorTrace() {
+  return sensorTrace;
 }
 
 void analyzeBowlStatus() {
   bool previousBowlEmpty = bowlEmpty;
   
-  // Determine if bowl is empty based on distance thresholds
-  if (currentDistance > BOWL_EMPTY_THRESHOLD) {
+  // Determine if bowl is empty from the grams remaining (bowl_model.h)
+  float grams = getBowlGrams();
+  if (grams <= BOWL_EMPTY_GRAMS) {
     bowlEmpty = true;
-  } else if (currentDistance < BOWL_FULL_THRESHOLD) {
+  } else if (grams >= BOWL_HAS_FOOD_GRAMS) {
     bowlEmpty = false;
   }
   // Use hysteresis - don't change state if in middle range
@@ -171,28 +434,88 @@ void analyzeBowlStatus() {
   // Alert if bowl status changed
   if (bowlEmpty != previousBowlEmpty) {
     if (bowlEmpty) {
-      Serial.println("🍽️ ALERT: Bowl is now EMPTY!");
-      // Play alerting beeps
-      playBuzzer(100, 1000);
-      delay(50);
-      playBuzzer(100, 1000);
+      Serial.printf("🍽️ ALERT: Bowl is now EMPTY! (%.0f g left)\n", grams);
+      // Play alerting beeps (silent during a replay)
+      if (!replayActive) {
+        playBuzzer(100, 1000);
+        delay(50);
+        playBuzzer(100, 1000);
+      }
     } else {
-      Serial.println("🍽️ INFO: Bowl now has food");
-      playBuzzer(100, 2000); // Happy beep
+      Serial.printf("🍽️ INFO: Bowl now has food (%.0f g)\n", grams);
+      if (!replayActive) {
+        playBuzzer(100, 2000); // Happy beep
+      }
     }
   }
 }
 
 void printSensorDebug() {
   if (sensorInitialized) {
-    Serial.printf("SENSOR: %.1f cm | Bowl: %s\n", 
-                  currentDistance,
-                  bowlEmpty ? "EMPTY" : "OK");
+    Serial.printf("SENSOR: %.1f cm (raw %.1f, median %.1f, %lu rejected) | Bowl: %s, %.0f g\n", 
+                  currentDistance, rawDistance,
+                  levelFilterMedianMm(bowlFilter) / 10.0f,
+                  (unsigned long)bowlFilter.rejected,
+                  bowlEmpty ? "EMPTY" : "OK", getBowlGrams());
   } else {
     Serial.println("SENSOR: ERROR - Not initialized");
   }
 }
 
+// Cadence, samples per mode and I2C/CPU cost compared with a fixed
+// SENSOR_READ_INTERVAL
+void printSamplingStatus() {
+  static const char* modeNames[SAMPLING_MODES] = {"FEEDING", "ACTIVE", "NORMAL", "IDLE"};
+  
+  uint32_t total = 0;
+  for (int i = 0; i < SAMPLING_MODES; i++) {
+    total += samplesByMode[i];
+  }
+  uint32_t fixedRate = millis() / SENSOR_READ_INTERVAL;
+  
+  Serial.printf("   Sampling: %s every %lu ms | Samples: %lu (feed %lu, active %lu, normal %lu, idle %lu)\n",
+                modeNames[samplingMode], samplingInterval(samplingMode), (unsigned long)total,
+                (unsigned long)samplesByMode[SAMPLING_FEEDING], (unsigned long)samplesByMode[SAMPLING_ACTIVE],
+                (unsigned long)samplesByMode[SAMPLING_NORMAL], (unsigned long)samplesByMode[SAMPLING_IDLE]);
+  Serial.printf("   I2C cycles vs fixed %d ms: %lu / %lu (%+.0f%%) | Measurement CPU: %lu ms\n",
+                SENSOR_READ_INTERVAL, (unsigned long)total, (unsigned long)fixedRate,
+                fixedRate > 0 ? 100.0 * ((double)total - fixedRate) / fixedRate : 0.0,
+                sensorBusyUs / 1000);
+}
+
+// Health counters kept by the measurement state machine, per sensor
+void printSensorHealth() {
+  static const char* channelNames[ULTRASONIC_CHANNELS] = {"Bowl", "Hopper"};
+  
+  for (int c = 0; c < ULTRASONIC_CHANNELS; c++) {
+    const UltrasonicHealth& health = ultrasonicHealth((UltrasonicChannel)c);
+    if (health.cycles == 0 && c != ULTRASONIC_BOWL) continue;
+    
+    float goodPercent = health.cycles > 0 ? 100.0f * health.goodReads / health.cycles : 0.0f;
+    Serial.printf("   %s sensor health: %lu cycles, %.1f%% good | checksum %lu, range %lu, short %lu | retries %lu\n",
+                  channelNames[c], (unsigned long)health.cycles, goodPercent,
+                  (unsigned long)health.checksumErrors, (unsigned long)health.outOfRange,
+                  (unsigned long)health.shortReads, (unsigned long)health.retries);
+    Serial.printf("      I2C errors: NACK a/d %lu/%lu, other %lu, timeout %lu | bus queue full %lu\n",
+                  (unsigned long)health.i2cErrors[I2C_ERROR_NACK_ADDRESS], (unsigned long)health.i2cErrors[I2C_ERROR_NACK_DATA],
+                  (unsigned long)health.i2cErrors[I2C_ERROR_OTHER], (unsigned long)health.i2cErrors[I2C_ERROR_TIMEOUT],
+                  (unsigned long)health.busFull);
+    Serial.print("      Latency ms:");
+    for (int b = 0; b < ULTRASONIC_LATENCY_BUCKETS; b++) {
+      if (b < ULTRASONIC_LATENCY_BUCKETS - 1) {
+        Serial.printf(" <%u:%lu", ULTRASONIC_LATENCY_BOUNDS_MS[b], (unsigned long)health.latency[b]);
+      } else {
+        Serial.printf(" >=%u:%lu", ULTRASONIC_LATENCY_BOUNDS_MS[b - 1], (unsigned long)health.latency[b]);
+      }
+    }
+    Serial.printf(" | max %.1f\n", health.latencyMaxUs / 1000.0f);
+    
+    if (health.cycles >= SENSOR_HEALTH_MIN_CYCLES && goodPercent < SENSOR_HEALTH_MIN_GOOD_PERCENT) {
+      Serial.printf("   ⚠️ %s sensor degraded: only %.1f%% good readings\n", channelNames[c], goodPercent);
+    }
+  }
+}
+
 // ========================================
 // SENSOR STATUS GETTER FUNCTIONS
 // ========================================
@@ -205,6 +528,22 @@ float getCurrentDistance() {
   return currentDistance;
 }
 
+float getRawDistance() {
+  return rawDistance;
+}
+
+SamplingMode getSamplingMode() {
+  return samplingMode;
+}
+
+unsigned long getSensorInterval() {
+  return samplingInterval(samplingMode);
+}
+
+uint32_t getSensorSampleCount(SamplingMode mode) {
+  return samplesByMode[mode];
+}
+
 bool isBowlEmpty() {
   return bowlEmpty;
 }
\ No newline at end of file
@@ -0,0 +1,219 @@
+// sensor_trace.cpp
+// Sensor trace module for Smart Pet Feeder
+// Varint-encoded bowl sensor records in a byte ring, with a text import for replay
+
+#include <stdlib.h>
+#include <string.h>
+#include "sensor_trace.h"
+
+// ========================================
+// ENCODING
+// ========================================
+
+static int putVarint(uint8_t* out, uint32_t value) {
+  int length = 0;
+  while (value >= 0x80) {
+    out[length++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[length++] = (uint8_t)value;
+  return length;
+}
+
+static uint32_t zigzag(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static int encodeRecord(uint8_t* out, const TraceRecord& record, uint32_t prevTimeMs, uint16_t prevMm) {
+  int length = putVarint(out, record.timeMs - prevTimeMs);
+  length += putVarint(out + length, zigzag((int32_t)record.distanceMm - (int32_t)prevMm));
+  out[length++] = record.flags;
+  return length;
+}
+
+// Decode the record starting at ring offset position; returns its length
+static int decodeRecord(const SensorTrace& trace, uint32_t position, uint32_t prevTimeMs,
+                        uint16_t prevMm, TraceRecord& record) {
+  int length = 0;
+  uint32_t fields[2];
+  for (int f = 0; f < 2; f++) {
+    uint32_t value = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+      byte = trace.buffer[(position + length++) % trace.capacity];
+      value |= (uint32_t)(byte & 0x7F) << shift;
+      shift += 7;
+    } while ((byte & 0x80) && shift < 35);
+    fields[f] = value;
+  }
+  record.timeMs = prevTimeMs + fields[0];
+  record.distanceMm = (uint16_t)(prevMm + unzigzag(fields[1]));
+  record.flags = trace.buffer[(position + length++) % trace.capacity];
+  return length;
+}
+
+// ========================================
+// RING
+// ========================================
+
+void sensorTraceInit(SensorTrace& trace, uint8_t* buffer, uint32_t capacity) {
+  trace.buffer = buffer;
+  trace.capacity = capacity;
+  sensorTraceClear(trace);
+}
+
+void sensorTraceClear(SensorTrace& trace) {
+  trace.head = 0;
+  trace.tail = 0;
+  trace.used = 0;
+  trace.records = 0;
+  trace.dropped = 0;
+  trace.baseTimeMs = 0;
+  trace.baseMm = 0;
+  trace.lastTimeMs = 0;
+  trace.lastMm = 0;
+}
+
+// Drop the oldest record; its values become the base of the next one
+static void dropOldest(SensorTrace& trace) {
+  TraceRecord oldest;
+  int length = decodeRecord(trace, trace.tail, trace.baseTimeMs, trace.baseMm, oldest);
+  trace.baseTimeMs = oldest.timeMs;
+  trace.baseMm = oldest.distanceMm;
+  trace.tail = (trace.tail + length) % trace.capacity;
+  trace.used -= length;
+  trace.records--;
+  trace.dropped++;
+}
+
+void sensorTraceAppend(SensorTrace& trace, const TraceRecord& record) {
+  if (trace.buffer == nullptr || trace.capacity < (uint32_t)SENSOR_TRACE_MAX_RECORD) {
+    return;
+  }
+
+  uint8_t encoded[SENSOR_TRACE_MAX_RECORD];
+  int length = encodeRecord(encoded, record, trace.lastTimeMs, trace.lastMm);
+
+  while (trace.capacity - trace.used < (uint32_t)length) {
+    dropOldest(trace);
+  }
+  if (trace.records == 0) {
+    // Empty ring: the record is a delta from the last values appended
+    trace.baseTimeMs = trace.lastTimeMs;
+    trace.baseMm = trace.lastMm;
+  }
+
+  for (int i = 0; i < length; i++) {
+    trace.buffer[trace.head] = encoded[i];
+    trace.head = (trace.head + 1) % trace.capacity;
+  }
+  trace.used += length;
+  trace.records++;
+  trace.lastTimeMs = record.timeMs;
+  trace.lastMm = record.distanceMm;
+}
+
+// ========================================
+// PLAYBACK
+// ========================================
+
+void sensorTraceBeginRead(const SensorTrace& trace, TraceReader& reader) {
+  reader.trace = &trace;
+  reader.position = trace.tail;
+  reader.remaining = trace.records;
+  reader.timeMs = trace.baseTimeMs;
+  reader.distanceMm = trace.baseMm;
+}
+
+bool sensorTraceNext(TraceReader& reader, TraceRecord& record) {
+  if (reader.remaining == 0) {
+    return false;
+  }
+  const SensorTrace& trace = *reader.trace;
+  int length = decodeRecord(trace, reader.position, reader.timeMs, reader.distanceMm, record);
+  reader.position = (reader.position + length) % trace.capacity;
+  reader.remaining--;
+  reader.timeMs = record.timeMs;
+  reader.distanceMm = record.distanceMm;
+  return true;
+}
+
+// ========================================
+// DUMP AND IMPORT
+// ========================================
+
+// Ring contents oldest first (what the dump's hex lines carry)
+uint32_t sensorTraceCopy(const SensorTrace& trace, uint8_t* out, uint32_t maxBytes) {
+  uint32_t count = trace.used < maxBytes ? trace.used : maxBytes;
+  for (uint32_t i = 0; i < count; i++) {
+    out[i] = trace.buffer[(trace.tail + i) % trace.capacity];
+  }
+  return count;
+}
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Load a serial dump (text between and including the TRACE and END lines;
+// anything before TRACE is skipped). buffer must hold the dumped bytes.
+bool sensorTraceImport(SensorTrace& trace, uint8_t* buffer, uint32_t capacity, const char* text) {
+  const char* header = strstr(text, "TRACE ");
+  if (header == nullptr) {
+    return false;
+  }
+
+  char* cursor;
+  long version = strtol(header + 6, &cursor, 10);
+  unsigned long records = strtoul(cursor, &cursor, 10);
+  unsigned long baseTimeMs = strtoul(cursor, &cursor, 10);
+  unsigned long baseMm = strtoul(cursor, &cursor, 10);
+  unsigned long bytes = strtoul(cursor, &cursor, 10);
+  if (version != SENSOR_TRACE_VERSION || bytes > capacity) {
+    return false;
+  }
+
+  sensorTraceInit(trace, buffer, capacity);
+  uint32_t count = 0;
+  int high = -1;
+  for (const char* c = cursor; *c != '\0' && strncmp(c, "END", 3) != 0; c++) {
+    int value = hexValue(*c);
+    if (value < 0) continue;
+    if (high < 0) {
+      high = value;
+    } else if (count < bytes) {
+      buffer[count++] = (uint8_t)((high << 4) | value);
+      high = -1;
+    }
+  }
+  if (count != bytes) {
+    return false;
+  }
+
+  trace.used = count;
+  trace.head = count % capacity;
+  trace.records = records;
+  trace.baseTimeMs = baseTimeMs;
+  trace.baseMm = (uint16_t)baseMm;
+
+  // Walk the records once to validate them and find the append base
+  TraceReader reader;
+  TraceRecord record;
+  sensorTraceBeginRead(trace, reader);
+  while (sensorTraceNext(reader, record)) {}
+  if (reader.position != trace.head) {
+    sensorTraceClear(trace);
+    return false;
+  }
+  trace.lastTimeMs = reader.timeMs;
+  trace.lastMm = reader.distanceMm;
+  return true;
+}
@@ -0,0 +1,156 @@
+// sms_outbox.cpp
+// SMS outbox module for Smart Pet Feeder
+// Preallocated message slots ordered by an index-based binary heap
+
+#include <string.h>
+#include "sms_outbox.h"
+
+// ========================================
+// HEAP
+// ========================================
+
+// True when slot a is sent before slot b
+static bool sendsBefore(const SMSOutbox& outbox, uint16_t a, uint16_t b) {
+  const SMSOutboxSlot& first = outbox.slots[a];
+  const SMSOutboxSlot& second = outbox.slots[b];
+  if (first.priority != second.priority) {
+    return first.priority < second.priority;
+  }
+  return (int32_t)(first.sequence - second.sequence) < 0;
+}
+
+static void siftUp(SMSOutbox& outbox, uint16_t position) {
+  uint16_t slot = outbox.heap[position];
+  while (position > 0) {
+    uint16_t parent = (position - 1) / 2;
+    if (!sendsBefore(outbox, slot, outbox.heap[parent])) break;
+    outbox.heap[position] = outbox.heap[parent];
+    position = parent;
+  }
+  outbox.heap[position] = slot;
+}
+
+static void siftDown(SMSOutbox& outbox, uint16_t position) {
+  uint16_t slot = outbox.heap[position];
+  while (true) {
+    uint16_t child = 2 * position + 1;
+    if (child >= outbox.count) break;
+    if (child + 1 < outbox.count && sendsBefore(outbox, outbox.heap[child + 1], outbox.heap[child])) {
+      child++;
+    }
+    if (!sendsBefore(outbox, outbox.heap[child], slot)) break;
+    outbox.heap[position] = outbox.heap[child];
+    position = child;
+  }
+  outbox.heap[position] = slot;
+}
+
+// Lowest priority held (highest number)
+static uint8_t lowestPriority(const SMSOutbox& outbox) {
+  uint8_t priority = SMS_OUTBOX_PRIORITIES - 1;
+  while (priority > 0 && outbox.countByPriority[priority] == 0) {
+    priority--;
+  }
+  return priority;
+}
+
+// Heap position of the oldest message of a priority. Only used when the
+// outbox is full, so a linear scan is fine.
+static uint16_t oldestOfPriority(const SMSOutbox& outbox, uint8_t priority) {
+  uint16_t oldest = outbox.count;
+  for (uint16_t position = 0; position < outbox.count; position++) {
+    const SMSOutboxSlot& entry = outbox.slots[outbox.heap[position]];
+    if (entry.priority == priority &&
+        (oldest == outbox.count ||
+         (int32_t)(entry.sequence - outbox.slots[outbox.heap[oldest]].sequence) < 0)) {
+      oldest = position;
+    }
+  }
+  return oldest;
+}
+
+// ========================================
+// OUTBOX
+// ========================================
+
+uint32_t smsOutboxStorageBytes(uint16_t capacity) {
+  return capacity * (sizeof(SMSOutboxSlot) + 2 * sizeof(uint16_t));
+}
+
+void smsOutboxInit(SMSOutbox& outbox, void* storage, uint16_t capacity) {
+  outbox = {};
+  outbox.slots = (SMSOutboxSlot*)storage;
+  outbox.heap = (uint16_t*)(outbox.slots + capacity);
+  outbox.freeSlots = outbox.heap + capacity;
+  outbox.capacity = capacity;
+  for (uint16_t i = 0; i < capacity; i++) {
+    outbox.freeSlots[i] = capacity - 1 - i;
+  }
+}
+
+static void fillSlot(SMSOutbox& outbox, uint16_t slot, const char* number, const char* message,
+                     uint8_t priority, uint32_t nowMs) {
+  SMSOutboxSlot& entry = outbox.slots[slot];
+  strncpy(entry.number, number, SMS_NUMBER_LENGTH - 1);
+  entry.number[SMS_NUMBER_LENGTH - 1] = '\0';
+  strncpy(entry.message, message, SMS_MESSAGE_LENGTH - 1);
+  entry.message[SMS_MESSAGE_LENGTH - 1] = '\0';
+  entry.priority = priority;
+  entry.queueTime = nowMs;
+  entry.sequence = outbox.nextSequence++;
+  outbox.countByPriority[priority]++;
+}
+
+bool smsOutboxPush(SMSOutbox& outbox, const char* number, const char* message,
+                   uint8_t priority, uint32_t nowMs) {
+  if (priority >= SMS_OUTBOX_PRIORITIES) {
+    priority = SMS_OUTBOX_PRIORITIES - 1;
+  }
+
+  if (outbox.count == outbox.capacity) {
+    if (outbox.count == 0) {
+      outbox.dropped++;
+      return false;
+    }
+    // Full: the message takes the slot of the oldest message of the
+    // lowest priority held, if that priority is lower than its own (the
+    // String queue's rule). Its key only gets smaller, so sift up.
+    uint8_t lowest = lowestPriority(outbox);
+    if (priority >= lowest) {
+      outbox.dropped++;
+      return false;
+    }
+    uint16_t position = oldestOfPriority(outbox, lowest);
+    uint16_t slot = outbox.heap[position];
+    outbox.countByPriority[outbox.slots[slot].priority]--;
+    outbox.evicted++;
+    fillSlot(outbox, slot, number, message, priority, nowMs);
+    siftUp(outbox, position);
+    return true;
+  }
+
+  uint16_t slot = outbox.freeSlots[outbox.capacity - outbox.count - 1];
+  fillSlot(outbox, slot, number, message, priority, nowMs);
+  outbox.heap[outbox.count] = slot;
+  outbox.count++;
+  siftUp(outbox, outbox.count - 1);
+  return true;
+}
+
+const SMSOutboxSlot* smsOutboxPeek(const SMSOutbox& outbox) {
+  return outbox.count > 0 ? &outbox.slots[outbox.heap[0]] : nullptr;
+}
+
+void smsOutboxPop(SMSOutbox& outbox) {
+  if (outbox.count == 0) {
+    return;
+  }
+  uint16_t slot = outbox.heap[0];
+  outbox.countByPriority[outbox.slots[slot].priority]--;
+  outbox.count--;
+  outbox.freeSlots[outbox.capacity - outbox.count - 1] = slot;
+  if (outbox.count > 0) {
+    outbox.heap[0] = outbox.heap[outbox.count];
+    siftDown(outbox, 0);
+  }
+}
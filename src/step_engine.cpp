@@ -0,0 +1,385 @@
+// step_engine.cpp
+// Timer-driven step pulse engine for Smart Pet Feeder
+// Clocks DRV8825 STEP pulses from a hardware timer ISR so moves run in the background
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+#include "config.h"
+#include "fast_gpio.h"
+#include "motion_profile.h"
+#include "step_engine.h"
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+// Engine timing constants
+const uint8_t STEP_TIMER_NUMBER = 0;       // Hardware timer used for stepping
+const uint16_t STEP_TIMER_DIVIDER = 80;    // 80 MHz APB / 80 = 1 us per tick
+const uint32_t STEP_PULSE_WIDTH_US = 2;    // DRV8825 needs >= 1.9 us high time
+const uint32_t DIR_SETUP_US = 10;          // Delay between DIR change and first pulse
+
+// DRV8825 M2..M0 code for a 1/divisor microstep resolution (log2 of divisor)
+constexpr uint8_t microstepModeBits(int divisor) {
+  return (divisor <= 1) ? 0 : 1 + microstepModeBits(divisor / 2);
+}
+
+static_assert(MICROSTEP_FINE % MICROSTEP_COARSE == 0, "MICROSTEP_FINE must be a multiple of MICROSTEP_COARSE");
+static_assert((MICROSTEP_FINE & (MICROSTEP_FINE - 1)) == 0 && MICROSTEP_FINE <= 32,
+              "DRV8825 supports 1, 2, 4, 8, 16 or 32 microsteps");
+static_assert((MICROSTEP_COARSE & (MICROSTEP_COARSE - 1)) == 0 && MICROSTEP_COARSE <= 32,
+              "DRV8825 supports 1, 2, 4, 8, 16 or 32 microsteps");
+
+// Driver pins (direct register writes, see fast_gpio.h)
+typedef FastOutputPin<MOTOR_STEP_PIN> StepPin;
+typedef FastOutputPin<MOTOR_DIR_PIN> DirPin;
+typedef FastOutputPin<MOTOR_M0_PIN> M0Pin;
+typedef FastOutputPin<MOTOR_M1_PIN> M1Pin;
+typedef FastOutputPin<MOTOR_M2_PIN> M2Pin;
+
+// Active move (written before the timer is armed, read from the ISR)
+static StepMove activeMove;
+static volatile bool engineBusy = false;
+static volatile bool stopRequested = false;
+static volatile int stepsDone = 0;
+static volatile int microPhase = 0;          // Fine pulses into the current step
+static volatile bool fineMode = false;       // Driver currently in MICROSTEP_FINE
+static void (*completeCallback)() = nullptr; // Called from the ISR when a move ends
+
+// ========================================
+// PLATFORM LAYER
+// ========================================
+
+#ifdef ARDUINO
+
+static hw_timer_t* stepTimer = nullptr;
+static uint32_t pulseWidthCycles = 0;   // STEP_PULSE_WIDTH_US in CPU cycles
+static uint32_t pulseStartCycles = 0;
+
+// The interval lookup and step bookkeeping run while STEP is high, so the
+// wait only spins off what is left of STEP_PULSE_WIDTH_US (usually
+// nothing). A second timer alarm for the falling edge would cost more:
+// entering and leaving the timer ISR alone takes a few microseconds.
+static inline void IRAM_ATTR stepPinHigh() {
+  pulseStartCycles = ESP.getCycleCount();
+  StepPin::set();
+}
+static inline void IRAM_ATTR stepPinLow() { StepPin::clear(); }
+static inline void IRAM_ATTR pulseWidthWait() {
+  while (ESP.getCycleCount() - pulseStartCycles < pulseWidthCycles) {
+  }
+}
+
+static inline void IRAM_ATTR scheduleNext(uint32_t delayUs) {
+  timerAlarmWrite(stepTimer, delayUs, true);
+}
+
+static inline void IRAM_ATTR stopTimer() {
+  timerAlarmDisable(stepTimer);
+}
+
+#else
+
+// Simulated timer: one microsecond per tick, alarms fire in stepEngineHostAdvance()
+static uint64_t hostNow = 0;
+static uint64_t hostNextAlarm = 0;
+static bool hostAlarmArmed = false;
+static uint32_t hostPulseCount = 0;
+static uint32_t hostFinePulseCount = 0;
+static uint64_t hostFirstPulse = 0;
+static uint64_t hostLastPulse = 0;
+
+static inline void stepPinHigh() {
+  if (hostPulseCount == 0) hostFirstPulse = hostNow;
+  hostLastPulse = hostNow;
+  hostPulseCount++;
+  if (fineMode) hostFinePulseCount++;
+  StepPin::set();
+}
+static inline void stepPinLow() { StepPin::clear(); }
+static inline void pulseWidthWait() {}
+
+static inline void scheduleNext(uint32_t delayUs) {
+  hostNextAlarm = hostNow + delayUs;
+  hostAlarmArmed = true;
+}
+
+static inline void stopTimer() {
+  hostAlarmArmed = false;
+}
+
+#endif
+
+static inline void setDirectionPin(bool clockwise) {
+  DirPin::write(clockwise);
+}
+
+static inline void IRAM_ATTR setMicrostepPins(bool fine) {
+  constexpr uint8_t coarseBits = microstepModeBits(MICROSTEP_COARSE);
+  constexpr uint8_t fineBits = microstepModeBits(MICROSTEP_FINE);
+  uint8_t bits = fine ? fineBits : coarseBits;
+  M0Pin::write(bits & 0x01);
+  M1Pin::write(bits & 0x02);
+  M2Pin::write(bits & 0x04);
+}
+
+// ========================================
+// PROFILE CALCULATION
+// ========================================
+
+// Interval to wait after pulse number stepIndex (0-based).
+// Pure table lookup: ramp up through the table, cruise, ramp back down.
+// Short moves that cannot reach cruise speed are cut to a triangle.
+uint32_t IRAM_ATTR stepEngineInterval(const StepMove& move, int stepIndex) {
+  const StepProfile& p = move.profile;
+  if (p.rampTable == nullptr || p.rampSteps <= 0) {
+    return p.cruiseDelay;
+  }
+
+  int ramp = p.rampSteps;
+  if (ramp > move.steps / 2) ramp = move.steps / 2;
+
+  int fromEnd = move.steps - 1 - stepIndex;
+  if (stepIndex < ramp) {
+    return p.rampTable[stepIndex];
+  }
+  if (fromEnd < ramp) {
+    return p.rampTable[fromEnd];
+  }
+  return (ramp < p.rampSteps) ? p.rampTable[ramp] : p.cruiseDelay;
+}
+
+// True if step stepIndex belongs to the fine microstep tail of the move
+static inline bool IRAM_ATTR isFineStep(const StepMove& move, int stepIndex) {
+  return MICROSTEPS_PER_STEP > 1 && stepIndex >= move.steps - move.fineSteps;
+}
+
+// A fine pulse turns the rotor 1/MICROSTEPS_PER_STEP as far as a full
+// step, so at the motor's speed limit it may come that much sooner
+const uint32_t MIN_FINE_PULSE_DELAY = MIN_STEP_DELAY / MICROSTEPS_PER_STEP;
+static_assert(MIN_FINE_PULSE_DELAY > 2 * STEP_PULSE_WIDTH_US,
+              "STEP needs its high and low time within one fine pulse interval");
+
+// A fine step is split into equal pulses, never faster than MIN_FINE_PULSE_DELAY
+static inline uint32_t IRAM_ATTR finePulseInterval(uint32_t stepInterval) {
+  uint32_t interval = stepInterval / MICROSTEPS_PER_STEP;
+  return (interval < MIN_FINE_PULSE_DELAY) ? MIN_FINE_PULSE_DELAY : interval;
+}
+
+uint64_t stepEngineMoveDuration(const StepMove& move) {
+  uint64_t total = DIR_SETUP_US;
+  for (int i = 0; i < move.steps; i++) {
+    uint32_t interval = stepEngineInterval(move, i);
+    if (isFineStep(move, i)) {
+      total += (uint64_t)finePulseInterval(interval) * MICROSTEPS_PER_STEP;
+    } else {
+      total += interval;
+    }
+  }
+  return total;
+}
+
+uint32_t stepEngineMovePulses(const StepMove& move) {
+  uint32_t pulses = 0;
+  for (int i = 0; i < move.steps; i++) {
+    pulses += isFineStep(move, i) ? MICROSTEPS_PER_STEP : 1;
+  }
+  return pulses;
+}
+
+static inline void IRAM_ATTR setMicrostepMode(bool fine) {
+  if (fine != fineMode) {
+    setMicrostepPins(fine);
+    fineMode = fine;
+  }
+}
+
+// ========================================
+// TIMER INTERRUPT
+// ========================================
+
+static void IRAM_ATTR onStepTimer() {
+  if (!engineBusy) {
+    stopTimer();
+    return;
+  }
+
+  // Move finished (last interval elapsed) or aborted on a step boundary
+  if ((stopRequested && microPhase == 0) || stepsDone >= activeMove.steps) {
+    stopTimer();
+    engineBusy = false;
+    if (completeCallback != nullptr) {
+      completeCallback();
+    }
+    return;
+  }
+
+  stepPinHigh();
+  uint32_t nextDelay = stepEngineInterval(activeMove, stepsDone);
+  if (fineMode) {
+    nextDelay = finePulseInterval(nextDelay);
+    microPhase = microPhase + 1;
+    if (microPhase >= MICROSTEPS_PER_STEP) {
+      microPhase = 0;
+      stepsDone = stepsDone + 1;
+    }
+  } else {
+    stepsDone = stepsDone + 1;
+  }
+  pulseWidthWait();
+  stepPinLow();
+
+  // Change resolution on a step boundary, a full interval before the next pulse
+  if (microPhase == 0 && stepsDone < activeMove.steps) {
+    setMicrostepMode(isFineStep(activeMove, stepsDone));
+  }
+
+  scheduleNext(nextDelay);
+}
+
+// ========================================
+// ENGINE CONTROL
+// ========================================
+
+bool stepEngineBegin() {
+#ifdef ARDUINO
+  if (stepTimer == nullptr) {
+    stepTimer = timerBegin(STEP_TIMER_NUMBER, STEP_TIMER_DIVIDER, true);
+    if (stepTimer == nullptr) {
+      return false;
+    }
+    timerAttachInterrupt(stepTimer, &onStepTimer, true);
+  }
+  pulseWidthCycles = STEP_PULSE_WIDTH_US * getCpuFrequencyMhz();
+#endif
+  engineBusy = false;
+  stopRequested = false;
+  stepsDone = 0;
+  microPhase = 0;
+  fineMode = false;
+  setMicrostepPins(false);
+  return true;
+}
+
+bool stepEngineStart(const StepMove& move) {
+  if (engineBusy || move.steps <= 0) {
+    return false;
+  }
+#ifdef ARDUINO
+  if (stepTimer == nullptr) {
+    return false;
+  }
+#endif
+
+  activeMove = move;
+  stepsDone = 0;
+  microPhase = 0;
+
+  setDirectionPin(move.clockwise);
+  setMicrostepMode(isFineStep(move, 0));
+
+  // First pulse fires after the direction setup time
+  engineBusy = true;
+#ifdef ARDUINO
+  timerWrite(stepTimer, 0);
+  timerAlarmWrite(stepTimer, DIR_SETUP_US, true);
+  timerAlarmEnable(stepTimer);
+#else
+  scheduleNext(DIR_SETUP_US);
+#endif
+  return true;
+}
+
+// Abort the running move. The ISR notices within one step interval
+// (finishing a fine step first), ends the move and fires the completion callback.
+// The request stays set until stepEngineClearStop(), so a stop that races
+// stepEngineStart() ends the new move on its first interrupt.
+void stepEngineStop() {
+  stopRequested = true;
+}
+
+void stepEngineClearStop() {
+  stopRequested = false;
+}
+
+void stepEngineOnComplete(void (*callback)()) {
+  completeCallback = callback;
+}
+
+bool stepEngineBusy() {
+  return engineBusy;
+}
+
+int stepEngineStepsDone() {
+  return stepsDone;
+}
+
+int stepEngineStepsTotal() {
+  return activeMove.steps;
+}
+
+// Progress in fine microsteps, the unit of the motor position
+long stepEngineMicrostepsDone() {
+  return (long)stepsDone * MICROSTEPS_PER_STEP + microPhase;
+}
+
+bool stepEngineClockwise() {
+  return activeMove.clockwise;
+}
+
+bool stepEngineFineMode() {
+  return fineMode;
+}
+
+// ========================================
+// HOST-SIDE TIMER STAND-IN
+// ========================================
+
+#ifndef ARDUINO
+
+void stepEngineHostAdvance(uint64_t microseconds) {
+  uint64_t target = hostNow + microseconds;
+  while (hostAlarmArmed && hostNextAlarm <= target) {
+    hostNow = hostNextAlarm;
+    hostAlarmArmed = false;
+    onStepTimer();
+  }
+  hostNow = target;
+}
+
+uint64_t stepEngineHostNow() {
+  return hostNow;
+}
+
+uint32_t stepEngineHostPulseCount() {
+  return hostPulseCount;
+}
+
+uint32_t stepEngineHostFinePulseCount() {
+  return hostFinePulseCount;
+}
+
+uint64_t stepEngineHostFirstPulseTime() {
+  return hostFirstPulse;
+}
+
+uint64_t stepEngineHostLastPulseTime() {
+  return hostLastPulse;
+}
+
+void stepEngineHostReset() {
+  stopTimer();
+  engineBusy = false;
+  stopRequested = false;
+  microPhase = 0;
+  fineMode = false;
+  hostNow = 0;
+  hostNextAlarm = 0;
+  hostPulseCount = 0;
+  hostFinePulseCount = 0;
+  hostFirstPulse = 0;
+  hostLastPulse = 0;
+}
+
+#endif
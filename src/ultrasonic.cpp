@@ -0,0 +1,419 @@
+// ultrasonic.cpp
+// RCWL-9620 measurement state machine for Smart Pet Feeder
+// Splits each I2C distance measurement into non-blocking phases
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include "i2c_bus.h"
+#endif
+#include "config.h"
+#include "ultrasonic.h"
+
+// RCWL-9620 protocol
+const uint8_t ULTRASONIC_TRIGGER_CMD = 0x01;
+const int ULTRASONIC_RESULT_BYTES = 3;        // High, low, checksum
+const uint32_t ULTRASONIC_CONVERSION_US = SENSOR_CONVERSION_TIME * 1000UL;
+
+// Measurement in flight, one per sensor
+struct ChannelState {
+  UltrasonicPhase phase;
+  uint8_t resultBytes[ULTRASONIC_RESULT_BYTES];
+  int resultCount;
+  uint8_t triggerError;     // Wire error of the trigger (0 = ACK)
+  uint8_t fetchError;       // Wire error of the read (0 = all bytes)
+  uint8_t retries;          // Bus retries spent on this measurement
+  bool triggerPending;      // Trigger transaction not finished yet
+  bool busFull;             // Trigger refused by the bus queue
+  uint32_t triggerSentUs;   // Bus timestamps: trigger written (the sensor starts measuring)...
+  uint32_t fetchDoneUs;     // ...and result read
+};
+static ChannelState channels[ULTRASONIC_CHANNELS] = {};
+static UltrasonicHealth health[ULTRASONIC_CHANNELS] = {};
+
+// ========================================
+// PLATFORM LAYER
+// ========================================
+
+#ifdef ARDUINO
+
+// Transactions go through the I2C bus manager task; the phases below
+// only submit them and poll for completion.
+static const uint8_t channelAddress[ULTRASONIC_CHANNELS] = {ULTRASONIC_ADDR, HOPPER_SENSOR_ADDR};
+static I2CTransaction triggerTxn[ULTRASONIC_CHANNELS];
+static I2CTransaction fetchTxn[ULTRASONIC_CHANNELS];
+
+static bool busStartTrigger(UltrasonicChannel channel, uint32_t nowUs) {
+  (void)nowUs;
+  I2CTransaction& txn = triggerTxn[channel];
+  txn.address = channelAddress[channel];
+  txn.writeLength = 1;
+  txn.writeData[0] = ULTRASONIC_TRIGGER_CMD;
+  txn.readLength = 0;
+  return i2cSubmit(txn);
+}
+
+// True once the trigger has been sent; error is the Wire code (0 = ACK),
+// sentUs when the bus task finished writing it
+static bool busTriggerDone(UltrasonicChannel channel, uint32_t nowUs, uint8_t& error, uint8_t& retries,
+                           uint32_t& sentUs) {
+  (void)nowUs;
+  I2CTransaction& txn = triggerTxn[channel];
+  if (txn.state != I2C_DONE) {
+    return false;
+  }
+  error = txn.error;
+  retries += txn.attempts - 1;
+  sentUs = txn.doneUs;
+  txn.state = I2C_IDLE;
+  return true;
+}
+
+static bool busStartFetch(UltrasonicChannel channel, uint32_t nowUs) {
+  (void)nowUs;
+  I2CTransaction& txn = fetchTxn[channel];
+  txn.address = channelAddress[channel];
+  txn.writeLength = 0;
+  txn.readLength = ULTRASONIC_RESULT_BYTES;
+  return i2cSubmit(txn);
+}
+
+// True once the read has finished; count is how many bytes arrived,
+// doneUs when the bus task finished reading them
+static bool busFetchDone(UltrasonicChannel channel, uint32_t nowUs, uint8_t* buffer, int& count,
+                         uint8_t& error, uint8_t& retries, uint32_t& doneUs) {
+  (void)nowUs;
+  I2CTransaction& txn = fetchTxn[channel];
+  if (txn.state != I2C_DONE) {
+    return false;
+  }
+  error = txn.error;
+  retries += txn.attempts - 1;
+  doneUs = txn.doneUs;
+  count = txn.bytesRead;
+  for (int i = 0; i < count; i++) {
+    buffer[i] = txn.readData[i];
+  }
+  txn.state = I2C_IDLE;
+  return true;
+}
+
+#else
+
+// Simulated RCWL-9620s: the measurement is taken at the trigger and only
+// becomes readable once the conversion time has passed. The bus finishes
+// each transaction busDelayUs after it was queued (default: at once).
+struct HostSensor {
+  float distance;
+  uint32_t conversionUs;    // 0 = not set up yet
+  uint32_t busDelayUs;
+  bool corruptChecksum;
+  bool busFull;             // Submissions refused, like a full bus queue
+  uint8_t failNext;
+  uint8_t triggerError;
+  uint16_t pendingMm;
+  uint16_t readyMm;
+  uint32_t triggerQueued;
+  uint32_t triggerTime;     // Trigger reaches the sensor
+  uint32_t fetchQueued;
+  uint32_t fetchTime;       // Result read from the sensor
+  bool converting;
+  uint32_t earlyFetches;
+  uint32_t transactions;
+};
+static HostSensor hostSensors[ULTRASONIC_CHANNELS];
+
+static HostSensor& hostSensor(UltrasonicChannel channel) {
+  HostSensor& sensor = hostSensors[channel];
+  if (sensor.conversionUs == 0) {
+    sensor = {};
+    sensor.distance = 20.0f;
+    sensor.conversionUs = ULTRASONIC_CONVERSION_US;
+  }
+  return sensor;
+}
+
+static bool busStartTrigger(UltrasonicChannel channel, uint32_t nowUs) {
+  HostSensor& sensor = hostSensor(channel);
+  if (sensor.busFull) {
+    return false;
+  }
+  sensor.transactions++;
+  sensor.triggerError = sensor.failNext;
+  sensor.failNext = 0;
+  sensor.triggerQueued = nowUs;
+  sensor.triggerTime = nowUs + sensor.busDelayUs;
+  if (sensor.triggerError == 0) {
+    sensor.pendingMm = (uint16_t)(sensor.distance * 10.0f + 0.5f);
+    sensor.converting = true;
+  }
+  return true;
+}
+
+static bool busTriggerDone(UltrasonicChannel channel, uint32_t nowUs, uint8_t& error, uint8_t& retries,
+                           uint32_t& sentUs) {
+  (void)retries;
+  HostSensor& sensor = hostSensor(channel);
+  if (nowUs - sensor.triggerQueued < sensor.busDelayUs) {
+    return false;
+  }
+  error = sensor.triggerError;
+  sentUs = sensor.triggerTime;
+  return true;
+}
+
+static bool busStartFetch(UltrasonicChannel channel, uint32_t nowUs) {
+  HostSensor& sensor = hostSensor(channel);
+  if (sensor.busFull) {
+    return false;
+  }
+  sensor.transactions++;
+  sensor.fetchQueued = nowUs;
+  sensor.fetchTime = nowUs + sensor.busDelayUs;
+  return true;
+}
+
+static bool busFetchDone(UltrasonicChannel channel, uint32_t nowUs, uint8_t* buffer, int& count,
+                         uint8_t& error, uint8_t& retries, uint32_t& doneUs) {
+  (void)retries;
+  HostSensor& sensor = hostSensor(channel);
+  if (nowUs - sensor.fetchQueued < sensor.busDelayUs) {
+    return false;
+  }
+  error = 0;
+  doneUs = sensor.fetchTime;
+  if (sensor.converting) {
+    if (sensor.fetchTime - sensor.triggerTime >= sensor.conversionUs) {
+      sensor.readyMm = sensor.pendingMm;
+      sensor.converting = false;
+    } else {
+      sensor.earlyFetches++; // Sensor still busy: previous result is returned
+    }
+  }
+  uint8_t high = sensor.readyMm >> 8;
+  uint8_t low = sensor.readyMm & 0xFF;
+  uint8_t bytes[ULTRASONIC_RESULT_BYTES] = {high, low, (uint8_t)((high + low) ^ (sensor.corruptChecksum ? 0x5A : 0))};
+  count = ULTRASONIC_RESULT_BYTES;
+  for (int i = 0; i < count; i++) {
+    buffer[i] = bytes[i];
+  }
+  return true;
+}
+
+#endif
+
+// ========================================
+// STATE MACHINE
+// ========================================
+
+static void validateResult(const ChannelState& state, UltrasonicSample& sample) {
+  if (state.resultCount < ULTRASONIC_RESULT_BYTES) {
+    sample.result = ULTRASONIC_SHORT_READ;
+    return;
+  }
+
+  uint8_t highByte = state.resultBytes[0];
+  uint8_t lowByte = state.resultBytes[1];
+  uint16_t distanceMm = (highByte << 8) | lowByte;
+  sample.distanceCm = distanceMm / 10.0f;
+
+  // RCWL-9620 checksum: sum of high and low bytes
+  sample.checksumReceived = state.resultBytes[2];
+  sample.checksumCalculated = (highByte + lowByte) & 0xFF;
+  sample.checksumOk = (sample.checksumReceived == sample.checksumCalculated);
+
+  if (sample.distanceCm > 0 && sample.distanceCm < 500) {
+    sample.result = ULTRASONIC_OK;
+  } else {
+    sample.result = ULTRASONIC_OUT_OF_RANGE;
+  }
+}
+
+static void recordHealth(UltrasonicHealth& counters, const ChannelState& state,
+                         const UltrasonicSample& sample) {
+  counters.cycles++;
+  counters.retries += state.retries;
+  if (state.busFull) counters.busFull++;
+  uint8_t error = (state.triggerError != 0) ? state.triggerError : state.fetchError;
+  if (error != 0) {
+    counters.i2cErrors[error < ULTRASONIC_I2C_ERROR_CODES ? error : ULTRASONIC_I2C_ERROR_CODES - 1]++;
+  }
+
+  switch (sample.result) {
+    case ULTRASONIC_OK:
+      if (sample.checksumOk) {
+        counters.goodReads++;
+      } else {
+        counters.checksumErrors++;
+      }
+      break;
+    case ULTRASONIC_OUT_OF_RANGE:
+      counters.outOfRange++;
+      break;
+    case ULTRASONIC_SHORT_READ:
+      counters.shortReads++;
+      break;
+    case ULTRASONIC_WRITE_ERROR:
+    default:
+      break;
+  }
+
+  // Latency only means something for cycles that reached the sensor data
+  if (sample.result == ULTRASONIC_OK || sample.result == ULTRASONIC_OUT_OF_RANGE) {
+    uint32_t latencyMs = sample.latencyUs / 1000;
+    int bucket = 0;
+    while (bucket < ULTRASONIC_LATENCY_BUCKETS - 1 && latencyMs >= ULTRASONIC_LATENCY_BOUNDS_MS[bucket]) {
+      bucket++;
+    }
+    counters.latency[bucket]++;
+    if (sample.latencyUs > counters.latencyMaxUs) counters.latencyMaxUs = sample.latencyUs;
+  }
+}
+
+// Send the trigger. Returns false if a measurement is already in flight.
+// A trigger the sensor does not acknowledge, or the bus queue cannot take,
+// completes the cycle with ULTRASONIC_WRITE_ERROR.
+bool ultrasonicStart(UltrasonicChannel channel, uint32_t nowUs) {
+  ChannelState& state = channels[channel];
+  if (state.phase != ULTRASONIC_IDLE) {
+    return false;
+  }
+
+  state.resultCount = 0;
+  state.triggerError = 0;
+  state.fetchError = 0;
+  state.retries = 0;
+  state.triggerSentUs = nowUs;
+  state.fetchDoneUs = nowUs;
+  state.triggerPending = busStartTrigger(channel, nowUs);
+  state.busFull = !state.triggerPending;
+  if (state.busFull) {
+    state.phase = ULTRASONIC_VALIDATE;
+    return true;
+  }
+  state.phase = ULTRASONIC_CONVERTING;
+  return true;
+}
+
+// Advance the measurement. Returns true (and fills sample) when a cycle
+// has completed. Never waits: each phase only checks whether its bus
+// transaction or the conversion time is done.
+bool ultrasonicUpdate(UltrasonicChannel channel, uint32_t nowUs, UltrasonicSample& sample) {
+  ChannelState& state = channels[channel];
+  if (state.phase == ULTRASONIC_IDLE) {
+    return false;
+  }
+
+  if (state.phase == ULTRASONIC_CONVERTING) {
+    if (state.triggerPending) {
+      if (!busTriggerDone(channel, nowUs, state.triggerError, state.retries, state.triggerSentUs)) {
+        return false;
+      }
+      state.triggerPending = false;
+    }
+    if (state.triggerError != 0) {
+      state.phase = ULTRASONIC_VALIDATE;
+    } else if (nowUs - state.triggerSentUs < ULTRASONIC_CONVERSION_US) {
+      return false;
+    } else if (busStartFetch(channel, nowUs)) {
+      state.phase = ULTRASONIC_FETCH;
+    } else {
+      health[channel].busFull++;
+      return false; // Bus queue full: try the fetch again next call
+    }
+  }
+
+  if (state.phase == ULTRASONIC_FETCH) {
+    if (!busFetchDone(channel, nowUs, state.resultBytes, state.resultCount, state.fetchError, state.retries,
+                      state.fetchDoneUs)) {
+      return false;
+    }
+    state.phase = ULTRASONIC_VALIDATE;
+  }
+
+  sample.result = ULTRASONIC_OK;
+  sample.distanceCm = -1.0f;
+  sample.checksumOk = false;
+  sample.checksumReceived = 0;
+  sample.checksumCalculated = 0;
+  sample.i2cError = state.triggerError;
+  sample.busFull = state.busFull;
+  sample.bytesRead = state.resultCount;
+  sample.triggerTimeUs = state.triggerSentUs;
+
+  if (state.triggerError != 0 || state.busFull) {
+    sample.result = ULTRASONIC_WRITE_ERROR;
+  } else {
+    validateResult(state, sample);
+  }
+
+  // From the bus timestamps, so the time until this call noticed the
+  // result (loop() cadence, bus queue) is not counted as sensor latency
+  sample.latencyUs = state.fetchDoneUs - state.triggerSentUs;
+  state.phase = ULTRASONIC_IDLE;
+  recordHealth(health[channel], state, sample);
+  return true;
+}
+
+UltrasonicPhase ultrasonicPhase(UltrasonicChannel channel) {
+  return channels[channel].phase;
+}
+
+bool ultrasonicBusy(UltrasonicChannel channel) {
+  return channels[channel].phase != ULTRASONIC_IDLE;
+}
+
+const UltrasonicHealth& ultrasonicHealth(UltrasonicChannel channel) {
+  return health[channel];
+}
+
+void ultrasonicResetHealth(UltrasonicChannel channel) {
+  health[channel] = {};
+}
+
+// ========================================
+// HOST-SIDE SENSOR STAND-IN
+// ========================================
+
+#ifndef ARDUINO
+
+void ultrasonicHostSetDistance(UltrasonicChannel channel, float distanceCm) {
+  hostSensor(channel).distance = distanceCm;
+}
+
+void ultrasonicHostSetConversionTime(UltrasonicChannel channel, uint32_t microseconds) {
+  hostSensor(channel).conversionUs = microseconds;
+}
+
+void ultrasonicHostCorruptChecksum(UltrasonicChannel channel, bool corrupt) {
+  hostSensor(channel).corruptChecksum = corrupt;
+}
+
+void ultrasonicHostFailNextTrigger(UltrasonicChannel channel, uint8_t error) {
+  hostSensor(channel).failNext = error;
+}
+
+void ultrasonicHostBusFull(UltrasonicChannel channel, bool full) {
+  hostSensor(channel).busFull = full;
+}
+
+void ultrasonicHostSetBusDelay(UltrasonicChannel channel, uint32_t microseconds) {
+  hostSensor(channel).busDelayUs = microseconds;
+}
+
+uint32_t ultrasonicHostEarlyFetches(UltrasonicChannel channel) {
+  return hostSensor(channel).earlyFetches;
+}
+
+uint32_t ultrasonicHostTransactions(UltrasonicChannel channel) {
+  return hostSensor(channel).transactions;
+}
+
+void ultrasonicHostReset() {
+  for (int i = 0; i < ULTRASONIC_CHANNELS; i++) {
+    channels[i] = {};
+    health[i] = {};
+    hostSensors[i] = {};
+  }
+}
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// ========================================
+// HOST ARDUINO STAND-IN
+// ========================================
+// Just enough of the Arduino core to run the sensor modules (sensor.cpp,
+// bowl_model.cpp, eating_monitor.cpp) in the native tests. The clock only
+// moves when a test advances it or the code under test calls delay().
+// Serial prints to stdout, or into a string while a capture is set.
+// Only on the include path of the native environment (-I test/host).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+using std::min;
+using std::max;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// Simulated clock
+inline uint64_t hostTimeUs = 0;
+
+inline void hostAdvanceMs(unsigned long ms) { hostTimeUs += (uint64_t)ms * 1000; }
+inline unsigned long millis() { return (unsigned long)(hostTimeUs / 1000); }
+inline unsigned long micros() { return (unsigned long)hostTimeUs; }
+inline void delay(unsigned long ms) { hostAdvanceMs(ms); }
+inline void delayMicroseconds(unsigned int us) { hostTimeUs += us; }
+
+// GPIO and buzzer PWM do nothing
+inline void pinMode(int, int) {}
+inline void digitalWrite(int, int) {}
+inline int digitalRead(int) { return HIGH; }
+inline void ledcSetup(int, int, int) {}
+inline void ledcAttachPin(int, int) {}
+inline void ledcWrite(int, int) {}
+inline void ledcDetachPin(int) {}
+
+inline void* ps_malloc(size_t size) { return malloc(size); }
+
+#define SERIAL_8N1 0
+
+class String {
+public:
+  String(const char* text = "") : value(text) {}
+  explicit String(unsigned long number) : value(std::to_string(number)) {}
+  const char* c_str() const { return value.c_str(); }
+  unsigned int length() const { return value.length(); }
+  bool startsWith(const char* prefix) const { return value.rfind(prefix, 0) == 0; }
+  String substring(unsigned int from) const { return String(value.substr(from).c_str()); }
+  String operator+(const String& other) const { return String((value + other.value).c_str()); }
+  friend String operator+(const char* text, const String& other) { return String(text) + other; }
+  String& operator+=(const String& other) { value += other.value; return *this; }
+  String& operator+=(const char* text) { value += text; return *this; }
+private:
+  std::string value;
+};
+
+class HardwareSerial {
+public:
+  explicit HardwareSerial(int) {}
+  void begin(unsigned long, int = 0, int = -1, int = -1) {}
+  int available() { return 0; }
+  int read() { return -1; }
+  float parseFloat() { return 0.0f; }
+  long parseInt() { return 0; }
+
+  int printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    char text[512];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    print(text);
+    return length;
+  }
+  void print(const char* text) {
+    if (capture != nullptr) {
+      capture->append(text);
+    } else {
+      fputs(text, stdout);
+    }
+  }
+  void print(char c) { char text[2] = {c, 0}; print(text); }
+  void println(const char* text = "") { print(text); print("\n"); }
+  void println(const String& text) { println(text.c_str()); }
+
+  std::string* capture = nullptr;   // Collects the output instead of printing it
+};
+
+inline HardwareSerial Serial(0);
+
+struct EspClass {
+  uint32_t getFreeHeap() { return 0; }
+  uint32_t getFreePsram() { return 0; }
+  uint32_t getPsramSize() { return 0; }
+};
+inline EspClass ESP;
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,7 @@
+#ifndef HOST_HARDWARE_SERIAL_H
+#define HOST_HARDWARE_SERIAL_H
+
+// HardwareSerial lives in the host Arduino.h stand-in
+#include "Arduino.h"
+
+#endif // HOST_HARDWARE_SERIAL_H
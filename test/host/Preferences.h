@@ -0,0 +1,48 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+// ========================================
+// HOST PREFERENCES STAND-IN
+// ========================================
+// NVS replaced by an in-memory key store that lasts for the test run
+
+#include <map>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+
+class Preferences {
+public:
+  bool begin(const char* name, bool readOnly = false) {
+    space = name;
+    return true;
+  }
+  void end() {}
+
+  size_t putBytes(const char* key, const void* value, size_t length) {
+    const uint8_t* bytes = (const uint8_t*)value;
+    store()[space + "/" + key].assign(bytes, bytes + length);
+    return length;
+  }
+  size_t getBytes(const char* key, void* buffer, size_t maxLength) {
+    auto entry = store().find(space + "/" + key);
+    if (entry == store().end()) return 0;
+    size_t length = std::min(maxLength, entry->second.size());
+    memcpy(buffer, entry->second.data(), length);
+    return length;
+  }
+  size_t getBytesLength(const char* key) {
+    auto entry = store().find(space + "/" + key);
+    return entry == store().end() ? 0 : entry->second.size();
+  }
+  bool remove(const char* key) { return store().erase(space + "/" + key) > 0; }
+
+private:
+  static std::map<std::string, std::vector<uint8_t>>& store() {
+    static std::map<std::string, std::vector<uint8_t>> values;
+    return values;
+  }
+  std::string space;
+};
+
+#endif // HOST_PREFERENCES_H
@@ -0,0 +1,79 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+// ========================================
+// HOST WIRE STAND-IN
+// ========================================
+// An I2C bus with the devices a test attaches. An address nobody attached
+// NACKs like an empty bus; attached devices ACK and answer reads with
+// their reply bytes. Every START is counted.
+
+#include "Arduino.h"
+
+const int HOST_WIRE_DEVICES = 8;
+const int HOST_WIRE_REPLY = 8;
+
+class TwoWire {
+public:
+  bool begin(int sda = -1, int scl = -1) { return true; }
+  void end() {}
+  void setClock(uint32_t frequency) {}
+  void setTimeout(uint16_t timeoutMs) {}
+
+  void beginTransmission(uint8_t address) {
+    target = address;
+    starts++;
+  }
+  size_t write(const uint8_t* data, size_t length) { return length; }
+  uint8_t endTransmission() { return find(target) != nullptr ? 0 : 2; }   // 2 = NACK on address
+
+  uint8_t requestFrom(uint8_t address, uint8_t length) {
+    starts++;
+    received = 0;
+    readIndex = 0;
+    Device* device = find(address);
+    if (device == nullptr) return 0;
+    received = std::min((int)length, device->replyLength);
+    memcpy(rxBuffer, device->reply, received);
+    return received;
+  }
+  int available() { return received - readIndex; }
+  int read() { return readIndex < received ? rxBuffer[readIndex++] : -1; }
+
+  // Test side
+  void hostAttach(uint8_t address, const uint8_t* reply = nullptr, int replyLength = 0) {
+    for (Device& device : devices) {
+      if (device.address == 0) {
+        device.address = address;
+        device.replyLength = std::min(replyLength, HOST_WIRE_REPLY);
+        if (reply != nullptr) memcpy(device.reply, reply, device.replyLength);
+        return;
+      }
+    }
+  }
+  void hostReset() { *this = TwoWire(); }
+
+  uint32_t starts = 0;   // beginTransmission() and requestFrom() calls
+
+private:
+  struct Device {
+    uint8_t address;
+    uint8_t reply[HOST_WIRE_REPLY];
+    int replyLength;
+  };
+  Device* find(uint8_t address) {
+    for (Device& device : devices) {
+      if (device.address == address && address != 0) return &device;
+    }
+    return nullptr;
+  }
+  Device devices[HOST_WIRE_DEVICES] = {};
+  uint8_t target = 0;
+  uint8_t rxBuffer[HOST_WIRE_REPLY] = {};
+  int received = 0;
+  int readIndex = 0;
+};
+
+inline TwoWire Wire;
+
+#endif // HOST_WIRE_H
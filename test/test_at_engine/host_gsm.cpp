@@ -0,0 +1,2 @@
+// Built from src/ for this suite only: gsm.cpp needs the Arduino stand-in in test/host
+#include "../../src/gsm.cpp"
@@ -0,0 +1,251 @@
+// test_at_engine.cpp
+// Host tests for the AT command engine (at_engine.h) on the fake SIM800L
+// Command log, callback results, the SMS prompt and chunked body, errors, URCs and the gsm.cpp SMS pipeline
+
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include <Arduino.h>
+#include "config.h"
+#include "at_engine.h"
+#include "gsm.h"
+
+// SMS results kept by gsm.cpp
+extern unsigned long smsSentCount;
+extern unsigned long smsFailedCount;
+extern int lastSMSReference;
+
+// Last completion seen by recordResult()
+static int callbacks = 0;
+static ATResult lastResult = AT_CANCELLED;
+static char lastResponse[AT_RESPONSE_LENGTH + 1];
+static unsigned long lastDoneMs = 0;
+static unsigned long nowMs = 0;
+
+static void recordResult(ATResult result, const char* response, void* context) {
+  callbacks++;
+  lastResult = result;
+  strncpy(lastResponse, response, sizeof(lastResponse) - 1);
+  lastDoneMs = nowMs;
+}
+
+static char urcLines[4][AT_LINE_LENGTH];
+static int urcCount = 0;
+
+static void recordURC(const char* line) {
+  if (urcCount < 4) strcpy(urcLines[urcCount], line);
+  urcCount++;
+}
+
+// Runs the engine one millisecond per update until the callback count
+// reaches target (or limitMs passes)
+static void runUntil(int target, unsigned long limitMs) {
+  unsigned long end = nowMs + limitMs;
+  while (callbacks < target && nowMs < end) {
+    atEngineUpdate(++nowMs);
+  }
+}
+
+void setUp() {
+  atHostModemReset();
+  callbacks = 0;
+  lastResponse[0] = '\0';
+  urcCount = 0;
+}
+
+void tearDown() {}
+
+void test_commands_in_order() {
+  atHostModemRespond("ATE0", "\r\nOK\r\n", 30);
+  atHostModemRespond("AT+CREG?", "\r\n+CREG: 0,1\r\n\r\nOK\r\n", 20);
+  atOnURC("+CREG:", recordURC);
+
+  unsigned long start = nowMs;
+  TEST_ASSERT_TRUE(atSubmit("ATE0", "OK", 2000, recordResult));
+  TEST_ASSERT_TRUE(atSubmit("AT+CREG?", "OK", GSM_AT_TIMEOUT, recordResult));
+  TEST_ASSERT_EQUAL_INT(2, atEnginePending());
+
+  // Nothing waits: the second command goes out in the update that
+  // completes the first
+  runUntil(1, 1000);
+  TEST_ASSERT_EQUAL_INT(AT_OK, lastResult);
+  TEST_ASSERT_EQUAL_STRING("OK\n", lastResponse);
+  TEST_ASSERT_GREATER_OR_EQUAL(start + 30, lastDoneMs);
+  TEST_ASSERT_EQUAL_INT(2, atHostModemCommandCount());
+
+  runUntil(2, 1000);
+  TEST_ASSERT_EQUAL_INT(AT_OK, lastResult);
+  TEST_ASSERT_EQUAL_STRING("+CREG: 0,1\nOK\n", lastResponse);
+  TEST_ASSERT_EQUAL_INT(0, urcCount);   // The answer is not a URC
+  TEST_ASSERT_FALSE(atEngineBusy());
+
+  TEST_ASSERT_EQUAL_INT(2, atHostModemCommandCount());
+  TEST_ASSERT_EQUAL_STRING("ATE0", atHostModemCommand(0));
+  TEST_ASSERT_EQUAL_STRING("AT+CREG?", atHostModemCommand(1));
+}
+
+static const char* SMS_BODY =
+    "Smart Pet Feeder: Auto-fed CAT (~30g, bowl had 0g) - Daily feeds: 1/8. "
+    "This line is long enough to need several UART writes of AT_TX_BUDGET bytes.";
+
+// Queued from the prompt callback, like gsm.cpp's pipeline
+static void onPrompt(ATResult result, const char* response, void* context) {
+  recordResult(result, response, context);
+  if (result == AT_OK) {
+    int* writesBefore = (int*)context;
+    *writesBefore = atHostModemWrites();
+    atSubmitData(SMS_BODY, "OK", SMS_SEND_TIMEOUT, recordResult);
+  }
+}
+
+void test_sms_prompt_and_chunked_body() {
+  atHostModemRespond("AT+CMGS=", "\r\n> ", 50);
+  atHostModemRespond("Smart Pet Feeder", "\r\n+CMGS: 12\r\n\r\nOK\r\n", 3000);
+
+  int writesBefore = 0;
+  TEST_ASSERT_TRUE(atSubmit("AT+CMGS=\"+639291145133\"", "> ", GSM_AT_TIMEOUT, onPrompt, &writesBefore));
+  runUntil(1, 1000);
+  TEST_ASSERT_EQUAL_INT(AT_OK, lastResult);   // "> " without a line end
+
+  runUntil(2, SMS_SEND_TIMEOUT);
+  TEST_ASSERT_EQUAL_INT(AT_OK, lastResult);
+  TEST_ASSERT_EQUAL_STRING("+CMGS: 12\nOK\n", lastResponse);
+
+  // Body plus Ctrl+Z, at most AT_TX_BUDGET bytes per update
+  int bodyBytes = strlen(SMS_BODY) + 1;
+  TEST_ASSERT_EQUAL_INT((bodyBytes + AT_TX_BUDGET - 1) / AT_TX_BUDGET, atHostModemWrites() - writesBefore);
+  TEST_ASSERT_EQUAL_INT(2, atHostModemCommandCount());
+  TEST_ASSERT_EQUAL_STRING("AT+CMGS=\"+639291145133\"", atHostModemCommand(0));
+  TEST_ASSERT_EQUAL_STRING(SMS_BODY, atHostModemCommand(1));
+}
+
+void test_error_timeout_and_flush() {
+  atHostModemRespond("AT+SILENT", "", 0);
+
+  // Commands without a rule get ERROR, like unknown commands on the module
+  atSubmit("AT+BOGUS", "OK", 2000, recordResult);
+  runUntil(1, 1000);
+  TEST_ASSERT_EQUAL_INT(AT_ERROR, lastResult);
+  TEST_ASSERT_EQUAL_STRING("ERROR\n", lastResponse);
+
+  unsigned long start = nowMs;
+  atSubmit("AT+SILENT", "OK", 2000, recordResult);
+  runUntil(2, 5000);
+  TEST_ASSERT_EQUAL_INT(AT_TIMEOUT, lastResult);
+  TEST_ASSERT_GREATER_OR_EQUAL(start + 2000, lastDoneMs);
+
+  atSubmit("AT", "OK", 2000, recordResult);
+  atSubmit("AT", "OK", 2000, recordResult);
+  atEngineUpdate(++nowMs);
+  atEngineFlush();
+  TEST_ASSERT_EQUAL_INT(4, callbacks);
+  TEST_ASSERT_EQUAL_INT(AT_CANCELLED, lastResult);
+  TEST_ASSERT_FALSE(atEngineBusy());
+}
+
+void test_urc_dispatch() {
+  atHostModemRespond("AT+SILENT", "", 0);
+  atOnURC("+CMTI:", recordURC);
+  atOnURC("RING", recordURC);
+
+  // Pushed while a command waits: handled, and the command keeps waiting
+  atSubmit("AT+SILENT", "OK", 2000, recordResult);
+  atEngineUpdate(++nowMs);
+  atHostModemInject("\r\n+CMTI: \"SM\",3\r\n\r\nRING\r\n");
+  atEngineUpdate(++nowMs);
+  TEST_ASSERT_EQUAL_INT(2, urcCount);
+  TEST_ASSERT_EQUAL_STRING("+CMTI: \"SM\",3", urcLines[0]);
+  TEST_ASSERT_EQUAL_STRING("RING", urcLines[1]);
+  TEST_ASSERT_EQUAL_INT(0, callbacks);
+  TEST_ASSERT_TRUE(atEngineBusy());
+
+  // Lines nobody handles outside a command are only counted
+  atEngineFlush();
+  atHostModemInject("\r\n+CPIN: READY\r\n");
+  atEngineUpdate(++nowMs);
+  TEST_ASSERT_EQUAL_UINT32(2, atEngineStats().urcs);
+  TEST_ASSERT_EQUAL_UINT32(1, atEngineStats().unhandled);
+}
+
+// A UART that never takes a byte times the command out from the moment it
+// became active, and the queue moves on
+void test_stalled_uart_write_times_out() {
+  atHostModemRespond("AT", "\r\nOK\r\n", 10);
+  atHostModemStallTx(true);
+
+  unsigned long start = nowMs;
+  atSubmit("AT+CSQ", "OK", 2000, recordResult);
+  atSubmit("AT", "OK", 2000, recordResult);
+  runUntil(1, 5000);
+  TEST_ASSERT_EQUAL_INT(AT_TIMEOUT, lastResult);
+  TEST_ASSERT_LESS_OR_EQUAL(start + 2001, lastDoneMs);
+  TEST_ASSERT_GREATER_OR_EQUAL(start + 2000, lastDoneMs);
+  TEST_ASSERT_EQUAL_INT(0, atHostModemWrites());
+  TEST_ASSERT_EQUAL_UINT32(1, atEngineStats().writeTimeouts);
+
+  atHostModemStallTx(false);
+  runUntil(2, 1000);
+  TEST_ASSERT_EQUAL_INT(AT_OK, lastResult);
+  TEST_ASSERT_FALSE(atEngineBusy());
+}
+
+// gsm.cpp from reset to a sent alert: boot URC, ATE0 and the setup
+// commands, registration, text mode, then the AT+CMGS pipeline
+void test_gsm_sms_pipeline() {
+  atHostModemRespond("ATE0", "\r\nOK\r\n", 20);
+  atHostModemRespond("AT+CMGF=1", "\r\nOK\r\n", 10);
+  atHostModemRespond("AT+CREG=1", "\r\nOK\r\n", 10);
+  atHostModemRespond("AT+CNMI=", "\r\nOK\r\n", 10);
+  atHostModemRespond("AT+CSMP=", "\r\nOK\r\n", 10);
+  atHostModemRespond("AT+CREG?", "\r\n+CREG: 1,1\r\n\r\nOK\r\n", 10);
+  atHostModemRespond("AT+CMGS=", "\r\n> ", 50);
+  atHostModemRespond("🤖 Smart Pet Feeder: Auto-fed", "\r\n+CMGS: 42\r\n\r\nOK\r\n", 2000);
+
+  initializeGSM();
+  TEST_ASSERT_EQUAL_INT(GSM_INITIALIZING, getGSMStatus());
+  atHostModemInject("\r\nSMS Ready\r\n");   // Booted before GSM_BOOT_TIME
+
+  // One loop() per 10 ms
+  for (int i = 0; i < 3000 && !isGSMReady(); i++) {
+    hostAdvanceMs(10);
+    updateGSMStatus();
+  }
+  TEST_ASSERT_TRUE(isGSMReady());
+
+  sendSMSAlert(SMS_AUTO_FEED, "CAT (~30g, bowl had 0g) - Daily feeds: 1/8");
+  for (int i = 0; i < 1000 && smsSentCount == 0 && smsFailedCount == 0; i++) {
+    hostAdvanceMs(10);
+    updateGSMStatus();
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, smsSentCount);
+  TEST_ASSERT_EQUAL_UINT32(0, smsFailedCount);
+  TEST_ASSERT_EQUAL_INT(42, lastSMSReference);
+
+  const char* expected[] = {
+    "ATE0", "AT+CMGF=1", "AT+CREG=1", "AT+CNMI=2,1,0,1,0", "AT+CSMP=49,167,0,0",
+    "AT+CREG?", "AT+CMGF=1", "AT+CMGF=1", "AT+CMGS=\"+639291145133\""
+  };
+  const int expectedCount = sizeof(expected) / sizeof(expected[0]);
+  TEST_ASSERT_EQUAL_INT(expectedCount + 1, atHostModemCommandCount());
+  for (int i = 0; i < expectedCount; i++) {
+    TEST_ASSERT_EQUAL_STRING(expected[i], atHostModemCommand(i));
+  }
+  TEST_ASSERT_TRUE(strstr(atHostModemCommand(expectedCount), "Auto-fed CAT (~30g") != nullptr);
+
+  // Registration lost (URC) puts the module back to searching
+  atHostModemInject("\r\n+CREG: 0\r\n");
+  hostAdvanceMs(10);
+  updateGSMStatus();
+  TEST_ASSERT_EQUAL_INT(GSM_NETWORK_SEARCHING, getGSMStatus());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_commands_in_order);
+  RUN_TEST(test_sms_prompt_and_chunked_body);
+  RUN_TEST(test_error_timeout_and_flush);
+  RUN_TEST(test_urc_dispatch);
+  RUN_TEST(test_stalled_uart_write_times_out);
+  RUN_TEST(test_gsm_sms_pipeline);
+  return UNITY_END();
+}
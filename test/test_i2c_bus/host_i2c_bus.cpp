@@ -0,0 +1,37 @@
+// Built from src/ for this suite only: i2c_bus.cpp needs Wire and FreeRTOS.
+// Wire is the stand-in in test/host; FreeRTOS is reduced to what the bus
+// manager uses, with the bus task running each transaction the moment it
+// is queued, so a submit returns with the transaction already I2C_DONE.
+#include <Arduino.h>
+#include "i2c_bus.h"
+
+#define OUTPUT_OPEN_DRAIN 3
+
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+typedef void* QueueHandle_t;
+typedef int portMUX_TYPE;
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xFFFFFFFF
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(lock) ((void)(lock))
+#define portEXIT_CRITICAL(lock) ((void)(lock))
+
+static void executeTransaction(I2CTransaction& txn);
+static int hostQueue = 0;
+
+static QueueHandle_t xQueueCreate(int length, size_t itemSize) { return &hostQueue; }
+static BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t wait) {
+  executeTransaction(**(I2CTransaction* const*)item);
+  return pdTRUE;
+}
+static BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t wait) { return pdFALSE; }
+static BaseType_t xTaskCreatePinnedToCore(void (*task)(void*), const char* name, uint32_t stack,
+                                          void* parameter, int priority, TaskHandle_t* handle, int core) {
+  return pdPASS;
+}
+
+#include "../../src/i2c_bus.cpp"
@@ -0,0 +1,65 @@
+// test_i2c_bus.cpp
+// Host tests for the I2C bus manager (i2c_bus.h) on the Wire stand-in
+// Address probes, reads, and which errors are retried
+
+#include <stdio.h>
+#include <unity.h>
+#include <Arduino.h>
+#include <Wire.h>
+#include "config.h"
+#include "i2c_bus.h"
+
+const uint8_t PRESENT_ADDRESS = 0x57;
+const uint8_t MISSING_ADDRESS = 0x58;
+
+void setUp() {
+  Wire.hostReset();
+  initializeI2CBus();
+}
+
+void tearDown() {}
+
+// A probe is a real address-only write: the attached device ACKs, an
+// empty address NACKs, and both go out on the bus
+void test_probe_missing_address_nacks() {
+  Wire.hostAttach(PRESENT_ADDRESS);
+
+  TEST_ASSERT_TRUE(i2cProbe(PRESENT_ADDRESS));
+  TEST_ASSERT_EQUAL_UINT32(1, Wire.starts);
+  TEST_ASSERT_FALSE(i2cProbe(MISSING_ADDRESS));
+  TEST_ASSERT_EQUAL_UINT32(2, Wire.starts);
+
+  I2CDeviceStats stats;
+  TEST_ASSERT_TRUE(getI2CDeviceStats(MISSING_ADDRESS, stats));
+  TEST_ASSERT_EQUAL_UINT32(1, stats.errors[I2C_ERROR_NACK_ADDRESS]);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.retries);
+  TEST_ASSERT_EQUAL_UINT32(0, getI2CBusRecoveries());
+}
+
+// Write then read: the reply comes back, and a short one is reported
+void test_write_read_and_short_read() {
+  const uint8_t reply[] = {0x12, 0x34, 0x56};
+  Wire.hostAttach(PRESENT_ADDRESS, reply, sizeof(reply));
+
+  static I2CTransaction txn;
+  txn.address = PRESENT_ADDRESS;
+  txn.writeLength = 1;
+  txn.writeData[0] = 0x01;
+  txn.readLength = 3;
+  TEST_ASSERT_TRUE(i2cTransfer(txn));
+  TEST_ASSERT_EQUAL_INT(3, txn.bytesRead);
+  TEST_ASSERT_EQUAL_INT(0x56, txn.readData[2]);
+  TEST_ASSERT_EQUAL_INT(1, txn.attempts);
+
+  txn.state = I2C_IDLE;
+  txn.readLength = 4;
+  TEST_ASSERT_FALSE(i2cTransfer(txn));
+  TEST_ASSERT_EQUAL_INT(I2C_ERROR_SHORT_READ, txn.error);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_probe_missing_address_nacks);
+  RUN_TEST(test_write_read_and_short_read);
+  return UNITY_END();
+}
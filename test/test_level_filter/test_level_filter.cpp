@@ -0,0 +1,118 @@
+// test_level_filter.cpp
+// Host tests for the ultrasonic level filter (level_filter.h)
+// Median and EMA stages, outlier rejection, and when a run of outliers re-seeds the filter
+
+#include <stdio.h>
+#include <unity.h>
+#include "config.h"
+#include "level_filter.h"
+
+const uint16_t LEVEL_MM = 100;
+const uint16_t OUTLIER_MM = BOWL_FILTER_OUTLIER_MM;
+const int WINDOW = BOWL_FILTER_MEDIAN_WINDOW;
+
+static LevelFilter filter;
+
+static void fill(uint16_t levelMm) {
+  for (int i = 0; i < WINDOW; i++) {
+    TEST_ASSERT_TRUE(levelFilterAdd(filter, levelMm));
+  }
+}
+
+void setUp() {
+  levelFilterInit(filter);
+}
+
+void tearDown() {}
+
+void test_median_and_ema() {
+  TEST_ASSERT_FALSE(levelFilterReady(filter));
+  fill(LEVEL_MM);
+  TEST_ASSERT_TRUE(levelFilterReady(filter));
+  TEST_ASSERT_EQUAL_INT(LEVEL_MM, levelFilterValueMm(filter));
+
+  // Small changes pass the outlier stage; the median follows once they
+  // are the majority, the EMA closes in by 1/4 per sample
+  uint16_t stepMm = LEVEL_MM + OUTLIER_MM / 2;
+  levelFilterAdd(filter, stepMm);
+  levelFilterAdd(filter, stepMm);
+  TEST_ASSERT_EQUAL_INT(LEVEL_MM, levelFilterMedianMm(filter));
+  levelFilterAdd(filter, stepMm);
+  TEST_ASSERT_EQUAL_INT(stepMm, levelFilterMedianMm(filter));
+  TEST_ASSERT_EQUAL_INT(LEVEL_MM + (stepMm - LEVEL_MM) / 4, levelFilterValueMm(filter));
+  for (int i = 0; i < 30; i++) {
+    levelFilterAdd(filter, stepMm);
+  }
+  TEST_ASSERT_EQUAL_INT(stepMm, levelFilterValueMm(filter));
+  TEST_ASSERT_EQUAL_UINT32(0, filter.rejected);
+}
+
+void test_single_outlier_rejected() {
+  fill(LEVEL_MM);
+  TEST_ASSERT_FALSE(levelFilterAdd(filter, LEVEL_MM + 3 * OUTLIER_MM));
+  TEST_ASSERT_EQUAL_INT(LEVEL_MM + 3 * OUTLIER_MM, levelFilterRawMm(filter));
+  TEST_ASSERT_EQUAL_INT(LEVEL_MM, levelFilterValueMm(filter));
+  TEST_ASSERT_TRUE(levelFilterAdd(filter, LEVEL_MM));
+  TEST_ASSERT_EQUAL_UINT32(1, filter.rejected);
+}
+
+// A real level change: a window of outliers that agree with each other
+// replaces the history at once, EMA included
+void test_clustered_outliers_reseed() {
+  fill(LEVEL_MM);
+  const uint16_t newLevel = LEVEL_MM + 3 * OUTLIER_MM;
+  for (int i = 0; i < WINDOW - 1; i++) {
+    TEST_ASSERT_FALSE(levelFilterAdd(filter, newLevel + (i % 2) * OUTLIER_MM / 2));
+  }
+  TEST_ASSERT_EQUAL_INT(LEVEL_MM, levelFilterValueMm(filter));
+  TEST_ASSERT_TRUE(levelFilterAdd(filter, newLevel));
+  TEST_ASSERT_EQUAL_INT(newLevel, levelFilterMedianMm(filter));
+  TEST_ASSERT_EQUAL_INT(newLevel, levelFilterValueMm(filter));
+}
+
+// Bad echoes scattered on both sides of the level never add up to a
+// re-seed, however many arrive in a row
+void test_scattered_outliers_never_reseed() {
+  fill(LEVEL_MM);
+  const uint16_t echoes[] = {LEVEL_MM + 3 * OUTLIER_MM, LEVEL_MM + 6 * OUTLIER_MM, 10};
+  for (int i = 0; i < 10 * WINDOW; i++) {
+    TEST_ASSERT_FALSE(levelFilterAdd(filter, echoes[i % 3]));
+  }
+  TEST_ASSERT_EQUAL_INT(LEVEL_MM, levelFilterMedianMm(filter));
+  TEST_ASSERT_EQUAL_INT(LEVEL_MM, levelFilterValueMm(filter));
+  TEST_ASSERT_EQUAL_UINT32(10 * WINDOW, filter.rejected);
+}
+
+// An accepted sample ends the run: outliers must be consecutive
+void test_interrupted_run_starts_over() {
+  fill(LEVEL_MM);
+  const uint16_t newLevel = LEVEL_MM + 3 * OUTLIER_MM;
+  for (int i = 0; i < WINDOW - 1; i++) {
+    levelFilterAdd(filter, newLevel);
+  }
+  TEST_ASSERT_TRUE(levelFilterAdd(filter, LEVEL_MM));
+  for (int i = 0; i < WINDOW - 1; i++) {
+    TEST_ASSERT_FALSE(levelFilterAdd(filter, newLevel));
+  }
+  TEST_ASSERT_EQUAL_INT(LEVEL_MM, levelFilterMedianMm(filter));
+}
+
+// Stages switched off in the config pass samples straight through
+void test_stages_off() {
+  const LevelFilterConfig passThrough = {1, 0, 0};
+  levelFilterInit(filter, passThrough);
+  levelFilterAdd(filter, LEVEL_MM);
+  TEST_ASSERT_TRUE(levelFilterAdd(filter, LEVEL_MM + 10 * OUTLIER_MM));
+  TEST_ASSERT_EQUAL_INT(LEVEL_MM + 10 * OUTLIER_MM, levelFilterValueMm(filter));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_median_and_ema);
+  RUN_TEST(test_single_outlier_rejected);
+  RUN_TEST(test_clustered_outliers_reseed);
+  RUN_TEST(test_scattered_outliers_never_reseed);
+  RUN_TEST(test_interrupted_run_starts_over);
+  RUN_TEST(test_stages_off);
+  return UNITY_END();
+}
@@ -0,0 +1,162 @@
+// test_motion_profile.cpp
+// Host tests for the compile-time ramp tables (motion_profile.h)
+// Dispense time of the feeding portions: linear-delay (old) vs ramp tables,
+// and the velocity/time curve of each profile type as the step engine clocks it
+
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+#include "config.h"
+#include "motion_profile.h"
+#include "step_engine.h"
+
+const int PORTIONS[] = {CAT_MIN_PORTION, CAT_MAX_PORTION, DOG_MIN_PORTION, DOG_MAX_PORTION};
+const char* PORTION_NAMES[] = {"CAT min", "CAT max", "DOG min", "DOG max"};
+const int PORTION_COUNT = 4;
+
+// Default-speed profile as buildStepProfile() hands it to the step engine
+static StepProfile defaultProfile(MotionProfileType type) {
+  StepProfile profile;
+  if (type == PROFILE_SCURVE) {
+    profile.rampTable = DefaultSCurve::table.data();
+    profile.rampSteps = DefaultSCurve::length;
+    profile.cruiseDelay = DefaultSCurve::cruiseDelay;
+  } else {
+    profile.rampTable = DefaultRamp::table.data();
+    profile.rampSteps = DefaultRamp::length;
+    profile.cruiseDelay = DefaultRamp::cruiseDelay;
+  }
+  return profile;
+}
+
+// Result of clocking one move through stepEngineInterval()
+struct ProfileRun {
+  uint64_t totalUs;
+  double firstAccel;  // Steps/s^2 between the first two steps
+  double maxAccel;
+  double maxJerk;     // Steps/s^3, largest change of acceleration per second
+};
+
+// Same walk as printProfileSimulation(); prints a CSV row every sampleEvery steps
+static ProfileRun simulateProfile(MotionProfileType type, const char* name, int steps, int sampleEvery) {
+  StepMove move;
+  move.steps = steps;
+  move.clockwise = true;
+  move.fineSteps = 0;
+  move.profile = defaultProfile(type);
+
+  ProfileRun run = {0, 0.0, 0.0, 0.0};
+  double lastSpeed = 0.0;
+  double lastAccel = 0.0;
+  for (int i = 0; i < steps; i++) {
+    uint32_t interval = stepEngineInterval(move, i);
+    double seconds = interval / 1e6;
+    double speed = 1.0 / seconds;
+    if (i % sampleEvery == 0 || i == steps - 1) {
+      printf("%s,%d,%.4f,%.1f\n", name, i, run.totalUs / 1e6, speed);
+    }
+    if (i > 0) {
+      double accel = (speed - lastSpeed) / seconds;
+      if (i == 1) run.firstAccel = accel;
+      if (fabs(accel) > run.maxAccel) run.maxAccel = fabs(accel);
+      if (i > 1 && fabs(accel - lastAccel) / seconds > run.maxJerk) {
+        run.maxJerk = fabs(accel - lastAccel) / seconds;
+      }
+      lastAccel = accel;
+    }
+    lastSpeed = speed;
+    run.totalUs += interval;
+  }
+  return run;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_ramp_table_accelerates_to_cruise() {
+  TEST_ASSERT_LESS_OR_EQUAL(1000000UL / MOTOR_START_SPEED, DefaultRamp::table[0]);
+  TEST_ASSERT_EQUAL_UINT32(1000000UL / MOTOR_SPEED, DefaultRamp::cruiseDelay);
+  for (int i = 1; i < DefaultRamp::length; i++) {
+    TEST_ASSERT_LESS_OR_EQUAL(DefaultRamp::table[i - 1], DefaultRamp::table[i]);
+  }
+  TEST_ASSERT_GREATER_OR_EQUAL(DefaultRamp::cruiseDelay, DefaultRamp::table[DefaultRamp::length - 1]);
+}
+
+// rampMoveDuration() is what the benchmark reports; the step engine must
+// clock exactly that (plus the DIR setup time)
+void test_ramp_duration_matches_step_engine() {
+  for (int i = 0; i < PORTION_COUNT; i++) {
+    StepMove move;
+    move.steps = PORTIONS[i];
+    move.clockwise = true;
+    move.fineSteps = 0;
+    move.profile = defaultProfile(PROFILE_TRAPEZOID);
+
+    uint64_t sum = 0;
+    for (int s = 0; s < move.steps; s++) {
+      sum += stepEngineInterval(move, s);
+    }
+    uint64_t rampUs = rampMoveDuration(PORTIONS[i], DefaultRamp::table.data(),
+                                       DefaultRamp::length, DefaultRamp::cruiseDelay);
+    TEST_ASSERT_EQUAL_UINT64(rampUs, sum);
+  }
+}
+
+// Old profile divided by steps / 4, which is zero for moves under 4 steps
+void test_legacy_profile_short_move() {
+  TEST_ASSERT_EQUAL_UINT64(0, legacyMoveDuration(3, MOTOR_SPEED, MOTOR_ACCELERATION, MAX_STEP_DELAY));
+  TEST_ASSERT_GREATER_THAN(0, rampMoveDuration(3, DefaultRamp::table.data(),
+                                               DefaultRamp::length, DefaultRamp::cruiseDelay));
+}
+
+void test_benchmark_portions() {
+  printf("Dispense time: linear-delay (old) vs trapezoidal vs S-curve ramp\n");
+  for (int i = 0; i < PORTION_COUNT; i++) {
+    uint64_t oldUs = legacyMoveDuration(PORTIONS[i], MOTOR_SPEED, MOTOR_ACCELERATION, MAX_STEP_DELAY);
+    uint64_t rampUs = rampMoveDuration(PORTIONS[i], DefaultRamp::table.data(),
+                                       DefaultRamp::length, DefaultRamp::cruiseDelay);
+    uint64_t sUs = rampMoveDuration(PORTIONS[i], DefaultSCurve::table.data(),
+                                    DefaultSCurve::length, DefaultSCurve::cruiseDelay);
+    printf("   %-8s %5d steps | old: %6.2f s | ramp: %6.2f s | S-curve: %6.2f s\n",
+           PORTION_NAMES[i], PORTIONS[i], oldUs / 1e6, rampUs / 1e6, sUs / 1e6);
+
+    TEST_ASSERT_LESS_OR_EQUAL(oldUs, rampUs);
+  }
+}
+
+// The S-curve eases into the ramp instead of starting at full
+// acceleration, at the cost of a slightly longer move
+void test_profile_simulation() {
+  const int steps = CAT_MIN_PORTION;
+  printf("profile,step,time_s,speed_steps_per_s\n");
+  ProfileRun trapezoid = simulateProfile(PROFILE_TRAPEZOID, "trapezoid", steps, 100);
+  ProfileRun scurve = simulateProfile(PROFILE_SCURVE, "scurve", steps, 100);
+  printf("Total move time: trapezoid %.3f s | S-curve %.3f s\n",
+         trapezoid.totalUs / 1e6, scurve.totalUs / 1e6);
+  printf("Peak jerk: trapezoid %.0f | S-curve %.0f steps/s^3\n", trapezoid.maxJerk, scurve.maxJerk);
+
+  TEST_ASSERT_EQUAL_UINT64(rampMoveDuration(steps, DefaultRamp::table.data(),
+                                            DefaultRamp::length, DefaultRamp::cruiseDelay),
+                           trapezoid.totalUs);
+  TEST_ASSERT_EQUAL_UINT64(rampMoveDuration(steps, DefaultSCurve::table.data(),
+                                            DefaultSCurve::length, DefaultSCurve::cruiseDelay),
+                           scurve.totalUs);
+
+  // Both reach MOTOR_SPEED without overshooting the acceleration much
+  TEST_ASSERT_FLOAT_WITHIN(MOTOR_ACCELERATION * 0.1, MOTOR_ACCELERATION, trapezoid.firstAccel);
+  TEST_ASSERT_TRUE(trapezoid.maxAccel < MOTOR_ACCELERATION * 1.1);
+  TEST_ASSERT_TRUE(scurve.maxAccel < MOTOR_ACCELERATION * 1.1);
+  TEST_ASSERT_TRUE(scurve.firstAccel < MOTOR_ACCELERATION * 0.1);
+  TEST_ASSERT_TRUE(scurve.maxJerk < trapezoid.maxJerk / 2);
+  TEST_ASSERT_GREATER_THAN(trapezoid.totalUs, scurve.totalUs);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_ramp_table_accelerates_to_cruise);
+  RUN_TEST(test_ramp_duration_matches_step_engine);
+  RUN_TEST(test_legacy_profile_short_move);
+  RUN_TEST(test_benchmark_portions);
+  RUN_TEST(test_profile_simulation);
+  return UNITY_END();
+}
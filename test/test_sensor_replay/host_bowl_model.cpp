@@ -0,0 +1,2 @@
+// Built from src/ for this suite only: it needs the stubs in test_sensor_replay.cpp
+#include "../../src/bowl_model.cpp"
@@ -0,0 +1,173 @@
+// test_sensor_replay.cpp
+// Host tests for the sensor trace replay (sensor.h) and the automatic feeding decision (auto_feed.h)
+// Records a bowl session through updateSensorReadings(), dumps and imports it, and replays it
+
+#include <stdio.h>
+#include <string>
+#include <unity.h>
+#include <Arduino.h>
+#include "config.h"
+#include "sensor.h"
+#include "sensor_trace.h"
+#include "ultrasonic.h"
+#include "eating_monitor.h"
+#include "bowl_model.h"
+#include "auto_feed.h"
+#include "gsm.h"
+
+// Globals and hooks main.cpp provides on the device
+float currentDistance = 0.0;
+float bowlDistance = 0.0;
+unsigned long lastSensorRead = 0;
+bool bowlEmpty = false;
+bool sensorInitialized = false;
+SystemState systemState = IDLE;
+
+void playBuzzer(int duration, int frequency) { delay(duration); }
+bool initializeI2CBus() { return true; }
+bool i2cProbe(uint8_t address) { return true; }
+void updateHopperLevel() {}
+void sendSMSAlert(SMSAlertType alertType) {}
+void sendSMSAlert(SMSAlertType alertType, const char* additionalInfo) {}
+
+const float FOOD_CM = 8.0f;     // ~200 g left
+const float EMPTY_CM = 16.0f;   // Bowl floor
+const unsigned long LOOP_MS = 10;
+
+// Live run: one loop() iteration per LOOP_MS with the automatic feeding
+// decision on millis(); a decided feed counts as dispensed
+struct LiveRun {
+  AutoFeedState autoFeed;
+  unsigned long feedMs;
+  int feeds;
+  unsigned long emptySinceMs;   // Last time bowlEmpty went true
+};
+
+static void runLive(LiveRun& run, float distanceCm, unsigned long durationMs) {
+  ultrasonicHostSetDistance(ULTRASONIC_BOWL, distanceCm);
+  unsigned long end = millis() + durationMs;
+  while (millis() < end) {
+    hostAdvanceMs(LOOP_MS);
+    bool wasEmpty = bowlEmpty;
+    updateSensorReadings();
+    if (bowlEmpty && !wasEmpty) run.emptySinceMs = millis();
+    if (autoFeedUpdate(run.autoFeed, bowlEmpty, true, millis()) & AUTO_FEED_DISPENSE) {
+      autoFeedDispensed(run.autoFeed, millis());
+      run.feedMs = millis();
+      run.feeds++;
+    }
+  }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_auto_feed_gates() {
+  AutoFeedState state;
+  autoFeedInit(state, 0);
+
+  // Empty for less than the confirmation time: no feed
+  unsigned long t = AUTO_FEED_CHECK_INTERVAL;
+  TEST_ASSERT_EQUAL_INT(AUTO_FEED_CHECKED | AUTO_FEED_EMPTY_DETECTED, autoFeedUpdate(state, true, true, t));
+  t += AUTO_FEED_CHECK_INTERVAL;
+  TEST_ASSERT_EQUAL_INT(AUTO_FEED_CHECKED, autoFeedUpdate(state, false, true, t));
+  TEST_ASSERT_EQUAL_UINT32(0, state.emptySince);
+
+  // Confirmed, but the hopper refuses: held for the retry interval
+  t += AUTO_FEED_CHECK_INTERVAL;
+  autoFeedUpdate(state, true, true, t);
+  t += BOWL_EMPTY_CONFIRMATION_TIME + AUTO_FEED_CHECK_INTERVAL;
+  TEST_ASSERT_TRUE(autoFeedUpdate(state, true, true, t) & AUTO_FEED_DISPENSE);
+  autoFeedRefused(state, t);
+  TEST_ASSERT_EQUAL_INT(0, autoFeedUpdate(state, true, true, t + AUTO_FEED_RETRY_INTERVAL - 1));
+  t += AUTO_FEED_RETRY_INTERVAL;
+  TEST_ASSERT_TRUE(autoFeedUpdate(state, true, true, t) & AUTO_FEED_DISPENSE);
+
+  // Fed: nothing before the minimum interval, then the daily limit
+  autoFeedDispensed(state, t);
+  TEST_ASSERT_EQUAL_INT(1, state.dailyCount);
+  TEST_ASSERT_EQUAL_INT(0, autoFeedUpdate(state, true, true, t + AUTO_FEED_MIN_INTERVAL - 1));
+  state.dailyCount = MAX_DAILY_AUTO_FEEDS;
+  TEST_ASSERT_EQUAL_INT(AUTO_FEED_LIMIT_REACHED, autoFeedUpdate(state, true, true, t + AUTO_FEED_MIN_INTERVAL));
+  TEST_ASSERT_TRUE(autoFeedDailyResetDue(state, 24UL * 60 * 60 * 1000 + 1));
+}
+
+// A dip shorter than the confirmation time, then an empty bowl: recorded
+// live, dumped as text, imported and replayed. The replay must reproduce
+// the bowl status of every record and the one automatic feed.
+void test_replay_drives_auto_feed() {
+  initializeEatingMonitor();
+  ultrasonicHostSetDistance(ULTRASONIC_BOWL, FOOD_CM);
+  initializeUltrasonicSensor();
+  TEST_ASSERT_TRUE(sensorInitialized);
+
+  LiveRun live = {};
+  autoFeedInit(live.autoFeed, millis());
+  runLive(live, FOOD_CM, 90000);
+  runLive(live, EMPTY_CM, BOWL_EMPTY_CONFIRMATION_TIME / 2);
+  runLive(live, FOOD_CM, 60000);
+  TEST_ASSERT_EQUAL_INT(0, live.feeds);
+  runLive(live, EMPTY_CM, 90000);
+  TEST_ASSERT_EQUAL_INT(1, live.feeds);
+
+  // Dump over "serial" and read it back as a host tool would
+  std::string dump;
+  Serial.capture = &dump;
+  dumpSensorTrace();
+  Serial.capture = nullptr;
+
+  static uint8_t buffer[SENSOR_TRACE_BYTES];
+  SensorTrace imported;
+  TEST_ASSERT_TRUE(sensorTraceImport(imported, buffer, sizeof(buffer), dump.c_str()));
+  TEST_ASSERT_EQUAL_UINT32(getSensorTrace().records, imported.records);
+
+  // Same loop as on the device: one record per updateSensorReadings(),
+  // then the decision on the record's timestamp
+  AutoFeedState replayed;
+  autoFeedInit(replayed, imported.baseTimeMs);
+  unsigned long replayFeedMs = 0;
+  int replayFeeds = 0;
+  float liveDistance = getCurrentDistance();
+  float liveGrams = getBowlGrams();
+  uint32_t liveCycles = getSensorCycleCount();
+  int liveSessions = getEatingSessionCount();
+  beginSensorReplay(imported);
+  while (true) {
+    updateSensorReadings();
+    if (!isSensorReplayActive()) break;
+    unsigned long recordedMs = getSensorReplayStats().lastTimeMs;
+    if (autoFeedUpdate(replayed, bowlEmpty, true, recordedMs) & AUTO_FEED_DISPENSE) {
+      autoFeedDispensed(replayed, recordedMs);
+      replayFeedMs = recordedMs;
+      replayFeeds++;
+    }
+  }
+
+  const SensorReplayStats& stats = getSensorReplayStats();
+  printf("Replayed %lu records: %lu bowl status changes, feed at %lu ms (live %lu ms)\n",
+         (unsigned long)stats.records, (unsigned long)stats.bowlEmptyChanges, replayFeedMs, live.feedMs);
+  TEST_ASSERT_EQUAL_UINT32(imported.records, stats.records);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.mismatches);
+  TEST_ASSERT_EQUAL_UINT32(3, stats.bowlEmptyChanges);   // Dip, food back, empty
+
+  // The live pipeline is back as it was
+  TEST_ASSERT_TRUE(bowlEmpty);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, liveDistance, getCurrentDistance());
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, liveGrams, getBowlGrams());
+  TEST_ASSERT_EQUAL_UINT32(liveCycles, getSensorCycleCount());
+  TEST_ASSERT_EQUAL_INT(liveSessions, getEatingSessionCount());
+
+  // The feed comes from the recorded clock, not from millis()
+  TEST_ASSERT_EQUAL_INT(1, replayFeeds);
+  TEST_ASSERT_TRUE(replayFeedMs > live.emptySinceMs + BOWL_EMPTY_CONFIRMATION_TIME);
+  TEST_ASSERT_TRUE(replayFeedMs < millis());
+  TEST_ASSERT_LESS_OR_EQUAL(AUTO_FEED_CHECK_INTERVAL + SENSOR_READ_INTERVAL,
+                            replayFeedMs > live.feedMs ? replayFeedMs - live.feedMs : live.feedMs - replayFeedMs);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_auto_feed_gates);
+  RUN_TEST(test_replay_drives_auto_feed);
+  return UNITY_END();
+}
@@ -0,0 +1,235 @@
+// test_sms_outbox.cpp
+// Host tests for the fixed-slot SMS outbox (sms_outbox.h)
+// Priority order, eviction, and a benchmark against the String queue it replaced
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <new>
+#include <string>
+#include <unity.h>
+#include "config.h"
+#include "sms_outbox.h"
+
+// Heap allocations made by the code under test
+static long allocations = 0;
+
+void* operator new(size_t size) {
+  allocations++;
+  void* block = malloc(size);
+  if (block == nullptr) throw std::bad_alloc();
+  return block;
+}
+void operator delete(void* block) noexcept { free(block); }
+void operator delete(void* block, size_t) noexcept { free(block); }
+
+const uint16_t TEST_CAPACITY = 4;
+static uint8_t storage[SMS_OUTBOX_CAPACITY * (sizeof(SMSOutboxSlot) + 2 * sizeof(uint16_t))];
+static SMSOutbox outbox;
+
+enum { HIGH_PRIORITY = 0, MEDIUM_PRIORITY, LOW_PRIORITY };
+const char* NUMBER = "+639291145133";
+const char* MESSAGE = "🤖 Smart Pet Feeder: Auto-fed CAT (~30g, bowl had 0g) - Bowl was empty. Time: 12345s";
+
+// ========================================
+// STRING QUEUE (before the outbox)
+// ========================================
+// queueSMS() and the pick/remove part of processSMSQueue() as they were,
+// logging left out. std::string stands in for Arduino String: both copy
+// the message to the heap on every assignment.
+
+struct SMSQueueItem {
+  std::string phoneNumber;
+  std::string message;
+  int priority;
+  unsigned long queueTime;
+};
+
+static SMSQueueItem stringQueue[SMS_OUTBOX_CAPACITY];
+static int stringQueueCapacity = 0;
+static int queueHead = 0;
+static int queueTail = 0;
+static int queueCount = 0;
+
+static void stringQueueInit(int capacity) {
+  stringQueueCapacity = capacity;
+  queueHead = queueTail = queueCount = 0;
+}
+
+static void stringQueuePush(const char* phoneNumber, const char* message, int priority, unsigned long nowMs) {
+  if (queueCount >= stringQueueCapacity) {
+    // Queue full - check if we can replace a lower priority item
+    int lowestPriorityIndex = -1;
+    int lowestPriority = HIGH_PRIORITY;
+    for (int i = 0; i < stringQueueCapacity; i++) {
+      int index = (queueHead + i) % stringQueueCapacity;
+      if (stringQueue[index].priority > lowestPriority) {
+        lowestPriority = stringQueue[index].priority;
+        lowestPriorityIndex = index;
+      }
+    }
+    if (priority < lowestPriority) {
+      stringQueue[lowestPriorityIndex].phoneNumber = std::string(phoneNumber);
+      stringQueue[lowestPriorityIndex].message = std::string(message);
+      stringQueue[lowestPriorityIndex].priority = priority;
+      stringQueue[lowestPriorityIndex].queueTime = nowMs;
+    }
+    return;
+  }
+
+  stringQueue[queueTail].phoneNumber = std::string(phoneNumber);
+  stringQueue[queueTail].message = std::string(message);
+  stringQueue[queueTail].priority = priority;
+  stringQueue[queueTail].queueTime = nowMs;
+  queueTail = (queueTail + 1) % stringQueueCapacity;
+  queueCount++;
+}
+
+static bool stringQueuePop() {
+  if (queueCount == 0) {
+    return false;
+  }
+  int highestPriorityIndex = -1;
+  int highestPriority = LOW_PRIORITY + 1;
+  for (int i = 0; i < queueCount; i++) {
+    int index = (queueHead + i) % stringQueueCapacity;
+    if (stringQueue[index].priority < highestPriority) {
+      highestPriority = stringQueue[index].priority;
+      highestPriorityIndex = index;
+    }
+  }
+
+  // The item was copied out before sending
+  SMSQueueItem item = stringQueue[highestPriorityIndex];
+  (void)item;
+
+  // Remove from queue by shifting
+  for (int i = highestPriorityIndex; i != queueTail; i = (i + 1) % stringQueueCapacity) {
+    int nextIndex = (i + 1) % stringQueueCapacity;
+    stringQueue[i] = stringQueue[nextIndex];
+  }
+  queueCount--;
+  queueTail = (queueTail - 1 + stringQueueCapacity) % stringQueueCapacity;
+  return true;
+}
+
+// ========================================
+// TESTS
+// ========================================
+
+void setUp() {
+  smsOutboxInit(outbox, storage, TEST_CAPACITY);
+}
+
+void tearDown() {}
+
+void test_priority_then_enqueue_order() {
+  smsOutboxPush(outbox, NUMBER, "low", LOW_PRIORITY, 1);
+  smsOutboxPush(outbox, NUMBER, "medium 1", MEDIUM_PRIORITY, 2);
+  smsOutboxPush(outbox, NUMBER, "high", HIGH_PRIORITY, 3);
+  smsOutboxPush(outbox, NUMBER, "medium 2", MEDIUM_PRIORITY, 4);
+  TEST_ASSERT_EQUAL_INT(2, outbox.countByPriority[MEDIUM_PRIORITY]);
+
+  const char* expected[] = {"high", "medium 1", "medium 2", "low"};
+  for (int i = 0; i < 4; i++) {
+    const SMSOutboxSlot* slot = smsOutboxPeek(outbox);
+    TEST_ASSERT_TRUE(slot != nullptr);
+    TEST_ASSERT_EQUAL_STRING(expected[i], slot->message);
+    TEST_ASSERT_EQUAL_STRING(NUMBER, slot->number);
+    smsOutboxPop(outbox);
+  }
+  TEST_ASSERT_TRUE(smsOutboxPeek(outbox) == nullptr);
+}
+
+void test_full_outbox_evicts_lower_priority() {
+  smsOutboxPush(outbox, NUMBER, "medium", MEDIUM_PRIORITY, 0);
+  smsOutboxPush(outbox, NUMBER, "low 1", LOW_PRIORITY, 1);
+  smsOutboxPush(outbox, NUMBER, "low 2", LOW_PRIORITY, 2);
+  smsOutboxPush(outbox, NUMBER, "low 3", LOW_PRIORITY, 3);
+
+  // A higher priority takes the slot of the oldest lowest-priority message,
+  // as the String queue did
+  TEST_ASSERT_TRUE(smsOutboxPush(outbox, NUMBER, "high", HIGH_PRIORITY, 10));
+  TEST_ASSERT_EQUAL_UINT32(1, outbox.evicted);
+  TEST_ASSERT_EQUAL_INT(TEST_CAPACITY, outbox.count);
+
+  // Equal or lower priority than the lowest held is refused
+  TEST_ASSERT_FALSE(smsOutboxPush(outbox, NUMBER, "low", LOW_PRIORITY, 11));
+  TEST_ASSERT_EQUAL_UINT32(1, outbox.dropped);
+  TEST_ASSERT_EQUAL_INT(TEST_CAPACITY - 2, outbox.countByPriority[LOW_PRIORITY]);
+
+  const char* expected[] = {"high", "medium", "low 2", "low 3"};
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL_STRING(expected[i], smsOutboxPeek(outbox)->message);
+    smsOutboxPop(outbox);
+  }
+}
+
+void test_long_message_truncated() {
+  char longMessage[SMS_MESSAGE_LENGTH * 2];
+  memset(longMessage, 'x', sizeof(longMessage) - 1);
+  longMessage[sizeof(longMessage) - 1] = '\0';
+  smsOutboxPush(outbox, NUMBER, longMessage, HIGH_PRIORITY, 0);
+  TEST_ASSERT_EQUAL_INT(SMS_MESSAGE_LENGTH - 1, strlen(smsOutboxPeek(outbox)->message));
+}
+
+// Same random push/pop mix through both queues, at the old queue size and
+// at SMS_OUTBOX_CAPACITY
+void test_benchmark_against_string_queue() {
+  const int OPERATIONS = 200000;
+  static uint8_t priorities[OPERATIONS];
+  static bool pushes[OPERATIONS];
+  srand(1);
+  for (int i = 0; i < OPERATIONS; i++) {
+    priorities[i] = rand() % SMS_OUTBOX_PRIORITIES;
+    pushes[i] = rand() % 100 < 55;
+  }
+
+  const int capacities[] = {5, SMS_OUTBOX_CAPACITY};
+  printf("SMS queue: String queue (old) vs outbox, %d operations\n", OPERATIONS);
+  for (int capacity : capacities) {
+    stringQueueInit(capacity);
+    long before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < OPERATIONS; i++) {
+      if (pushes[i]) {
+        stringQueuePush(NUMBER, MESSAGE, priorities[i], i);
+      } else {
+        stringQueuePop();
+      }
+    }
+    auto end = std::chrono::steady_clock::now();
+    long stringAllocations = allocations - before;
+    double stringNs = std::chrono::duration<double, std::nano>(end - start).count() / OPERATIONS;
+
+    smsOutboxInit(outbox, storage, capacity);
+    before = allocations;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < OPERATIONS; i++) {
+      if (pushes[i]) {
+        smsOutboxPush(outbox, NUMBER, MESSAGE, priorities[i], i);
+      } else if (smsOutboxPeek(outbox) != nullptr) {
+        smsOutboxPop(outbox);
+      }
+    }
+    end = std::chrono::steady_clock::now();
+    long outboxAllocations = allocations - before;
+    double outboxNs = std::chrono::duration<double, std::nano>(end - start).count() / OPERATIONS;
+
+    printf("   capacity %3d | old: %7.1f ns/op, %6ld allocations | outbox: %6.1f ns/op, %ld allocations\n",
+           capacity, stringNs, stringAllocations, outboxNs, outboxAllocations);
+
+    TEST_ASSERT_EQUAL_INT(0, outboxAllocations);
+    TEST_ASSERT_GREATER_THAN(0, stringAllocations);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_priority_then_enqueue_order);
+  RUN_TEST(test_full_outbox_evicts_lower_priority);
+  RUN_TEST(test_long_message_truncated);
+  RUN_TEST(test_benchmark_against_string_queue);
+  return UNITY_END();
+}
@@ -0,0 +1,161 @@
+// test_step_engine.cpp
+// Host tests for the step pulse engine (step_engine.h) on the simulated timer
+// Microstep switching: pulse count and move time of the dispense portions, and the driver pins they drive
+
+#include <stdio.h>
+#include <unity.h>
+#include "config.h"
+#include "fast_gpio.h"
+#include "motion_profile.h"
+#include "step_engine.h"
+
+const int PORTIONS[] = {CAT_MIN_PORTION, CAT_MAX_PORTION, DOG_MIN_PORTION, DOG_MAX_PORTION};
+const char* PORTION_NAMES[] = {"CAT min", "CAT max", "DOG min", "DOG max"};
+const int PORTION_COUNT = 4;
+
+// Dispense move as the motion task builds it at the default speed
+static StepMove dispenseMove(int steps, int fineSteps) {
+  StepMove move;
+  move.steps = steps;
+  move.clockwise = true;
+  move.fineSteps = fineSteps;
+  if (DISPENSE_PROFILE == PROFILE_SCURVE) {
+    move.profile = {DefaultSCurve::table.data(), DefaultSCurve::length, DefaultSCurve::cruiseDelay};
+  } else {
+    move.profile = {DefaultRamp::table.data(), DefaultRamp::length, DefaultRamp::cruiseDelay};
+  }
+  return move;
+}
+
+void setUp() {
+  fastGpioHostReset();
+  stepEngineHostReset();
+  TEST_ASSERT_TRUE(stepEngineBegin());
+}
+
+void tearDown() {}
+
+// Same table as printMicrostepBenchmark(). The move before microstep
+// switching was full-step throughout; the fine finish keeps its move time
+// (to the rounding of the split intervals) and only adds the fine pulses
+// of the last MICROSTEP_FINISH_STEPS.
+void test_microstep_benchmark() {
+  printf("Microstep switching: full step (before) vs 1/%d cruise + last %d steps at 1/%d\n",
+         MICROSTEP_COARSE, MICROSTEP_FINISH_STEPS, MICROSTEP_FINE);
+  for (int i = 0; i < PORTION_COUNT; i++) {
+    StepMove full = dispenseMove(PORTIONS[i], 0);
+    StepMove switched = dispenseMove(PORTIONS[i], MICROSTEP_FINISH_STEPS);
+    StepMove fine = dispenseMove(PORTIONS[i], PORTIONS[i]);
+    uint32_t fullPulses = stepEngineMovePulses(full);
+    uint32_t switchedPulses = stepEngineMovePulses(switched);
+    uint64_t fullUs = stepEngineMoveDuration(full);
+    uint64_t switchedUs = stepEngineMoveDuration(switched);
+    printf("   %-8s %5d steps | before: %5lu pulses %6.2f s | "
+           "switched: %5lu pulses %6.2f s, stops on 1/%d (all 1/%d: %lu pulses)\n",
+           PORTION_NAMES[i], PORTIONS[i],
+           (unsigned long)fullPulses, fullUs / 1e6,
+           (unsigned long)switchedPulses, switchedUs / 1e6, MICROSTEP_FINE,
+           MICROSTEP_FINE, (unsigned long)stepEngineMovePulses(fine));
+
+    TEST_ASSERT_EQUAL_UINT32(PORTIONS[i], fullPulses);
+    TEST_ASSERT_EQUAL_UINT32(PORTIONS[i] - MICROSTEP_FINISH_STEPS +
+                             MICROSTEP_FINISH_STEPS * MICROSTEPS_PER_STEP, switchedPulses);
+    TEST_ASSERT_LESS_OR_EQUAL(fullUs / 1000, fullUs > switchedUs ? fullUs - switchedUs : switchedUs - fullUs);
+  }
+
+  StepMove dogMax = dispenseMove(DOG_MAX_PORTION, MICROSTEP_FINISH_STEPS);
+  TEST_ASSERT_EQUAL_UINT32(7080, stepEngineMovePulses(dogMax));
+  TEST_ASSERT_EQUAL_UINT64(3450, (stepEngineMoveDuration(dogMax) + 5000) / 10000); // 34.50 s
+}
+
+// The simulated timer clocks out what the benchmark predicts
+void test_host_run_matches_prediction() {
+  StepMove move = dispenseMove(DOG_MAX_PORTION, MICROSTEP_FINISH_STEPS);
+  uint64_t predictedUs = stepEngineMoveDuration(move);
+
+  TEST_ASSERT_TRUE(stepEngineStart(move));
+  stepEngineHostAdvance(predictedUs - 1);
+  TEST_ASSERT_TRUE(stepEngineBusy());
+  stepEngineHostAdvance(1);
+  TEST_ASSERT_FALSE(stepEngineBusy());
+
+  TEST_ASSERT_EQUAL_UINT32(7080, stepEngineHostPulseCount());
+  TEST_ASSERT_EQUAL_UINT32(MICROSTEP_FINISH_STEPS * MICROSTEPS_PER_STEP, stepEngineHostFinePulseCount());
+  TEST_ASSERT_EQUAL_INT(DOG_MAX_PORTION, stepEngineStepsDone());
+  TEST_ASSERT_EQUAL_INT(DOG_MAX_PORTION * MICROSTEPS_PER_STEP, stepEngineMicrostepsDone());
+}
+
+// M2..M0 levels the DRV8825 needs for a 1/divisor resolution
+static bool microstepPinsAre(int divisor) {
+  int bits = 0;
+  while ((1 << bits) < divisor) bits++;
+  return fastGpioHostLevel(MOTOR_M0_PIN) == ((bits & 0x01) != 0) &&
+         fastGpioHostLevel(MOTOR_M1_PIN) == ((bits & 0x02) != 0) &&
+         fastGpioHostLevel(MOTOR_M2_PIN) == ((bits & 0x04) != 0);
+}
+
+// What the driver sees on the fast GPIO fake: one rising STEP edge per
+// pulse, STEP low between interrupts, DIR per move, M0-M2 switched for
+// the fine tail and back at the next move
+void test_driver_pins() {
+  StepMove move = dispenseMove(CAT_MIN_PORTION, MICROSTEP_FINISH_STEPS);
+  TEST_ASSERT_TRUE(microstepPinsAre(MICROSTEP_COARSE));
+  TEST_ASSERT_TRUE(stepEngineStart(move));
+  TEST_ASSERT_TRUE(fastGpioHostLevel(MOTOR_DIR_PIN));
+
+  while (!stepEngineFineMode()) {
+    stepEngineHostAdvance(100);
+    TEST_ASSERT_FALSE(fastGpioHostLevel(MOTOR_STEP_PIN));
+  }
+  TEST_ASSERT_EQUAL_INT(CAT_MIN_PORTION - MICROSTEP_FINISH_STEPS, stepEngineStepsDone());
+  TEST_ASSERT_TRUE(microstepPinsAre(MICROSTEP_FINE));
+
+  stepEngineHostAdvance(stepEngineMoveDuration(move));
+  TEST_ASSERT_FALSE(stepEngineBusy());
+  TEST_ASSERT_FALSE(fastGpioHostLevel(MOTOR_STEP_PIN));
+  TEST_ASSERT_EQUAL_UINT32(stepEngineMovePulses(move), fastGpioHostRiseCount(MOTOR_STEP_PIN));
+  TEST_ASSERT_EQUAL_UINT32(2 * stepEngineMovePulses(move), fastGpioHostWriteCount(MOTOR_STEP_PIN));
+
+  move.clockwise = false;
+  TEST_ASSERT_TRUE(stepEngineStart(move));
+  TEST_ASSERT_FALSE(fastGpioHostLevel(MOTOR_DIR_PIN));
+  TEST_ASSERT_TRUE(microstepPinsAre(MICROSTEP_COARSE));
+}
+
+// A stop inside the fine tail finishes the fine step it is in
+void test_stop_completes_fine_step() {
+  StepMove move = dispenseMove(CAT_MIN_PORTION, MICROSTEP_FINISH_STEPS);
+  TEST_ASSERT_TRUE(stepEngineStart(move));
+  while (stepEngineStepsDone() < CAT_MIN_PORTION - MICROSTEP_FINISH_STEPS / 2) {
+    stepEngineHostAdvance(100);
+  }
+  while (stepEngineMicrostepsDone() % MICROSTEPS_PER_STEP == 0) {
+    stepEngineHostAdvance(10);
+  }
+  stepEngineStop();
+  stepEngineHostAdvance(100000);
+
+  TEST_ASSERT_FALSE(stepEngineBusy());
+  TEST_ASSERT_EQUAL_INT(0, stepEngineMicrostepsDone() % MICROSTEPS_PER_STEP);
+  TEST_ASSERT_LESS_THAN(CAT_MIN_PORTION, stepEngineStepsDone());
+
+  // The stop holds until cleared: a move started in between does not run
+  TEST_ASSERT_TRUE(stepEngineStart(move));
+  stepEngineHostAdvance(100000);
+  TEST_ASSERT_FALSE(stepEngineBusy());
+  TEST_ASSERT_EQUAL_INT(0, stepEngineStepsDone());
+
+  stepEngineClearStop();
+  TEST_ASSERT_TRUE(stepEngineStart(move));
+  stepEngineHostAdvance(10000000);
+  TEST_ASSERT_EQUAL_INT(CAT_MIN_PORTION, stepEngineStepsDone());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_microstep_benchmark);
+  RUN_TEST(test_host_run_matches_prediction);
+  RUN_TEST(test_driver_pins);
+  RUN_TEST(test_stop_completes_fine_step);
+  return UNITY_END();
+}
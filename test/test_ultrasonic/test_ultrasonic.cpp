@@ -0,0 +1,176 @@
+// test_ultrasonic.cpp
+// Host tests for the RCWL-9620 measurement state machine (ultrasonic.h) on the simulated sensors
+// Fetch timing against the conversion time, what an early fetch would return, and the health counters
+
+#include <stdio.h>
+#include <unity.h>
+#include "config.h"
+#include "ultrasonic.h"
+
+const uint32_t CONVERSION_US = SENSOR_CONVERSION_TIME * 1000UL;
+
+// Polls the channel every stepUs from startUs until a cycle completes
+static uint32_t runCycle(UltrasonicChannel channel, uint32_t startUs, uint32_t stepUs,
+                         UltrasonicSample& sample) {
+  uint32_t now = startUs;
+  TEST_ASSERT_TRUE(ultrasonicStart(channel, now));
+  while (!ultrasonicUpdate(channel, now, sample)) {
+    now += stepUs;
+    TEST_ASSERT_LESS_THAN(startUs + 10 * CONVERSION_US, now);
+  }
+  return now;
+}
+
+void setUp() {
+  ultrasonicHostReset();
+}
+
+void tearDown() {}
+
+// The trigger goes out at once; the read is only queued once the
+// conversion time has passed, however often the channel is polled
+void test_no_fetch_before_conversion_time() {
+  ultrasonicHostSetDistance(ULTRASONIC_BOWL, 12.3f);
+  UltrasonicSample sample;
+
+  TEST_ASSERT_TRUE(ultrasonicStart(ULTRASONIC_BOWL, 1000));
+  TEST_ASSERT_FALSE(ultrasonicStart(ULTRASONIC_BOWL, 1000));   // One cycle at a time
+  for (uint32_t t = 1000; t < 1000 + CONVERSION_US; t += 100) {
+    TEST_ASSERT_FALSE(ultrasonicUpdate(ULTRASONIC_BOWL, t, sample));
+    TEST_ASSERT_EQUAL_INT(ULTRASONIC_CONVERTING, ultrasonicPhase(ULTRASONIC_BOWL));
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, ultrasonicHostTransactions(ULTRASONIC_BOWL));
+
+  TEST_ASSERT_TRUE(ultrasonicUpdate(ULTRASONIC_BOWL, 1000 + CONVERSION_US, sample));
+  TEST_ASSERT_EQUAL_UINT32(2, ultrasonicHostTransactions(ULTRASONIC_BOWL));
+  TEST_ASSERT_EQUAL_UINT32(0, ultrasonicHostEarlyFetches(ULTRASONIC_BOWL));
+  TEST_ASSERT_EQUAL_INT(ULTRASONIC_OK, sample.result);
+  TEST_ASSERT_TRUE(sample.checksumOk);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 12.3f, sample.distanceCm);
+  TEST_ASSERT_FALSE(ultrasonicBusy(ULTRASONIC_BOWL));
+
+  // The other channel was never touched
+  TEST_ASSERT_EQUAL_UINT32(0, ultrasonicHostTransactions(ULTRASONIC_HOPPER));
+}
+
+// Back-to-back cycles on both channels, polled like loop() does
+void test_cycles_never_fetch_early() {
+  ultrasonicHostSetDistance(ULTRASONIC_BOWL, 8.0f);
+  ultrasonicHostSetDistance(ULTRASONIC_HOPPER, 20.0f);
+  UltrasonicSample sample;
+
+  uint32_t now = 0;
+  for (int i = 0; i < 20; i++) {
+    UltrasonicChannel channel = (i % 2 == 0) ? ULTRASONIC_BOWL : ULTRASONIC_HOPPER;
+    now = runCycle(channel, now, 1000, sample) + 1000;
+    TEST_ASSERT_EQUAL_INT(ULTRASONIC_OK, sample.result);
+    TEST_ASSERT_GREATER_OR_EQUAL(CONVERSION_US, sample.latencyUs);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, ultrasonicHostEarlyFetches(ULTRASONIC_BOWL));
+  TEST_ASSERT_EQUAL_UINT32(0, ultrasonicHostEarlyFetches(ULTRASONIC_HOPPER));
+  TEST_ASSERT_EQUAL_UINT32(20, ultrasonicHostTransactions(ULTRASONIC_BOWL));
+  TEST_ASSERT_EQUAL_UINT32(20, ultrasonicHostTransactions(ULTRASONIC_HOPPER));
+  TEST_ASSERT_EQUAL_UINT32(10, ultrasonicHealth(ULTRASONIC_BOWL).goodReads);
+}
+
+// A sensor slower than SENSOR_CONVERSION_TIME is fetched too early and
+// hands back its previous result: the stale reading the wait guards against
+void test_slow_sensor_returns_previous_result() {
+  UltrasonicSample sample;
+  ultrasonicHostSetDistance(ULTRASONIC_BOWL, 10.0f);
+  uint32_t now = runCycle(ULTRASONIC_BOWL, 0, 1000, sample) + 1000;
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 10.0f, sample.distanceCm);
+
+  ultrasonicHostSetConversionTime(ULTRASONIC_BOWL, CONVERSION_US * 2);
+  ultrasonicHostSetDistance(ULTRASONIC_BOWL, 15.0f);
+  runCycle(ULTRASONIC_BOWL, now, 1000, sample);
+  TEST_ASSERT_EQUAL_UINT32(1, ultrasonicHostEarlyFetches(ULTRASONIC_BOWL));
+  TEST_ASSERT_EQUAL_INT(ULTRASONIC_OK, sample.result);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 10.0f, sample.distanceCm);
+}
+
+// Conversion wait and latency run on the bus timestamps: a slow bus and
+// a slow loop() neither shorten the wait nor count as sensor time
+void test_latency_from_bus_timestamps() {
+  const uint32_t BUS_US = 3000;
+  const uint32_t POLL_US = 10000;
+  ultrasonicHostSetBusDelay(ULTRASONIC_BOWL, BUS_US);
+  UltrasonicSample sample;
+
+  uint32_t now = runCycle(ULTRASONIC_BOWL, 0, POLL_US, sample);
+  TEST_ASSERT_EQUAL_UINT32(0, ultrasonicHostEarlyFetches(ULTRASONIC_BOWL));
+  TEST_ASSERT_EQUAL_UINT32(BUS_US, sample.triggerTimeUs);
+
+  // The fetch is queued on the first poll after the conversion time and
+  // is read BUS_US later; the next poll picks it up
+  uint32_t fetchQueued = (BUS_US + CONVERSION_US + POLL_US - 1) / POLL_US * POLL_US;
+  TEST_ASSERT_EQUAL_UINT32(fetchQueued + POLL_US, now);
+  uint32_t fetchRead = fetchQueued + BUS_US;
+  TEST_ASSERT_EQUAL_UINT32(fetchRead - sample.triggerTimeUs, sample.latencyUs);
+  TEST_ASSERT_LESS_THAN(now, sample.latencyUs);   // Start to pick-up would be now
+}
+
+// A bad checksum is flagged but the reading is kept; a NACKed trigger and
+// a trigger the bus queue refused end the cycle with their own counters;
+// a refused fetch only waits
+void test_checksum_and_trigger_errors() {
+  ultrasonicHostSetDistance(ULTRASONIC_BOWL, 12.0f);
+  UltrasonicSample sample;
+  uint32_t now = 0;
+
+  ultrasonicHostCorruptChecksum(ULTRASONIC_BOWL, true);
+  now = runCycle(ULTRASONIC_BOWL, now, 1000, sample) + 1000;
+  TEST_ASSERT_EQUAL_INT(ULTRASONIC_OK, sample.result);
+  TEST_ASSERT_FALSE(sample.checksumOk);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 12.0f, sample.distanceCm);
+  ultrasonicHostCorruptChecksum(ULTRASONIC_BOWL, false);
+
+  uint32_t transactions = ultrasonicHostTransactions(ULTRASONIC_BOWL);
+  ultrasonicHostFailNextTrigger(ULTRASONIC_BOWL, 2);   // NACK on address
+  TEST_ASSERT_TRUE(ultrasonicStart(ULTRASONIC_BOWL, now));
+  TEST_ASSERT_TRUE(ultrasonicUpdate(ULTRASONIC_BOWL, now, sample));
+  TEST_ASSERT_EQUAL_INT(ULTRASONIC_WRITE_ERROR, sample.result);
+  TEST_ASSERT_EQUAL_INT(2, sample.i2cError);
+  TEST_ASSERT_FALSE(sample.busFull);
+  TEST_ASSERT_EQUAL_UINT32(transactions + 1, ultrasonicHostTransactions(ULTRASONIC_BOWL));   // No fetch
+
+  ultrasonicHostBusFull(ULTRASONIC_BOWL, true);
+  TEST_ASSERT_TRUE(ultrasonicStart(ULTRASONIC_BOWL, now));
+  TEST_ASSERT_TRUE(ultrasonicUpdate(ULTRASONIC_BOWL, now, sample));
+  TEST_ASSERT_EQUAL_INT(ULTRASONIC_WRITE_ERROR, sample.result);
+  TEST_ASSERT_EQUAL_INT(0, sample.i2cError);
+  TEST_ASSERT_TRUE(sample.busFull);
+  ultrasonicHostBusFull(ULTRASONIC_BOWL, false);
+
+  // A fetch the queue refuses is retried on the next poll
+  TEST_ASSERT_TRUE(ultrasonicStart(ULTRASONIC_BOWL, now));
+  ultrasonicHostBusFull(ULTRASONIC_BOWL, true);
+  TEST_ASSERT_FALSE(ultrasonicUpdate(ULTRASONIC_BOWL, now + CONVERSION_US, sample));
+  ultrasonicHostBusFull(ULTRASONIC_BOWL, false);
+  TEST_ASSERT_TRUE(ultrasonicUpdate(ULTRASONIC_BOWL, now + CONVERSION_US + 1000, sample));
+  TEST_ASSERT_EQUAL_INT(ULTRASONIC_OK, sample.result);
+  TEST_ASSERT_TRUE(sample.checksumOk);
+
+  const UltrasonicHealth& health = ultrasonicHealth(ULTRASONIC_BOWL);
+  TEST_ASSERT_EQUAL_UINT32(4, health.cycles);
+  TEST_ASSERT_EQUAL_UINT32(1, health.goodReads);
+  TEST_ASSERT_EQUAL_UINT32(1, health.checksumErrors);
+  TEST_ASSERT_EQUAL_UINT32(1, health.i2cErrors[2]);
+  TEST_ASSERT_EQUAL_UINT32(0, health.i2cErrors[4]);
+  TEST_ASSERT_EQUAL_UINT32(2, health.busFull);   // Trigger and fetch
+  uint32_t timed = 0;
+  for (int b = 0; b < ULTRASONIC_LATENCY_BUCKETS; b++) {
+    timed += health.latency[b];
+  }
+  TEST_ASSERT_EQUAL_UINT32(2, timed);   // Only the cycles that read data
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_no_fetch_before_conversion_time);
+  RUN_TEST(test_cycles_never_fetch_early);
+  RUN_TEST(test_slow_sensor_returns_previous_result);
+  RUN_TEST(test_latency_from_bus_timestamps);
+  RUN_TEST(test_checksum_and_trigger_errors);
+  return UNITY_END();
+}